@@ -30,6 +30,7 @@ public:
 		WINDCHEST = 20,
 		AUDIOGROUP = 50,
 		AUDIOOUTPUT = 100,
+		REVERB = 120,
 		AUDIORECORDER = 150,
 		RELEASE = 160,
 		TOUCH = 700,
@@ -263,29 +263,20 @@ bool GOrgueArchiveCreator::addOrganData(unsigned idx, GOrgueFile* file)
 		wxLogError(_("Failed to parse organ definition %s"), m_OrganPaths[idx].c_str());
 		return false;
 	}
-	std::map<wxString, std::map<wxString, wxString> >::const_iterator organ_section = cfg.GetContent().find(wxT("Organ"));
-	if (organ_section == cfg.GetContent().end())
+	GOrgueConfigTable& entries = cfg.GetContent();
+	if (!entries.Find(wxT("Organ"), wxEmptyString))
 	{
 		wxLogError(_("No organ section in organ definition %s"), m_OrganPaths[idx].c_str());
 		return false;
 	}
-	const std::map<wxString, wxString> map = organ_section->second;
-	std::map<wxString, wxString>::const_iterator it;
-	wxString church_name, organ_builder, recording_details;
-	it = map.find(wxT("ChurchName"));
-	if (it != map.end())
-		church_name = it->second;
-	else
+	if (!entries.Find(wxT("Organ"), wxT("ChurchName")))
 	{
 		wxLogError(_("ChurchName missing in organ definition %s"), m_OrganPaths[idx].c_str());
 		return false;
 	}
-	it = map.find(wxT("OrganBuilder"));
-	if (it != map.end())
-		organ_builder = it->second;
-	it = map.find(wxT("RecordingDetails"));
-	if (it != map.end())
-		recording_details = it->second;
+	wxString church_name = cfg.getEntry(wxT("Organ"), wxT("ChurchName"));
+	wxString organ_builder = cfg.getEntry(wxT("Organ"), wxT("OrganBuilder"));
+	wxString recording_details = cfg.getEntry(wxT("Organ"), wxT("RecordingDetails"));
 	m_organs[idx] = new GOrgueOrgan(m_OrganPaths[idx], wxEmptyString, church_name, organ_builder, recording_details);
 	return true;
 }
@@ -22,6 +22,8 @@ public:
 
 	virtual void Initialize() = 0;
 	virtual void LoadData() = 0;
+	/* Drop the data of LoadData or LoadCache */
+	virtual void FreeData() = 0;
 	virtual bool LoadCache(GOrgueCache& cache) = 0;
 	virtual bool SaveCache(GOrgueCacheWriter& cache) = 0;
 	virtual void UpdateHash(GOrgueHash& hash) = 0;
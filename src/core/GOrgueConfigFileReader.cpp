@@ -15,6 +15,7 @@
 #include <wx/log.h>
 
 GOrgueConfigFileReader::GOrgueConfigFileReader() :
+	m_Data(),
 	m_Entries(),
 	m_Hash()
 {
@@ -29,34 +30,22 @@ wxString GOrgueConfigFileReader::GetHash()
 	return m_Hash;
 }
 
-const std::map<wxString, std::map<wxString, wxString> >& GOrgueConfigFileReader::GetContent()
+GOrgueConfigTable& GOrgueConfigFileReader::GetContent()
 {
 	return m_Entries;
 }
 
-wxString GOrgueConfigFileReader::GetNextLine(const wxString& buffer, unsigned &pos)
+const GOrgueBuffer<uint8_t>& GOrgueConfigFileReader::GetData()
 {
-	int newpos = buffer.find(wxT("\n"), pos);
-	if (newpos < (int)pos)
-		newpos = buffer.Len();
-	wxString line = buffer.Mid(pos, newpos - pos);
-	pos = newpos + 1;
-	if (line.Len() > 0 && line[line.Len() - 1] == wxT('\r'))
-		return line.Mid(0, line.Len() - 1);
-	return line;
+	return m_Data;
 }
 
 wxString GOrgueConfigFileReader::getEntry(wxString group, wxString name)
 {
-	std::map<wxString, std::map<wxString, wxString> >::const_iterator i = m_Entries.find(group);
-	if (i == m_Entries.end())
+	GOrgueConfigEntry* entry = m_Entries.Find(group, name);
+	if (!entry || !entry->key.len)
 		return wxEmptyString;
-	const std::map<wxString, wxString>& g = i->second;
-	std::map<wxString, wxString>::const_iterator j = g.find(name);
-	if (j == g.end())
-		return wxEmptyString;
-	else
-		return j->second;
+	return GOrgueConfigTable::ToString(entry->value);
 }
 
 bool GOrgueConfigFileReader::Read(wxString filename)
@@ -67,7 +56,8 @@ bool GOrgueConfigFileReader::Read(wxString filename)
 
 bool GOrgueConfigFileReader::Read(GOrgueFile* file)
 {
-	m_Entries.clear();
+	m_Entries.Clear();
+	m_Data.free();
 	
 	if (!file->Open())
 	{
@@ -105,80 +95,118 @@ bool GOrgueConfigFileReader::Read(GOrgueFile* file)
 		}
 	}
 
-	wxMBConv* conv;
-	wxCSConv isoConv(wxT("ISO-8859-1"));
-	uint8_t* dataPtr = data.get();
+	/* The entries refer to the text, so it is kept as UTF-8. ASCII is
+	 * valid UTF-8 already, only ISO-8859-1 with umlauts needs a copy. */
+	unsigned start = 0;
 	size_t length = data.GetCount();
 	if (length >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
 	{
-		conv = &wxConvUTF8;
-		dataPtr = data.get() + 3;
+		start = 3;
 		length -= 3;
+		if (wxConvUTF8.ToWChar(NULL, 0, (const char*)data.get() + start, length) == wxCONV_FAILED)
+		{
+			wxLogError(_("Failed to decode file '%s'"), file->GetName().c_str());
+			return false;
+		}
 	}
 	else
-		conv = &isoConv;
-	wxString input((const char*)dataPtr, *conv, length);
-	data.free();
-	if (length && input.Len() == 0)
 	{
-		wxLogError(_("Failed to decode file '%s'"), file->GetName().c_str());
-		return false;
+		size_t extra = 0;
+		for(size_t i = 0; i < length; i++)
+			if (data[i] >= 0x80)
+				extra++;
+		if (extra)
+		{
+			GOrgueBuffer<uint8_t> utf8(length + extra);
+			for(size_t i = 0, j = 0; i < length; i++)
+			{
+				uint8_t c = data[i];
+				if (c < 0x80)
+					utf8[j++] = c;
+				else
+				{
+					utf8[j++] = 0xC0 | (c >> 6);
+					utf8[j++] = 0x80 | (c & 0x3F);
+				}
+			}
+			data = std::move(utf8);
+			length += extra;
+		}
 	}
-	
-	unsigned pos = 0;
-	wxString group;
-	std::map<wxString, wxString>* grp = NULL;
+	m_Data = std::move(data);
+
+	Parse((const char*)m_Data.get() + start, length);
+	return true;
+}
+
+static inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+void GOrgueConfigFileReader::Parse(const char* text, unsigned length)
+{
+	const char* end = text + length;
+	const GOrgueConfigString none = { text, 0 };
+	GOrgueConfigString group = none;
+	bool has_group = false;
 	unsigned lineno = 0;
-	
-	while(pos < input.Len())
+
+	for(const char* pos = text; pos < end; )
 	{
-		wxString line = GetNextLine(input, pos);
+		const char* eol = (const char*)memchr(pos, '\n', end - pos);
+		if (!eol)
+			eol = end;
+		GOrgueConfigString line = { pos, (unsigned)(eol - pos) };
+		pos = eol + 1;
 		lineno++;
-		
-		if (line == wxEmptyString)
+
+		if (line.len > 0 && line.ptr[line.len - 1] == '\r')
+			line.len--;
+		if (!line.len)
 			continue;
-		if (line.Len() >= 1 && line[0] == wxT(';'))
+		if (line.ptr[0] == ';')
 			continue;
-		if (line.Len() > 1 && line[0] == wxT('['))
+		if (line.len > 1 && line.ptr[0] == '[')
 		{
-			if (line[line.Len() - 1] != wxT(']'))
+			if (line.ptr[line.len - 1] != ']')
 			{
-				line = line.Trim();
-				if (line[line.Len() - 1] != wxT(']'))
+				while(line.len && IsSpace(line.ptr[line.len - 1]))
+					line.len--;
+				if (line.ptr[line.len - 1] != ']')
 				{
-					wxLogError(_("Invalid Config entry at line %d: %s"), lineno, line.c_str());
+					wxLogError(_("Invalid Config entry at line %d: %s"), lineno, GOrgueConfigTable::ToString(line).c_str());
 					continue;
 				}
-				wxLogError(_("Invalid section start at line %d: %s"), lineno, line.c_str());
+				wxLogError(_("Invalid section start at line %d: %s"), lineno, GOrgueConfigTable::ToString(line).c_str());
 			}
-			group = line.Mid(1, line.Len() - 2);
-			if (m_Entries.find(group) != m_Entries.end())
+			group.ptr = line.ptr + 1;
+			group.len = line.len - 2;
+			has_group = true;
+			if (!m_Entries.Add(group, none, none))
 			{
-				wxLogWarning(_("Duplicate group at line %d: %s"), lineno, group.c_str());
+				wxLogWarning(_("Duplicate group at line %d: %s"), lineno, GOrgueConfigTable::ToString(group).c_str());
 			}
-			grp = &m_Entries[group];
 		}
 		else
 		{
-			if (!grp)
+			if (!has_group)
 			{
 				wxLogError(_("Config entry without any group at line %d"), lineno);
 				continue;
 			}
-			int datapos = line.find(wxT("="), 0);
-			if (datapos <= 0)
+			const char* datapos = (const char*)memchr(line.ptr, '=', line.len);
+			if (!datapos || datapos == line.ptr)
 			{
-				wxLogError(_("Invalid Config entry at line %d: %s"), lineno, line.c_str());
+				wxLogError(_("Invalid Config entry at line %d: %s"), lineno, GOrgueConfigTable::ToString(line).c_str());
 				continue;
 			}
-			wxString name = line.Mid(0, datapos);
-			if (grp->find(name) != grp->end())
+			GOrgueConfigString name = { line.ptr, (unsigned)(datapos - line.ptr) };
+			GOrgueConfigString value = { datapos + 1, line.len - name.len - 1 };
+			if (!m_Entries.Add(group, name, value))
 			{
-				wxLogWarning(_("Duplicate entry in section %s at line %d: %s"), group.c_str(), lineno, name.c_str());
+				wxLogWarning(_("Duplicate entry in section %s at line %d: %s"), GOrgueConfigTable::ToString(group).c_str(), lineno, GOrgueConfigTable::ToString(name).c_str());
 			}
-			(*grp)[name] = line.Mid(datapos + 1);
 		}
 	}
-
-	return true;
 }
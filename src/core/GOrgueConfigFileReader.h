@@ -7,18 +7,23 @@
 #ifndef GORGUECONFIGFILEREADER_H
 #define GORGUECONFIGFILEREADER_H
 
+#include "GOrgueBuffer.h"
+#include "GOrgueConfigTable.h"
 #include <wx/string.h>
-#include <map>
 
 class GOrgueFile;
 
+/* Parses the file in place: the entries refer to the UTF-8 text, which
+ * is kept by the reader */
 class GOrgueConfigFileReader
 {
 private:
-	std::map<wxString, std::map<wxString, wxString> > m_Entries;
+	GOrgueBuffer<uint8_t> m_Data;
+	GOrgueConfigTable m_Entries;
 	wxString m_Hash;
 
-	wxString GetNextLine(const wxString& buffer, unsigned &pos);
+	void Parse(const char* text, unsigned length);
+
 public:
 	GOrgueConfigFileReader();
 	~GOrgueConfigFileReader();
@@ -27,7 +32,8 @@ public:
 	bool Read(wxString filename);
 	wxString GetHash();
 
-	const std::map<wxString, std::map<wxString, wxString> >& GetContent();
+	GOrgueConfigTable& GetContent();
+	const GOrgueBuffer<uint8_t>& GetData();
 	wxString getEntry(wxString group, wxString name);
 };
 
@@ -12,9 +12,9 @@
 
 GOrgueConfigReaderDB::GOrgueConfigReaderDB(bool case_sensitive) :
 	m_CaseSensitive(case_sensitive),
-	m_ODF(1000),
-	m_ODF_LC(1000),
-	m_CMB(100)
+	m_Data(),
+	m_ODF(),
+	m_CMB()
 {
 }
 
@@ -24,19 +24,20 @@ GOrgueConfigReaderDB::~GOrgueConfigReaderDB()
 
 void GOrgueConfigReaderDB::ReportUnused()
 {
-	for(GOBoolHashMap::iterator i = m_CMBUsed.begin(); i != m_CMBUsed.end(); i++)
+	for(unsigned i = 0; i < m_CMB.GetCount(); i++)
 	{
-		if (!i->second)
+		if (!m_CMB.GetEntry(i).used)
 		{
-			wxLogWarning(_("Unused CMB entry '%s'"), i->first.c_str());
+			wxLogWarning(_("Unused CMB entry '%s'"), GOrgueConfigTable::GetName(m_CMB.GetEntry(i)).c_str());
 		}
 	}
 	bool warn_old = false;
-	for(GOBoolHashMap::iterator i = m_ODFUsed.begin(); i != m_ODFUsed.end(); i++)
+	for(unsigned i = 0; i < m_ODF.GetCount(); i++)
 	{
-		if (!i->second)
+		const GOrgueConfigEntry& entry = m_ODF.GetEntry(i);
+		if (!entry.used)
 		{
-			if (i->first.StartsWith(wxT("_")))
+			if (entry.group.len && entry.group.ptr[0] == '_')
 			{
 				if (!warn_old)
 				{
@@ -46,48 +47,47 @@ void GOrgueConfigReaderDB::ReportUnused()
 			}
 			else
 			{
-				wxLogWarning(_("Unused ODF entry '%s'"), i->first.c_str());
+				wxLogWarning(_("Unused ODF entry '%s'"), GOrgueConfigTable::GetName(entry).c_str());
 			}
 		}
 	}
 }
 
+/* The entries are added without copying them one by one: the text of the
+ * file is copied once and the entries are moved to the copy */
 bool GOrgueConfigReaderDB::ReadData(GOrgueConfigFileReader& ODF, GOSettingType type, bool handle_prefix)
 {
-	const std::map<wxString, std::map<wxString, wxString> >& entries = ODF.GetContent();
+	GOrgueConfigTable& entries = ODF.GetContent();
+	const GOrgueBuffer<uint8_t>& data = ODF.GetData();
+	GOrgueBuffer<uint8_t>* copy = NULL;
 	bool changed = false;
 
-	for(std::map<wxString, std::map<wxString, wxString> >::const_iterator i = entries.begin(); i != entries.end(); i++)
+	for(unsigned i = 0; i < entries.GetCount(); i++)
 	{
-		const std::map<wxString, wxString>& g = i->second;
-		wxString group = i->first;
+		const GOrgueConfigEntry& entry = entries.GetEntry(i);
+		if (!entry.key.len)
+			continue;
+		if (handle_prefix && (!entry.group.len || entry.group.ptr[0] != '_'))
+			continue;
 
-		if (!handle_prefix || group.StartsWith(wxT("_")))
+		if (!copy)
 		{
-			if (handle_prefix)
-				group = group.Mid(1);
-
-			for(std::map<wxString, wxString>::const_iterator j = g.begin(); j != g.end(); j++)
-			{
-				const wxString& key = j->first;
-				const wxString& value = j->second;
-				wxString k = group + wxT('/') + key;
-
-				if (type == ODFSetting)
-				{
-					AddEntry(m_ODF, k, value);
-					if (!m_CaseSensitive)
-						AddEntry(m_ODF_LC, k.Lower(), value);
-					m_ODFUsed[k] = false;
-				}
-				else
-				{
-					AddEntry(m_CMB, k, value);
-					m_CMBUsed[k] = false;
-				}
-				changed = true;
-			}
+			copy = new GOrgueBuffer<uint8_t>(data.GetCount());
+			memcpy(copy->get(), data.get(), data.GetSize());
+			m_Data.push_back(copy);
 		}
+		ptrdiff_t offset = (const char*)copy->get() - (const char*)data.get();
+		GOrgueConfigString group = { entry.group.ptr + offset, entry.group.len };
+		GOrgueConfigString key = { entry.key.ptr + offset, entry.key.len };
+		GOrgueConfigString value = { entry.value.ptr + offset, entry.value.len };
+		if (handle_prefix)
+		{
+			group.ptr++;
+			group.len--;
+		}
+
+		AddEntry(type == ODFSetting ? m_ODF : m_CMB, group, key, value);
+		changed = true;
 	}
 	
 	return changed;
@@ -95,53 +95,38 @@ bool GOrgueConfigReaderDB::ReadData(GOrgueConfigFileReader& ODF, GOSettingType t
 
 void GOrgueConfigReaderDB::ClearCMB()
 {
-	m_CMB.clear();
-	m_CMBUsed.clear();
+	m_CMB.Clear();
 }
 
-void GOrgueConfigReaderDB::AddEntry(GOStringHashMap& hash, wxString key, wxString value)
+void GOrgueConfigReaderDB::AddEntry(GOrgueConfigTable& table, const GOrgueConfigString& group, const GOrgueConfigString& key, const GOrgueConfigString& value)
 {
-	GOStringHashMap::iterator i = hash.find(key);
-	if (i != hash.end())
+	if (!table.Add(group, key, value))
 	{
-		wxLogWarning(_("Duplicate entry: %s"), key.c_str());
+		wxLogWarning(_("Duplicate entry: %s"), (GOrgueConfigTable::ToString(group) + wxT('/') + GOrgueConfigTable::ToString(key)).c_str());
 	}
-	hash[key] = value;
 }
 
 
 bool GOrgueConfigReaderDB::GetString(GOSettingType type, wxString group, wxString key, wxString& value)
 {
-	wxString index = group + wxT("/") + key;
+	GOrgueConfigEntry* entry = NULL;
 	if (type == CMBSetting)
-	{
-		m_CMBUsed[index] = true;
-		GOStringHashMap::iterator i = m_CMB.find(index);
-		if (i != m_CMB.end())
-		{
-			value = i->second;
-			return true;
-		}
-	}
+		entry = m_CMB.Find(group, key);
 	if (type == ODFSetting)
 	{
-		m_ODFUsed[index] = true;
-		GOStringHashMap::iterator i = m_ODF.find(index);
-		if (i != m_ODF.end())
-		{
-			value = i->second;
-			return true;
-		}
-	}
-	if (type == ODFSetting && !m_CaseSensitive)
-	{
-		GOStringHashMap::iterator i = m_ODF_LC.find(index.Lower());
-		if (i != m_ODF.end())
+		entry = m_ODF.Find(group, key);
+		if (!entry && !m_CaseSensitive)
 		{
-			wxLogWarning(_("Incorrect case for section '%s' entry '%s'"), group.c_str(), key.c_str());
-			value = i->second;
-			return true;
+			entry = m_ODF.Find(group, key, true);
+			if (entry)
+			{
+				wxLogWarning(_("Incorrect case for section '%s' entry '%s'"), group.c_str(), key.c_str());
+			}
 		}
 	}
-	return false;
+	if (!entry || !entry->key.len)
+		return false;
+	entry->used = true;
+	value = GOrgueConfigTable::ToString(entry->value);
+	return true;
 }
@@ -7,8 +7,10 @@
 #ifndef GORGUECONFIGREADERDB_H
 #define GORGUECONFIGREADERDB_H
 
+#include "GOrgueBuffer.h"
 #include "GOrgueConfigReader.h"
-#include <wx/hashmap.h>
+#include "GOrgueConfigTable.h"
+#include "ptrvector.h"
 #include <wx/string.h>
 
 class GOrgueConfigFileReader;
@@ -16,17 +18,13 @@ class GOrgueConfigFileReader;
 class GOrgueConfigReaderDB
 {
 private:
-	WX_DECLARE_STRING_HASH_MAP( wxString, GOStringHashMap );
-	WX_DECLARE_STRING_HASH_MAP( bool, GOBoolHashMap );
-
 	bool m_CaseSensitive;
-	GOStringHashMap m_ODF;
-	GOStringHashMap m_ODF_LC;
-	GOStringHashMap m_CMB;
-	GOBoolHashMap m_ODFUsed;
-	GOBoolHashMap m_CMBUsed;
+	/* Copies of the texts of the files, which the entries refer to */
+	ptr_vector<GOrgueBuffer<uint8_t> > m_Data;
+	GOrgueConfigTable m_ODF;
+	GOrgueConfigTable m_CMB;
 
-	void AddEntry(GOStringHashMap& hash, wxString key, wxString value);
+	void AddEntry(GOrgueConfigTable& table, const GOrgueConfigString& group, const GOrgueConfigString& key, const GOrgueConfigString& value);
 
 public:
 	GOrgueConfigReaderDB(bool case_sensitive = true);
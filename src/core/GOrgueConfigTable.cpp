@@ -0,0 +1,143 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOrgueConfigTable.h"
+
+#include <string.h>
+
+static inline unsigned char ToLowerASCII(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+GOrgueConfigTable::GOrgueConfigTable() :
+	m_Entries(),
+	m_Index()
+{
+}
+
+void GOrgueConfigTable::Clear()
+{
+	m_Entries.clear();
+	m_Index.clear();
+}
+
+/* FNV-1a of the lower case group and key */
+unsigned GOrgueConfigTable::Hash(const GOrgueConfigString& group, const GOrgueConfigString& key)
+{
+	unsigned hash = 2166136261u;
+	for(unsigned i = 0; i < group.len; i++)
+		hash = (hash ^ ToLowerASCII(group.ptr[i])) * 16777619u;
+	hash = (hash ^ '/') * 16777619u;
+	for(unsigned i = 0; i < key.len; i++)
+		hash = (hash ^ ToLowerASCII(key.ptr[i])) * 16777619u;
+	return hash;
+}
+
+bool GOrgueConfigTable::Equals(const GOrgueConfigString& a, const GOrgueConfigString& b)
+{
+	return a.len == b.len && !memcmp(a.ptr, b.ptr, a.len);
+}
+
+bool GOrgueConfigTable::EqualsNoCase(const GOrgueConfigString& a, const GOrgueConfigString& b)
+{
+	if (a.len != b.len)
+		return false;
+	for(unsigned i = 0; i < a.len; i++)
+		if (ToLowerASCII(a.ptr[i]) != ToLowerASCII(b.ptr[i]))
+			return false;
+	return true;
+}
+
+void GOrgueConfigTable::Insert(unsigned entry)
+{
+	unsigned mask = m_Index.size() - 1;
+	unsigned slot = m_Entries[entry].hash & mask;
+	while(m_Index[slot])
+		slot = (slot + 1) & mask;
+	m_Index[slot] = entry + 1;
+}
+
+/* Keeps the table at most half full */
+void GOrgueConfigTable::Grow()
+{
+	unsigned size = m_Index.size() ? m_Index.size() * 2 : 1024;
+	m_Index.assign(size, 0);
+	for(unsigned i = 0; i < m_Entries.size(); i++)
+		Insert(i);
+}
+
+GOrgueConfigEntry* GOrgueConfigTable::Find(const GOrgueConfigString& group, const GOrgueConfigString& key, unsigned hash, bool ignore_case)
+{
+	if (!m_Index.size())
+		return NULL;
+	GOrgueConfigEntry* match = NULL;
+	unsigned mask = m_Index.size() - 1;
+	for(unsigned slot = hash & mask; m_Index[slot]; slot = (slot + 1) & mask)
+	{
+		GOrgueConfigEntry& entry = m_Entries[m_Index[slot] - 1];
+		if (entry.hash != hash)
+			continue;
+		if (Equals(entry.key, key) && Equals(entry.group, group))
+			return &entry;
+		if (ignore_case && !match && EqualsNoCase(entry.key, key) && EqualsNoCase(entry.group, group))
+			match = &entry;
+	}
+	return match;
+}
+
+bool GOrgueConfigTable::Add(const GOrgueConfigString& group, const GOrgueConfigString& key, const GOrgueConfigString& value)
+{
+	unsigned hash = Hash(group, key);
+	GOrgueConfigEntry* entry = Find(group, key, hash, false);
+	if (entry)
+	{
+		entry->value = value;
+		return false;
+	}
+	GOrgueConfigEntry e = { group, key, value, hash, false };
+	m_Entries.push_back(e);
+	if (m_Entries.size() * 2 > m_Index.size())
+		Grow();
+	else
+		Insert(m_Entries.size() - 1);
+	return true;
+}
+
+GOrgueConfigEntry* GOrgueConfigTable::Find(const GOrgueConfigString& group, const GOrgueConfigString& key, bool ignore_case)
+{
+	return Find(group, key, Hash(group, key), ignore_case);
+}
+
+GOrgueConfigEntry* GOrgueConfigTable::Find(const wxString& group, const wxString& key, bool ignore_case)
+{
+	wxScopedCharBuffer group_utf8 = group.utf8_str();
+	wxScopedCharBuffer key_utf8 = key.utf8_str();
+	GOrgueConfigString g = { group_utf8.data(), (unsigned)group_utf8.length() };
+	GOrgueConfigString k = { key_utf8.data(), (unsigned)key_utf8.length() };
+	return Find(g, k, ignore_case);
+}
+
+unsigned GOrgueConfigTable::GetCount() const
+{
+	return m_Entries.size();
+}
+
+GOrgueConfigEntry& GOrgueConfigTable::GetEntry(unsigned index)
+{
+	return m_Entries[index];
+}
+
+wxString GOrgueConfigTable::ToString(const GOrgueConfigString& str)
+{
+	return wxString::FromUTF8(str.ptr, str.len);
+}
+
+/* Name of the entry in messages: group/key */
+wxString GOrgueConfigTable::GetName(const GOrgueConfigEntry& entry)
+{
+	return ToString(entry.group) + wxT('/') + ToString(entry.key);
+}
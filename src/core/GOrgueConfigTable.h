@@ -0,0 +1,69 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GORGUECONFIGTABLE_H
+#define GORGUECONFIGTABLE_H
+
+#include <wx/string.h>
+#include <vector>
+
+/* Part of an UTF-8 buffer, which is owned by the reader of the file */
+typedef struct
+{
+	const char* ptr;
+	unsigned len;
+} GOrgueConfigString;
+
+typedef struct
+{
+	GOrgueConfigString group;
+	/* Empty for the entry, which marks the group itself */
+	GOrgueConfigString key;
+	GOrgueConfigString value;
+	unsigned hash;
+	bool used;
+} GOrgueConfigEntry;
+
+/* Entries of a configuration file keyed by group and key.
+ *
+ * The entries are kept in the order they were added. The index is an open
+ * addressing table of entry numbers with linear probing. Its hash ignores
+ * the ASCII case, so a case insensitive lookup probes the same slots and
+ * needs no lower case copy of the entries. */
+class GOrgueConfigTable
+{
+private:
+	std::vector<GOrgueConfigEntry> m_Entries;
+	/* Entry number plus one, 0 for an empty slot */
+	std::vector<unsigned> m_Index;
+
+	static unsigned Hash(const GOrgueConfigString& group, const GOrgueConfigString& key);
+	static bool EqualsNoCase(const GOrgueConfigString& a, const GOrgueConfigString& b);
+	void Insert(unsigned entry);
+	void Grow();
+	GOrgueConfigEntry* Find(const GOrgueConfigString& group, const GOrgueConfigString& key, unsigned hash, bool ignore_case);
+
+public:
+	GOrgueConfigTable();
+
+	void Clear();
+	/* Returns false if the entry was already present, its value is
+	 * replaced then */
+	bool Add(const GOrgueConfigString& group, const GOrgueConfigString& key, const GOrgueConfigString& value);
+	/* Without an exact match, ignore_case returns an entry which only
+	 * differs in the ASCII case */
+	GOrgueConfigEntry* Find(const GOrgueConfigString& group, const GOrgueConfigString& key, bool ignore_case = false);
+	GOrgueConfigEntry* Find(const wxString& group, const wxString& key, bool ignore_case = false);
+
+	unsigned GetCount() const;
+	GOrgueConfigEntry& GetEntry(unsigned index);
+
+	static bool Equals(const GOrgueConfigString& a, const GOrgueConfigString& b);
+	static wxString ToString(const GOrgueConfigString& str);
+	static wxString GetName(const GOrgueConfigEntry& entry);
+};
+
+#endif
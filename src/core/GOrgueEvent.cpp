@@ -7,6 +7,7 @@
 #include "GOrgueEvent.h"
 
 #include <wx/app.h>
+#include <wx/log.h>
 #include <wx/window.h>
 
 DEFINE_LOCAL_EVENT_TYPE(wxEVT_METERS)
@@ -95,6 +96,11 @@ IMPLEMENT_DYNAMIC_CLASS(wxRenameFileEvent, wxEvent)
 
 void GOMessageBox(const wxString& text, const wxString title, long style, wxWindow* parent)
 {
+	if (!wxTheApp->GetTopWindow())
+	{
+		wxLogError(wxT("%s"), text.c_str());
+		return;
+	}
 	wxMsgBoxEvent event(title, text, style);
 	wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
 }
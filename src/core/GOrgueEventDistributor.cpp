@@ -9,16 +9,23 @@
 #include "GOrgueCacheObject.h"
 #include "GOrgueControlChangedHandler.h"
 #include "GOrgueEventHandler.h"
+#include "GOrgueMidiEvent.h"
 #include "GOrguePlaybackStateHandler.h"
 #include "GOrgueSaveableObject.h"
+#include <algorithm>
 
 GOrgueEventDistributor::GOrgueEventDistributor() :
 	m_handler(),
+	m_HandlerType(),
 	m_ControlChangedHandler(),
 	m_PlaybackStateHandler(),
 	m_SaveableObjects(),
 	m_MidiConfigurator(),
-	m_CacheObjects()
+	m_CacheObjects(),
+	m_MidiIndex(),
+	m_MidiBroadcast(),
+	m_MidiTargets(),
+	m_MidiIndexValid(false)
 {
 }
 
@@ -33,11 +40,16 @@ void GOrgueEventDistributor::Cleanup()
 	m_SaveableObjects.clear();
 	m_MidiConfigurator.clear();
 	m_CacheObjects.clear();
+	m_MidiIndexValid = false;
 }
 
-void GOrgueEventDistributor::RegisterEventHandler(GOrgueEventHandler* handler)
+/* Key handlers only play notes and may receive their events on the MIDI
+ * thread, all others are controls */
+void GOrgueEventDistributor::RegisterEventHandler(GOrgueEventHandler* handler, bool keys)
 {
 	m_handler.push_back(handler);
+	m_HandlerType.push_back(keys ? MIDI_HANDLER_KEYS : MIDI_HANDLER_CONTROLS);
+	m_MidiIndexValid = false;
 }
 
 void GOrgueEventDistributor::RegisterCacheObject(GOrgueCacheObject* obj)
@@ -75,10 +87,94 @@ GOrgueMidiConfigurator* GOrgueEventDistributor::GetMidiConfigurator(unsigned ind
 	return m_MidiConfigurator[index];
 }
 
-void GOrgueEventDistributor::SendMidi(const GOrgueMidiEvent& event)
+/* Values outside of the key layout fall back to the wildcard, which only
+ * makes the index less selective */
+uint64_t GOrgueEventDistributor::GetMidiIndexKey(unsigned device, int type, int channel, int key)
 {
+	if (channel < -1 || channel > 0xfe)
+		channel = -1;
+	if (key < -1 || key > 0xfffffe)
+		key = -1;
+	return ((uint64_t)device << 40) | ((uint64_t)(type & 0xff) << 32) | ((uint64_t)(channel + 1) << 24) | (uint64_t)(key + 1);
+}
+
+/* Called after loading and whenever a MIDI receiver configuration changed.
+ * SendMidi never rebuilds the index, so the caller must hold the organ
+ * model lock while the MIDI thread is playing. */
+void GOrgueEventDistributor::UpdateMidiIndex()
+{
+	std::vector<MIDI_DISPATCH_KEY> keys;
+
+	m_MidiIndex.clear();
+	m_MidiBroadcast.clear();
 	for(unsigned i = 0; i < m_handler.size(); i++)
-		m_handler[i]->ProcessMidi(event);
+	{
+		keys.clear();
+		if (!m_handler[i]->GetMidiKeys(keys))
+		{
+			m_MidiBroadcast.push_back(i);
+			continue;
+		}
+		for(unsigned j = 0; j < keys.size(); j++)
+		{
+			std::vector<unsigned>& list = m_MidiIndex[GetMidiIndexKey(keys[j].device, keys[j].type, keys[j].channel, keys[j].key)];
+			if (list.empty() || list.back() != i)
+				list.push_back(i);
+		}
+	}
+	m_MidiIndexValid = true;
+}
+
+void GOrgueEventDistributor::AddMidiTargets(unsigned device, int type, int channel, int key)
+{
+	std::unordered_map<uint64_t, std::vector<unsigned>>::const_iterator it = m_MidiIndex.find(GetMidiIndexKey(device, type, channel, key));
+	if (it != m_MidiIndex.end())
+		m_MidiTargets.insert(m_MidiTargets.end(), it->second.begin(), it->second.end());
+}
+
+/* Offers the event only to the handlers, which have a receiver configured
+ * for its device, type, channel and key (or a wildcard for them). The
+ * handlers are still called in registration order. The GrandOrgue setup
+ * messages change the receivers, so they go to every handler. Only the
+ * handlers selected by the mask are called. */
+void GOrgueEventDistributor::SendMidi(const GOrgueMidiEvent& event, unsigned handlers)
+{
+	midi_message_type type = event.GetMidiType();
+	if (type == MIDI_SYSEX_GO_CLEAR || type == MIDI_SYSEX_GO_SETUP || type == MIDI_SYSEX_GO_SAMPLESET)
+	{
+		for(unsigned i = 0; i < m_handler.size(); i++)
+			m_handler[i]->ProcessMidi(event);
+		UpdateMidiIndex();
+		return;
+	}
+	if (!m_MidiIndexValid)
+	{
+		for(unsigned i = 0; i < m_handler.size(); i++)
+			if (m_HandlerType[i] & handlers)
+				m_handler[i]->ProcessMidi(event);
+		return;
+	}
+
+	m_MidiTargets.assign(m_MidiBroadcast.begin(), m_MidiBroadcast.end());
+	unsigned device = event.GetDevice();
+	for(unsigned i = 0; i < (device ? 2 : 1); i++)
+	{
+		unsigned dev = i ? 0 : device;
+		AddMidiTargets(dev, type, event.GetChannel(), event.GetKey());
+		AddMidiTargets(dev, type, event.GetChannel(), -1);
+		AddMidiTargets(dev, type, -1, event.GetKey());
+		AddMidiTargets(dev, type, -1, -1);
+	}
+	std::sort(m_MidiTargets.begin(), m_MidiTargets.end());
+	m_MidiTargets.erase(std::unique(m_MidiTargets.begin(), m_MidiTargets.end()), m_MidiTargets.end());
+
+	/* A handler might send further events, so keep the buffer aside */
+	std::vector<unsigned> targets;
+	targets.swap(m_MidiTargets);
+	for(unsigned i = 0; i < targets.size(); i++)
+		if (m_HandlerType[targets[i]] & handlers)
+			m_handler[targets[i]]->ProcessMidi(event);
+	m_MidiTargets.swap(targets);
 }
 
 void GOrgueEventDistributor::HandleKey(int key)
@@ -7,6 +7,9 @@
 #ifndef GORGUEEVENTDISTRIBUTOR_H
 #define GORGUEEVENTDISTRIBUTOR_H
 
+#include "GOrgueMidiReceiverData.h"
+#include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
 class GOrgueCacheObject;
@@ -20,20 +23,34 @@ class GOrgueMidiEvent;
 class GOrguePlaybackStateHandler;
 class GOrgueSaveableObject;
 
+typedef enum {
+	MIDI_HANDLER_KEYS = 1,
+	MIDI_HANDLER_CONTROLS = 2,
+	MIDI_HANDLER_ALL = MIDI_HANDLER_KEYS | MIDI_HANDLER_CONTROLS,
+} MIDI_HANDLER_MASK;
+
 class GOrgueEventDistributor
 {
 private:
 	std::vector<GOrgueEventHandler*> m_handler;
+	std::vector<unsigned> m_HandlerType;
 	std::vector<GOrgueControlChangedHandler*> m_ControlChangedHandler;
 	std::vector<GOrguePlaybackStateHandler*> m_PlaybackStateHandler;
 	std::vector<GOrgueSaveableObject*> m_SaveableObjects;
 	std::vector<GOrgueMidiConfigurator*> m_MidiConfigurator;
 	std::vector<GOrgueCacheObject*> m_CacheObjects;
+	std::unordered_map<uint64_t, std::vector<unsigned>> m_MidiIndex;
+	std::vector<unsigned> m_MidiBroadcast;
+	std::vector<unsigned> m_MidiTargets;
+	bool m_MidiIndexValid;
+
+	static uint64_t GetMidiIndexKey(unsigned device, int type, int channel, int key);
+	void AddMidiTargets(unsigned device, int type, int channel, int key);
 
 protected:
 	void Cleanup();
 
-	void SendMidi(const GOrgueMidiEvent& event);
+	void SendMidi(const GOrgueMidiEvent& event, unsigned handlers = MIDI_HANDLER_ALL);
 
 	void ReadCombinations(GOrgueConfigReader& cfg);
 	void Save(GOrgueConfigWriter& cfg);
@@ -50,7 +67,7 @@ public:
 	GOrgueEventDistributor();
 	~GOrgueEventDistributor();
 
-	void RegisterEventHandler(GOrgueEventHandler* handler);
+	void RegisterEventHandler(GOrgueEventHandler* handler, bool keys = false);
 	void RegisterPlaybackStateHandler(GOrguePlaybackStateHandler* handler);
 	void RegisterControlChangedHandler(GOrgueControlChangedHandler* handler);
 	void RegisterCacheObject(GOrgueCacheObject* obj);
@@ -61,6 +78,7 @@ public:
 	GOrgueMidiConfigurator* GetMidiConfigurator(unsigned index);
 
 	void HandleKey(int key);
+	void UpdateMidiIndex();
 
 	unsigned GetCacheObjectCount();
 	GOrgueCacheObject* GetCacheObject(unsigned index);
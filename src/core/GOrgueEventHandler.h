@@ -7,6 +7,8 @@
 #ifndef GORGUEEVENTHANDLER_H
 #define GORGUEEVENTHANDLER_H
 
+#include "GOrgueMidiReceiverData.h"
+
 class GOrgueMidiEvent;
 
 class GOrgueEventHandler
@@ -18,6 +20,8 @@ public:
 
 	virtual void ProcessMidi(const GOrgueMidiEvent& event) = 0;
 	virtual void HandleKey(int key) = 0;
+	/* Returns false to receive every MIDI event */
+	virtual bool GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys) = 0;
 };
 
 #endif
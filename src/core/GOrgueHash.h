@@ -9,12 +9,23 @@
 
 #include "contrib/sha1.h"
 #include <wx/string.h>
+#include <string.h>
 
 typedef struct _GOrgueHashType
 {
 	uint8_t hash[20];
 } GOrgueHashType;
 
+inline bool operator==(const GOrgueHashType& a, const GOrgueHashType& b)
+{
+	return !memcmp(a.hash, b.hash, sizeof(a.hash));
+}
+
+inline bool operator<(const GOrgueHashType& a, const GOrgueHashType& b)
+{
+	return memcmp(a.hash, b.hash, sizeof(a.hash)) < 0;
+}
+
 class GOrgueHash
 {
 private:
@@ -10,6 +10,7 @@
 #include <wx/file.h>
 #include <wx/intl.h>
 #include <wx/log.h>
+#include <wx/stopwatch.h>
 #include <wx/utils.h>
 #ifdef __linux__
 #include <sys/mman.h>
@@ -24,26 +25,61 @@
 #include <sys/mman.h>
 #endif
 #include <errno.h>
+#include <new>
+#include <stdint.h>
 
 static inline void touchMemory(const char* pos)
 {
 	load_once(*pos);
 }
 
+/* Allocations up to a quarter of a region are bump allocated from the
+ * region of the calling thread, bigger ones get their own range. */
+#define POOL_REGION_SIZE (1024 * 1024)
+
+/* Every pool allocation starts with a header, which tells Free whether the
+ * address is a live allocation. It keeps the data POOL_ALIGN aligned. */
+#define POOL_ALIGN 16
+#define POOL_TAG_USED 0x474F504F4F4C5553ULL
+#define POOL_TAG_FREED 0x474F504F4F4C4652ULL
+
+typedef struct
+{
+	atomic<uint64_t> tag;
+	char padding[POOL_ALIGN - sizeof(atomic<uint64_t>)];
+} GOrgueMemoryPoolHeader;
+
+typedef struct
+{
+	const GOrgueMemoryPool* pool;
+	unsigned generation;
+	char* ptr;
+	char* end;
+} GOrgueMemoryPoolRegion;
+
+static thread_local GOrgueMemoryPoolRegion t_Region;
+static atomic_uint g_Generation(0);
+
 GOrgueMemoryPool::GOrgueMemoryPool() :
+	m_PoolAllocs(0),
+	m_Generation(0),
 	m_PoolStart(0),
-	m_PoolPtr(0),
+	m_PoolUsed(0),
 	m_PoolEnd(0),
 	m_CacheStart(0),
 	m_PoolSize(0),
 	m_PoolLimit(0),
 	m_PageSize(4096),
 	m_CacheSize(0),
+	m_CacheResident(true),
 	m_MallocSize(0),
 	m_MemoryLimit(0),
 	m_AllocError(0),
 	m_TouchPos(0),
-	m_TouchCache(false)
+	m_TouchCache(false),
+	m_LoadStart(0),
+	m_TimeToFirstNote(-1),
+	m_TimeToResident(-1)
 {
 	InitPool();
 }
@@ -57,25 +93,25 @@ bool inline GOrgueMemoryPool::InMemoryPool(void* ptr)
 {
 	if (m_CacheStart <= ptr && ptr <= m_CacheStart + m_CacheSize)
 	    return true;
-	if (m_PoolStart <= ptr && ptr <= m_PoolEnd)
+	if (m_PoolStart <= ptr && ptr < m_PoolStart + m_PoolLimit)
 		return true;
 	return false;
 }
 
 void *GOrgueMemoryPool::Alloc(size_t length, bool final)
 {
-	if (m_MemoryLimit && m_CacheSize + m_PoolSize + m_MallocSize > m_MemoryLimit)
+	size_t cache_size = m_CacheResident ? m_CacheSize : 0;
+	if (m_MemoryLimit && cache_size + m_PoolSize + m_MallocSize > m_MemoryLimit)
 		return NULL;
 	if (!final)
 		return malloc(length);
-	GOMutexLocker locker(m_mutex);
 	void* data = PoolAlloc(length);
 	if (data)
 	{
-		AddPoolAlloc(data);
+		m_PoolAllocs.fetch_add(1);
 		return data;
 	}
-	m_MallocSize += length;
+	m_MallocSize.fetch_add(length);
 	return malloc(length);
 }
 
@@ -83,15 +119,31 @@ void GOrgueMemoryPool::Free(void* data)
 {
 	if (!data)
 		return;
+	if (IsCacheData(data))
+	{
+		/* Records of the mapped cache may be shared, so only the count is
+		 * checked */
+		if (!m_PoolAllocs)
+			wxLogError(_("Invalid free of %p"), data);
+		else
+			m_PoolAllocs.fetch_add(-1);
+		return;
+	}
 	if (InMemoryPool(data))
 	{
-		GOMutexLocker locker(m_mutex);
-		if (m_PoolAllocs.count(data))
+		/* Pool memory is not individually freed, only marked */
+		char* ptr = (char*)data;
+		if (ptr < m_PoolStart + sizeof(GOrgueMemoryPoolHeader) || ptr >= m_PoolStart + m_PoolUsed || (ptr - m_PoolStart) % POOL_ALIGN)
 		{
-			/* Pool memory is not individually freed */
-			m_PoolAllocs.erase(m_PoolAllocs.find(data));
+			wxLogError(_("Invalid free of %p"), data);
 			return;
 		}
+		GOrgueMemoryPoolHeader* header = (GOrgueMemoryPoolHeader*)(ptr - sizeof(GOrgueMemoryPoolHeader));
+		uint64_t tag = POOL_TAG_USED;
+		if (header->tag.compare_exchange(tag, POOL_TAG_FREED))
+			m_PoolAllocs.fetch_add(-1);
+		else if (tag == POOL_TAG_FREED)
+			wxLogError(_("Double free of %p"), data);
 		else
 			wxLogError(_("Invalid free of %p"), data);
 		return;
@@ -117,46 +169,84 @@ void *GOrgueMemoryPool::MoveToPool(void* data, size_t length)
 	return new_data;
 }
 
-void GOrgueMemoryPool::AddPoolAlloc(void* data)
-{
-	m_PoolAllocs.insert(data);
-}
-
 void* GOrgueMemoryPool::PoolAlloc(size_t length)
 {
-	char* new_ptr;
-
 	if (!m_PoolStart)
 		return NULL;
-	if (!length)
-		length++;
+	length = (sizeof(GOrgueMemoryPoolHeader) + length + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+	if (length > POOL_REGION_SIZE / 4)
+		return PoolTag(PoolReserve(length));
 
-	new_ptr = m_PoolPtr + length;
-	if (m_PoolPtr <= new_ptr && new_ptr < m_PoolEnd)
+	GOrgueMemoryPoolRegion& region = t_Region;
+	if (region.pool != this || region.generation != m_Generation || (size_t)(region.end - region.ptr) < length)
 	{
-		void* data = m_PoolPtr;
-		m_PoolPtr += length;
-		m_AllocError = 0;
-		return data;
+		/* A failed region is not reported, if the length itself still fits */
+		char* start = PoolReserve(POOL_REGION_SIZE, false);
+		if (!start)
+			return PoolTag(PoolReserve(length));
+		region.pool = this;
+		region.generation = m_Generation;
+		region.ptr = start;
+		region.end = start + POOL_REGION_SIZE;
 	}
+	char* data = region.ptr;
+	region.ptr += length;
+	return PoolTag(data);
+}
 
-	GrowPool(length);
+void* GOrgueMemoryPool::PoolTag(char* data)
+{
+	if (!data)
+		return NULL;
+	GOrgueMemoryPoolHeader* header = new(data) GOrgueMemoryPoolHeader;
+	header->tag = POOL_TAG_USED;
+	return data + sizeof(GOrgueMemoryPoolHeader);
+}
 
-	new_ptr = m_PoolPtr + length;
-	if (m_PoolPtr <= new_ptr && new_ptr < m_PoolEnd)
+/* Claim the next length bytes of the pool and commit them if necessary */
+char* GOrgueMemoryPool::PoolReserve(size_t length, bool report)
+{
+	size_t offset = m_PoolUsed;
+	do
 	{
-		void* data = m_PoolPtr;
-		m_PoolPtr += length;
-		m_AllocError = 0;
-		return data;
+		if (offset + length > m_PoolLimit || offset + length < offset)
+		{
+			if (report)
+			{
+				GOMutexLocker locker(m_mutex);
+				ReportPoolFull(length);
+			}
+			return NULL;
+		}
+	}
+	while (!m_PoolUsed.compare_exchange(offset, offset + length));
+
+	if (offset + length > m_PoolSize)
+	{
+		GOMutexLocker locker(m_mutex);
+		if (offset + length > m_PoolSize)
+			GrowPool(offset + length - m_PoolSize);
+		if (offset + length > m_PoolSize)
+		{
+			if (report)
+				ReportPoolFull(length);
+			return NULL;
+		}
 	}
-	if (!m_AllocError++)
+	if (m_AllocError)
+		m_AllocError = 0;
+	return m_PoolStart + offset;
+}
+
+void GOrgueMemoryPool::ReportPoolFull(size_t length)
+{
+	if (!m_AllocError.fetch_add(1))
 	{
 		if (m_PoolSize + m_PageSize < m_PoolLimit)
 		{
 			wxLogError(wxT("PoolAlloc failed: %d %llu %llu %llu %p %p %p"),
 				   length, (unsigned long long)m_PoolSize, (unsigned long long)m_PoolLimit, 
-				   (unsigned long long)m_PoolIncrement, m_PoolStart, m_PoolPtr, m_PoolEnd);
+				   (unsigned long long)m_PoolIncrement, m_PoolStart, m_PoolStart + m_PoolUsed, m_PoolEnd);
 		}
 		else
 		{
@@ -166,26 +256,48 @@ void* GOrgueMemoryPool::PoolAlloc(size_t length)
 			#endif
 		}
 	}
-	return NULL;
 }
 
-void *GOrgueMemoryPool::GetCacheData(size_t offset, size_t length)
+void *GOrgueMemoryPool::GetCacheData(size_t offset, size_t length, bool touch)
 {
 	if (!length)
 		return NULL;
 	if (m_CacheStart)
 	{
 		char* data = m_CacheStart + offset;
-		for (unsigned i = 0; i < length; i+= m_PageSize)
-			touchMemory(data + i);
-		if (length)
+		if (touch)
+		{
+			for (unsigned i = 0; i < length; i+= m_PageSize)
+				touchMemory(data + i);
 			touchMemory(data + length - 1);
-		AddPoolAlloc(data);
+		}
+		m_PoolAllocs.fetch_add(1);
 		return data;
 	}
 	return NULL;
 }
 
+const char* GOrgueMemoryPool::GetCacheStart()
+{
+	return m_CacheStart;
+}
+
+bool GOrgueMemoryPool::IsCacheData(const void* data)
+{
+	return m_CacheStart <= data && data < m_CacheStart + m_CacheSize;
+}
+
+/* Must be set before the cache file is opened */
+void GOrgueMemoryPool::SetCacheResident(bool resident)
+{
+	m_CacheResident = resident;
+}
+
+bool GOrgueMemoryPool::IsCacheResident()
+{
+	return m_CacheResident;
+}
+
 void GOrgueMemoryPool::FreeCacheFile()
 {
 	FreePool();
@@ -217,6 +329,32 @@ size_t GOrgueMemoryPool::GetMemoryLimit()
 	return m_MemoryLimit;
 }
 
+void GOrgueMemoryPool::StartLoad()
+{
+	m_LoadStart = wxGetLocalTimeMillis();
+	m_TimeToFirstNote = -1;
+	m_TimeToResident = -1;
+	m_TouchPos = 0;
+	m_TouchCache = m_CacheResident;
+}
+
+void GOrgueMemoryPool::FinishLoad()
+{
+	m_TimeToFirstNote = (wxGetLocalTimeMillis() - m_LoadStart).ToLong();
+	if (!m_CacheSize || !m_CacheResident)
+		m_TimeToResident = m_TimeToFirstNote;
+}
+
+long GOrgueMemoryPool::GetTimeToFirstNote()
+{
+	return m_TimeToFirstNote;
+}
+
+long GOrgueMemoryPool::GetTimeToResident()
+{
+	return m_TimeToResident;
+}
+
 bool GOrgueMemoryPool::IsPoolFull()
 {
 	return m_AllocError > 0;
@@ -361,8 +499,9 @@ void GOrgueMemoryPool::CalculatePoolLimit()
 {
 	size_t vma = GetVMALimit();
 	size_t memory = GetSystemMemory();
-	if (memory > m_CacheSize)
-		memory -= m_CacheSize;
+	size_t cache_size = m_CacheResident ? m_CacheSize : 0;
+	if (memory > cache_size)
+		memory -= cache_size;
 	else
 		memory = 0;
 	m_PoolLimit = std::min (memory, vma);
@@ -390,7 +529,9 @@ bool GOrgueMemoryPool::AllocatePool()
 void GOrgueMemoryPool::InitPool()
 {
 	m_AllocError = 0;
+	m_Generation = g_Generation.fetch_add(1) + 1;
 	m_PoolStart = 0;
+	m_PoolUsed = 0;
 	m_PoolSize = 0;
 	m_PageSize = GetPageSize();
 	CalculatePoolLimit();
@@ -408,13 +549,12 @@ void GOrgueMemoryPool::InitPool()
 		}
 		m_PoolLimit -= 1000 * m_PageSize;
 	}
-	m_PoolPtr = m_PoolStart;
 	m_PoolEnd = m_PoolStart + m_PoolSize;
 }
 
 void GOrgueMemoryPool::FreePool()
 {
-	if (m_PoolAllocs.size())
+	if (m_PoolAllocs)
 	{
 		wxLogError(wxT("Freeing non-empty memory pool"));
 	}
@@ -470,6 +610,8 @@ void GOrgueMemoryPool::TouchMemory(bool& stop)
 			if (load_once(stop) || i > 1000)
 				return;
 		}
+		if (m_TimeToResident < 0 && m_TimeToFirstNote >= 0)
+			m_TimeToResident = (wxGetLocalTimeMillis() - m_LoadStart).ToLong();
 	}
 	else
 	{
@@ -480,5 +622,6 @@ void GOrgueMemoryPool::TouchMemory(bool& stop)
 				return;
 		}
 	}
-	m_TouchCache = !m_TouchCache;
+	m_TouchPos = 0;
+	m_TouchCache = !m_TouchCache && m_CacheResident;
 }
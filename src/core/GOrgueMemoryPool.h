@@ -7,34 +7,53 @@
 #ifndef GORGUEMEMORYPOOL_H_
 #define GORGUEMEMORYPOOL_H_
 
+#include "threading/atomic.h"
 #include "threading/GOMutex.h"
-#include <set>
+#include "GOrgueTime.h"
+#include <stddef.h>
 
 class wxFile;
 
+/* The pool is a reserved address range, which is committed as it fills.
+ * Every thread bump allocates from its own region of the pool, so Alloc
+ * and Free do not lock. Pool memory is never freed individually: Free
+ * only marks the header of the allocation, so invalid and double frees
+ * are reported, and counts the live allocations. Only committing more of
+ * the range takes m_mutex. */
 class GOrgueMemoryPool {
 	GOMutex m_mutex;
-	std::set<void*> m_PoolAllocs;
+	/* Live allocations in the pool and in the mapped cache. Records of
+	 * identical objects can share mapped cache data. */
+	atomic<size_t> m_PoolAllocs;
+	/* Unique per InitPool of any pool, invalidates the thread regions */
+	unsigned m_Generation;
 	char* m_PoolStart;
-	char* m_PoolPtr;
+	atomic<size_t> m_PoolUsed;
 	char* m_PoolEnd;
 	char* m_CacheStart;
-	size_t m_PoolSize;
+	atomic<size_t> m_PoolSize;
 	size_t m_PoolLimit;
 	size_t m_PoolIncrement;
 	size_t m_PageSize;
 	size_t m_CacheSize;
-	size_t m_MallocSize;
+	/* If not set, the mapped cache is streamed and not kept in memory */
+	bool m_CacheResident;
+	atomic<size_t> m_MallocSize;
 	size_t m_MemoryLimit;
-	unsigned m_AllocError;
+	atomic_uint m_AllocError;
 	size_t m_TouchPos;
 	bool m_TouchCache;
+	GOTime m_LoadStart;
+	long m_TimeToFirstNote;
+	long m_TimeToResident;
 
 	void InitPool();
 	void GrowPool(size_t size);
 	void FreePool();
 	void* PoolAlloc(size_t length);
-	void AddPoolAlloc(void* data);
+	void* PoolTag(char* data);
+	char* PoolReserve(size_t length, bool report = true);
+	void ReportPoolFull(size_t length);
 
 	static size_t GetVMALimit();
 	static size_t GetSystemMemory();
@@ -52,7 +71,13 @@ public:
 	void *MoveToPool(void* data, size_t length);
 	void Free(void* data);
 
-	void *GetCacheData(size_t offset, size_t length);
+	/* Return a block of the mapped cache file. Unless touch is set, its
+	 * pages are only read in on first use or by TouchMemory. */
+	void *GetCacheData(size_t offset, size_t length, bool touch = true);
+	const char* GetCacheStart();
+	bool IsCacheData(const void* data);
+	void SetCacheResident(bool resident);
+	bool IsCacheResident();
 	bool SetCacheFile(wxFile& cache_file);
 	void FreeCacheFile();
 
@@ -63,6 +88,14 @@ public:
 	size_t GetPoolUsage();
 	size_t GetMemoryLimit();
 
+	/* Load timing: the organ is playable after the time to first note, the
+	 * mapped cache is completely in memory after the time to resident.
+	 * Both are in ms, -1 if not reached yet. */
+	void StartLoad();
+	void FinishLoad();
+	long GetTimeToFirstNote();
+	long GetTimeToResident();
+
 	static size_t GetSystemMemoryLimit();
 	static size_t GetPageSize();
 };
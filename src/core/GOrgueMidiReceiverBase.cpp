@@ -11,6 +11,7 @@
 #include "GOrgueMidiEvent.h"
 #include "GOrgueMidiMap.h"
 #include "GOrgueRodgers.h"
+#include <algorithm>
 
 GOrgueMidiReceiverBase::GOrgueMidiReceiverBase(MIDI_RECEIVER_TYPE type):
 	GOrgueMidiReceiverData(type),
@@ -825,6 +826,149 @@ MIDI_MATCH_TYPE GOrgueMidiReceiverBase::Match(const GOrgueMidiEvent& e, const un
 	return MIDI_MATCH_NONE;
 }
 
+static void AddMidiKey(std::vector<MIDI_DISPATCH_KEY>& keys, unsigned device, int type, int channel, int key)
+{
+	MIDI_DISPATCH_KEY k = { device, type, channel, key };
+	keys.push_back(k);
+}
+
+/* Collects the keys of all events Match may react on, so the organ only
+ * offers these events to the receiver. Returns false, if the receiver must
+ * see every event. */
+bool GOrgueMidiReceiverBase::GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys)
+{
+	for(unsigned i = 0; i < m_Internal.size(); i++)
+	{
+		unsigned device = m_Internal[i].device;
+		int channel = m_Internal[i].channel;
+		if (channel == -1)
+			continue;
+		if (m_type == MIDI_RECV_MANUAL)
+		{
+			AddMidiKey(keys, device, MIDI_NOTE, channel, -1);
+			AddMidiKey(keys, device, MIDI_CTRL_CHANGE, channel, MIDI_CTRL_NOTES_OFF);
+		}
+		else
+			AddMidiKey(keys, device, MIDI_NRPN, channel, m_Internal[i].key);
+	}
+
+	for(unsigned i = 0; i < m_events.size(); i++)
+	{
+		const MIDI_MATCH_EVENT& event = m_events[i];
+		unsigned device = event.device;
+		int channel = HasChannel(event.type) ? event.channel : -1;
+		int key = event.key;
+
+		if (m_type == MIDI_RECV_MANUAL)
+		{
+			if (event.type != MIDI_M_NOTE && event.type != MIDI_M_NOTE_NO_VELOCITY &&
+			    event.type != MIDI_M_NOTE_SHORT_OCTAVE && event.type != MIDI_M_NOTE_NORMAL)
+				continue;
+			for(int k = std::max(event.low_key, 0); k <= std::min(event.high_key, 127); k++)
+			{
+				AddMidiKey(keys, device, MIDI_NOTE, channel, k);
+				AddMidiKey(keys, device, MIDI_AFTERTOUCH, channel, k);
+			}
+			AddMidiKey(keys, device, MIDI_CTRL_CHANGE, channel, MIDI_CTRL_NOTES_OFF);
+			AddMidiKey(keys, device, MIDI_CTRL_CHANGE, channel, MIDI_CTRL_SOUNDS_OFF);
+			continue;
+		}
+		if (m_type == MIDI_RECV_ENCLOSURE)
+		{
+			if (event.type == MIDI_M_CTRL_CHANGE)
+				AddMidiKey(keys, device, MIDI_CTRL_CHANGE, channel, key);
+			else if (event.type == MIDI_M_RPN)
+				AddMidiKey(keys, device, MIDI_RPN, channel, key);
+			else if (event.type == MIDI_M_NRPN)
+				AddMidiKey(keys, device, MIDI_NRPN, channel, key);
+			else if (event.type == MIDI_M_PGM_RANGE)
+				AddMidiKey(keys, device, MIDI_PGM_CHANGE, channel, -1);
+			continue;
+		}
+
+		switch(event.type)
+		{
+		case MIDI_M_NONE:
+			break;
+
+		case MIDI_M_NOTE:
+		case MIDI_M_NOTE_ON:
+		case MIDI_M_NOTE_OFF:
+		case MIDI_M_NOTE_ON_OFF:
+			AddMidiKey(keys, device, MIDI_NOTE, channel, key);
+			break;
+
+		case MIDI_M_CTRL_CHANGE:
+		case MIDI_M_CTRL_CHANGE_ON:
+		case MIDI_M_CTRL_CHANGE_OFF:
+		case MIDI_M_CTRL_CHANGE_ON_OFF:
+		case MIDI_M_CTRL_CHANGE_FIXED:
+		case MIDI_M_CTRL_CHANGE_FIXED_ON:
+		case MIDI_M_CTRL_CHANGE_FIXED_OFF:
+		case MIDI_M_CTRL_CHANGE_FIXED_ON_OFF:
+		case MIDI_M_CTRL_BIT:
+			AddMidiKey(keys, device, MIDI_CTRL_CHANGE, channel, key);
+			break;
+
+		case MIDI_M_RPN:
+		case MIDI_M_RPN_ON:
+		case MIDI_M_RPN_OFF:
+		case MIDI_M_RPN_ON_OFF:
+			AddMidiKey(keys, device, MIDI_RPN, channel, key);
+			break;
+
+		case MIDI_M_NRPN:
+		case MIDI_M_NRPN_ON:
+		case MIDI_M_NRPN_OFF:
+		case MIDI_M_NRPN_ON_OFF:
+			AddMidiKey(keys, device, MIDI_NRPN, channel, key);
+			break;
+
+		case MIDI_M_RPN_RANGE:
+			AddMidiKey(keys, device, MIDI_RPN, channel, -1);
+			break;
+
+		case MIDI_M_NRPN_RANGE:
+			AddMidiKey(keys, device, MIDI_NRPN, channel, -1);
+			break;
+
+		case MIDI_M_PGM_CHANGE:
+			AddMidiKey(keys, device, MIDI_PGM_CHANGE, channel, key);
+			break;
+
+		case MIDI_M_PGM_RANGE:
+			AddMidiKey(keys, device, MIDI_PGM_CHANGE, channel, -1);
+			break;
+
+		case MIDI_M_SYSEX_JOHANNUS_9:
+			AddMidiKey(keys, device, MIDI_SYSEX_JOHANNUS_9, channel, key);
+			break;
+
+		case MIDI_M_SYSEX_JOHANNUS_11:
+			AddMidiKey(keys, device, MIDI_SYSEX_JOHANNUS_11, channel, key);
+			break;
+
+		case MIDI_M_SYSEX_VISCOUNT:
+		case MIDI_M_SYSEX_VISCOUNT_TOGGLE:
+			AddMidiKey(keys, device, MIDI_SYSEX_VISCOUNT, channel, -1);
+			break;
+
+		case MIDI_M_SYSEX_RODGERS_STOP_CHANGE:
+			AddMidiKey(keys, device, MIDI_SYSEX_RODGERS_STOP_CHANGE, channel, -1);
+			break;
+
+		case MIDI_M_SYSEX_AHLBORN_GALANTI:
+		case MIDI_M_SYSEX_AHLBORN_GALANTI_TOGGLE:
+			AddMidiKey(keys, device, MIDI_SYSEX_AHLBORN_GALANTI, channel, -1);
+			break;
+
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
 void GOrgueMidiReceiverBase::Assign(const GOrgueMidiReceiverData& data)
 {
 	*(GOrgueMidiReceiverData*)this = data;
@@ -49,6 +49,7 @@ public:
 	MIDI_MATCH_TYPE Match(const GOrgueMidiEvent& e);
  	MIDI_MATCH_TYPE Match(const GOrgueMidiEvent& e, int& value);
  	MIDI_MATCH_TYPE Match(const GOrgueMidiEvent& e, const unsigned midi_map[128], int& key, int& value);
+	bool GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys);
 
 	bool HasDebounce(midi_match_message_type type);
 	bool HasChannel(midi_match_message_type type);
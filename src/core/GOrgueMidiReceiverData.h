@@ -78,6 +78,14 @@ typedef struct {
 	unsigned debounce_time;
 } MIDI_MATCH_EVENT;
 
+/* Event routing key, device 0, channel -1 and key -1 match any value */
+typedef struct {
+	unsigned device;
+	int type;
+	int channel;
+	int key;
+} MIDI_DISPATCH_KEY;
+
 class GOrgueMidiReceiverData
 {
 protected:
@@ -9,9 +9,11 @@
 #include "GOrgueTimerCallback.h"
 #include "threading/GOMutexLocker.h"
 
-GOrgueTimer::GOrgueTimer() :
+/* The callbacks are called with callback_lock held, if given */
+GOrgueTimer::GOrgueTimer(GOMutex* callback_lock) :
 	wxTimer(),
-	m_Entries()
+	m_Entries(),
+	m_CallbackLock(callback_lock)
 {
 }
 
@@ -86,6 +88,8 @@ void GOrgueTimer::Schedule()
 void GOrgueTimer::Notify()
 {
 	GOMutexLocker locker(m_Lock);
+	if (m_CallbackLock)
+		m_CallbackLock->Lock();
 
 	GOTime now = wxGetLocalTimeMillis();
 	for(unsigned i = 0; i < m_Entries.size(); i++)
@@ -101,5 +105,7 @@ void GOrgueTimer::Notify()
 			else
 				m_Entries[i].callback = NULL;
 		}
+	if (m_CallbackLock)
+		m_CallbackLock->Unlock();
 	Schedule();
 }
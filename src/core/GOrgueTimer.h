@@ -25,12 +25,13 @@ class GOrgueTimer : private wxTimer
 private:
 	std::vector<GOrgueTimerEntry> m_Entries;
 	GOMutex m_Lock;
+	GOMutex* m_CallbackLock;
 
  	void Schedule();
 	void Notify();
 
 public:
-	GOrgueTimer();
+	GOrgueTimer(GOMutex* callback_lock = NULL);
 	~GOrgueTimer();
 
 	void SetTimer(GOTime time, GOrgueTimerCallback* callback, unsigned interval = 0);
@@ -338,13 +338,6 @@ unsigned GOrgueWave::GetLength() const
 	return m_SampleData.GetSize() / (m_BytesPerSample * m_Channels);
 }
 
-template<class T>
-void GOrgueWave::writeNext(uint8_t*& output, const T& value)
-{
-	*(T*)output = value;
-	output += sizeof(T);
-}
-
 template<class T>
 T GOrgueWave::readNext(const uint8_t*& input)
 {
@@ -353,6 +346,143 @@ T GOrgueWave::readNext(const uint8_t*& input)
 	return val;
 }
 
+/* The conversion kernels of ReadSamples: one loop per combination of
+ * source format, target format and channel mapping, without branches in
+ * the loop, so the compiler can vectorize it.
+ *
+ * Readers return the sample with 24 fractional bits of precision. */
+struct GOWaveInt8Reader
+{
+	static int Read(const uint8_t* input, unsigned pos)
+	{
+		return (((const int8_t*)input)[pos] - 0x80) << 16;
+	}
+};
+
+struct GOWaveInt16Reader
+{
+	static int Read(const uint8_t* input, unsigned pos)
+	{
+		return ((int16_t)((const GOInt16LE*)input)[pos]) << 8;
+	}
+};
+
+struct GOWaveInt24Reader
+{
+	static int Read(const uint8_t* input, unsigned pos)
+	{
+		GOInt24LE val = ((const GOInt24LE*)input)[pos];
+		return val;
+	}
+};
+
+struct GOWaveFloatReader
+{
+	static int Read(const uint8_t* input, unsigned pos)
+	{
+		return ((const float*)input)[pos] * (float)(1 << 23);
+	}
+};
+
+/* Unpacked WavPack data: one int32 per sample */
+template<unsigned SHIFT>
+struct GOWavePackedReader
+{
+	static int Read(const uint8_t* input, unsigned pos)
+	{
+		return ((const int32_t*)input)[pos] << SHIFT;
+	}
+};
+
+struct GOWaveInt8Writer
+{
+	static void Write(uint8_t* output, unsigned pos, int value, unsigned shift)
+	{
+		((int8_t*)output)[pos] = value >> 16;
+	}
+};
+
+struct GOWaveInt16Writer
+{
+	static void Write(uint8_t* output, unsigned pos, int value, unsigned shift)
+	{
+		((int16_t*)output)[pos] = value >> shift;
+	}
+};
+
+struct GOWaveInt24Writer
+{
+	static void Write(uint8_t* output, unsigned pos, int value, unsigned shift)
+	{
+		((GOInt24*)output)[pos] = value >> shift;
+	}
+};
+
+struct GOWaveFloatWriter
+{
+	static void Write(uint8_t* output, unsigned pos, int value, unsigned shift)
+	{
+		((float*)output)[pos] = value / (float)(1 << 23);
+	}
+};
+
+template<class R, class W>
+static void ConvertCopy(const uint8_t* input, uint8_t* output, unsigned count, unsigned shift)
+{
+	for(unsigned i = 0; i < count; i++)
+		W::Write(output, i, R::Read(input, i), shift);
+}
+
+template<class R, class W>
+static void ConvertSelect(const uint8_t* input, uint8_t* output, unsigned count, unsigned channels, unsigned channel, unsigned shift)
+{
+	for(unsigned i = 0; i < count; i++)
+		W::Write(output, i, R::Read(input, i * channels + channel), shift);
+}
+
+/* CHANNELS is 0 if the channel count is only known at runtime */
+template<class R, class W, unsigned CHANNELS>
+static void ConvertMix(const uint8_t* input, uint8_t* output, unsigned count, unsigned channels, unsigned shift)
+{
+	if (CHANNELS)
+		channels = CHANNELS;
+	for(unsigned i = 0; i < count; i++)
+	{
+		int value = 0;
+		for(unsigned j = 0; j < channels; j++)
+			value += R::Read(input, i * channels + j);
+		W::Write(output, i, value / (int)channels, shift);
+	}
+}
+
+template<class R, class W>
+static void ConvertChannels(const uint8_t* input, uint8_t* output, unsigned count, unsigned merge_count, unsigned select_channel, unsigned shift)
+{
+	if (select_channel)
+		ConvertSelect<R, W>(input, output, count, merge_count, select_channel - 1, shift);
+	else if (merge_count == 2)
+		ConvertMix<R, W, 2>(input, output, count, merge_count, shift);
+	else if (merge_count > 1)
+		ConvertMix<R, W, 0>(input, output, count, merge_count, shift);
+	else
+		ConvertCopy<R, W>(input, output, count, shift);
+}
+
+template<class R>
+static void ConvertFrom(const uint8_t* input, uint8_t* output, unsigned count, unsigned merge_count, unsigned select_channel, GOrgueWave::SAMPLE_FORMAT format)
+{
+	if (format == GOrgueWave::SF_SIGNEDBYTE_8)
+		ConvertChannels<R, GOWaveInt8Writer>(input, output, count, merge_count, select_channel, 16);
+	else if (format >= GOrgueWave::SF_SIGNEDSHORT_9 && format <= GOrgueWave::SF_SIGNEDSHORT_16)
+		ConvertChannels<R, GOWaveInt16Writer>(input, output, count, merge_count, select_channel, 24 - format);
+	else if (format >= GOrgueWave::SF_SIGNEDINT24_17 && format <= GOrgueWave::SF_SIGNEDINT24_24)
+		ConvertChannels<R, GOWaveInt24Writer>(input, output, count, merge_count, select_channel, 24 - format);
+	else if (format == GOrgueWave::SF_IEEE_FLOAT)
+		ConvertChannels<R, GOWaveFloatWriter>(input, output, count, merge_count, select_channel, 0);
+	else
+		throw (wxString)_("bad return format!");
+}
+
 void GOrgueWave::ReadSamples
 	(void* dest_buffer                        /** Pointer to received sample data */
 	,GOrgueWave::SAMPLE_FORMAT read_format    /** Format of the above buffer */
@@ -387,114 +517,39 @@ void GOrgueWave::ReadSamples
 	uint8_t* output = (uint8_t*)dest_buffer;
 
 	unsigned len = m_Channels * GetLength() / merge_count;
-	for(unsigned i = 0; i < len; i++)
+	if (m_isPacked && m_BytesPerSample != 4)
 	{
-		int value = 0; /* Value will be stored with 24 fractional bits of precision */
-		for (unsigned j = 0; j < merge_count; j++)
-		{
-			int val; /* Value will be stored with 24 fractional bits of precision */
-			if (m_isPacked && m_BytesPerSample != 4)
-			{
-				val = readNext<int32_t>(input);
-				switch(m_BytesPerSample)
-				{
-				case 1:
-					val <<= 16;
-					break;
-				case 2:
-					val <<= 8;
-					break;
-				}
-			}
-			else
-			{
-				switch(m_BytesPerSample)
-				{
-				case 1:
-					val = readNext<GOInt8>(input) - 0x80;
-					val <<= 16;
-					break;
-				case 2:
-					val = readNext<GOInt16LE>(input);
-					val <<= 8;
-					break;
-				case 3:
-					val = readNext<GOInt24LE>(input);
-					break;
-				case 4:
-					val = readNext<float>(input) * (float)(1 << 23);
-					break;
-				default:
-					throw (wxString)_("bad format!");
-				}
-			}
-
-			if (select_channel && select_channel != j + 1)
-				continue;
-			value += val;
-		}
-		if (select_channel == 0 && merge_count > 1)
-			value = value / (int)merge_count;
-
-		switch (read_format)
+		switch(m_BytesPerSample)
 		{
-		case SF_SIGNEDBYTE_8:
-			writeNext<GOInt8>(output, value >> 16);
-			break;
-		case SF_SIGNEDSHORT_9:
-			writeNext<GOInt16>(output, value >> 15);
-			break;
-		case SF_SIGNEDSHORT_10:
-			writeNext<GOInt16>(output, value >> 14);
-			break;
-		case SF_SIGNEDSHORT_11:
-			writeNext<GOInt16>(output, value >> 13);
-			break;
-		case SF_SIGNEDSHORT_12:
-			writeNext<GOInt16>(output, value >> 12);
-			break;
-		case SF_SIGNEDSHORT_13:
-			writeNext<GOInt16>(output, value >> 11);
-			break;
-		case SF_SIGNEDSHORT_14:
-			writeNext<GOInt16>(output, value >> 10);
-			break;
-		case SF_SIGNEDSHORT_15:
-			writeNext<GOInt16>(output, value >> 9);
-			break;
-		case SF_SIGNEDSHORT_16:
-			writeNext<GOInt16>(output, value >> 8);
-			break;
-		case SF_SIGNEDINT24_17:
-			writeNext<GOInt24>(output, value >> 7);
-			break;
-		case SF_SIGNEDINT24_18:
-			writeNext<GOInt24>(output, value >> 6);
+		case 1:
+			ConvertFrom<GOWavePackedReader<16> >(input, output, len, merge_count, select_channel, read_format);
 			break;
-		case SF_SIGNEDINT24_19:
-			writeNext<GOInt24>(output, value >> 5);
-			break;
-		case SF_SIGNEDINT24_20:
-			writeNext<GOInt24>(output, value >> 4);
-			break;
-		case SF_SIGNEDINT24_21:
-			writeNext<GOInt24>(output, value >> 3);
-			break;
-		case SF_SIGNEDINT24_22:
-			writeNext<GOInt24>(output, value >> 2);
-			break;
-		case SF_SIGNEDINT24_23:
-			writeNext<GOInt24>(output, value >> 1);
-			break;
-		case SF_SIGNEDINT24_24:
-			writeNext<GOInt24>(output, value);
-			break;
-		case SF_IEEE_FLOAT:
-			writeNext<float>(output, value / (float)(1 << 23));
+		case 2:
+			ConvertFrom<GOWavePackedReader<8> >(input, output, len, merge_count, select_channel, read_format);
 			break;
 		default:
-			throw (wxString)_("bad return format!");
+			ConvertFrom<GOWavePackedReader<0> >(input, output, len, merge_count, select_channel, read_format);
+			break;
 		}
+		return;
+	}
+
+	switch(m_BytesPerSample)
+	{
+	case 1:
+		ConvertFrom<GOWaveInt8Reader>(input, output, len, merge_count, select_channel, read_format);
+		break;
+	case 2:
+		ConvertFrom<GOWaveInt16Reader>(input, output, len, merge_count, select_channel, read_format);
+		break;
+	case 3:
+		ConvertFrom<GOWaveInt24Reader>(input, output, len, merge_count, select_channel, read_format);
+		break;
+	case 4:
+		ConvertFrom<GOWaveFloatReader>(input, output, len, merge_count, select_channel, read_format);
+		break;
+	default:
+		throw (wxString)_("bad format!");
 	}
 }
 
@@ -39,8 +39,6 @@ private:
 	void LoadCueChunk(const uint8_t* ptr, unsigned long length);
 	void LoadSamplerChunk(const uint8_t* ptr, unsigned long length);
 	template<class T>
-	static void writeNext(uint8_t*& output, const T& value);
-	template<class T>
 	static T readNext(const uint8_t*& input);
 
 public:
@@ -0,0 +1,82 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOMPSCQUEUE_H
+#define GOMPSCQUEUE_H
+
+#include "atomic.h"
+
+/* Bounded queue for several producers and one consumer without locks.
+ *
+ * Every cell carries a sequence number: a producer claims the cell whose
+ * sequence equals its position, fills it and publishes it by advancing the
+ * sequence. The consumer takes a cell once its sequence is one past its
+ * position and hands it back one lap later. SIZE must be a power of two so
+ * the positions may wrap around. */
+template<class T, unsigned SIZE>
+class GOMpscQueue
+{
+private:
+	static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+	struct Cell
+	{
+		atomic_uint sequence;
+		T data;
+	};
+
+	Cell m_Cells[SIZE];
+	atomic_uint m_Head;
+	unsigned m_Tail;
+
+	GOMpscQueue(const GOMpscQueue&) = delete;
+	const GOMpscQueue& operator=(const GOMpscQueue&) = delete;
+
+public:
+	GOMpscQueue() :
+		m_Head(0),
+		m_Tail(0)
+	{
+		for(unsigned i = 0; i < SIZE; i++)
+			m_Cells[i].sequence = i;
+	}
+
+	/* Returns false if the queue is full */
+	bool Push(const T& value)
+	{
+		unsigned pos = m_Head;
+		Cell* cell;
+		do
+		{
+			cell = &m_Cells[pos % SIZE];
+			int diff = (int)(cell->sequence - pos);
+			if (diff < 0)
+				return false;
+			if (diff > 0)
+				pos = m_Head;
+			else if (m_Head.compare_exchange(pos, pos + 1))
+				break;
+		}
+		while(true);
+		cell->data = value;
+		cell->sequence = pos + 1;
+		return true;
+	}
+
+	/* Only called by the consumer */
+	bool Pop(T& value)
+	{
+		Cell* cell = &m_Cells[m_Tail % SIZE];
+		if ((int)(cell->sequence - (m_Tail + 1)) < 0)
+			return false;
+		value = cell->data;
+		cell->sequence = m_Tail + SIZE;
+		m_Tail++;
+		return true;
+	}
+};
+
+#endif
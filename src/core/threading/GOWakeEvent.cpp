@@ -0,0 +1,121 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOWakeEvent.h"
+
+#include "threading_impl.h"
+
+#if defined __linux__
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined __WIN32__
+#include <windows.h>
+#endif
+
+#if defined __linux__
+
+GOWakeEvent::GOWakeEvent() :
+  m_State(0)
+{
+}
+
+GOWakeEvent::~GOWakeEvent()
+{
+}
+
+bool GOWakeEvent::Wait()
+{
+  while (true)
+  {
+    int state = 1;
+    if (m_State.compare_exchange_strong(state, 0))
+      return true;
+    if (state == 0 && !m_State.compare_exchange_strong(state, 2))
+      continue;
+
+    struct timespec timeout = { WAIT_TIMEOUT_MS / 1000, (WAIT_TIMEOUT_MS % 1000) * 1000000L };
+    if (syscall(SYS_futex, (int*)&m_State, FUTEX_WAIT_PRIVATE, 2, &timeout, NULL, 0) == -1 && errno == ETIMEDOUT)
+      return m_State.exchange(0) == 1;
+  }
+}
+
+void GOWakeEvent::Set()
+{
+  if (m_State.exchange(1) == 2)
+    syscall(SYS_futex, (int*)&m_State, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+#elif defined __WXMAC__
+
+GOWakeEvent::GOWakeEvent() :
+  m_Semaphore(dispatch_semaphore_create(0))
+{
+}
+
+GOWakeEvent::~GOWakeEvent()
+{
+  dispatch_release(m_Semaphore);
+}
+
+/* The semaphore counts the Set calls, so the waiter may wake up once
+ * more than necessary */
+bool GOWakeEvent::Wait()
+{
+  return !dispatch_semaphore_wait(m_Semaphore, dispatch_time(DISPATCH_TIME_NOW, WAIT_TIMEOUT_MS * 1000000LL));
+}
+
+void GOWakeEvent::Set()
+{
+  dispatch_semaphore_signal(m_Semaphore);
+}
+
+#elif defined __WIN32__
+
+GOWakeEvent::GOWakeEvent() :
+  m_Event(CreateEvent(NULL, FALSE, FALSE, NULL))
+{
+}
+
+GOWakeEvent::~GOWakeEvent()
+{
+  CloseHandle((HANDLE)m_Event);
+}
+
+bool GOWakeEvent::Wait()
+{
+  return WaitForSingleObject((HANDLE)m_Event, WAIT_TIMEOUT_MS) == WAIT_OBJECT_0;
+}
+
+void GOWakeEvent::Set()
+{
+  SetEvent((HANDLE)m_Event);
+}
+
+#else
+
+GOWakeEvent::GOWakeEvent() :
+  m_Wait()
+{
+}
+
+GOWakeEvent::~GOWakeEvent()
+{
+}
+
+bool GOWakeEvent::Wait()
+{
+  return m_Wait.Wait(true);
+}
+
+void GOWakeEvent::Set()
+{
+  m_Wait.Wakeup();
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOWAKEEVENT_H
+#define GOWAKEEVENT_H
+
+#if defined __linux__
+  #include <atomic>
+#elif defined __WXMAC__
+  #include <dispatch/dispatch.h>
+#elif !defined __WIN32__
+  #include "GOWaitQueue.h"
+#endif
+
+/* Auto reset event for a single waiting thread. Set never takes a lock,
+ * so it may be called from the audio callbacks: Linux uses a futex, which
+ * is only entered to wake a sleeping waiter, Windows a kernel event and
+ * macOS a dispatch semaphore. Other systems fall back to GOWaitQueue. */
+class GOWakeEvent
+{
+private:
+#if defined __linux__
+  /* 0: not set, 1: set, 2: not set and the waiter sleeps */
+  std::atomic<int> m_State;
+#elif defined __WXMAC__
+  dispatch_semaphore_t m_Semaphore;
+#elif defined __WIN32__
+  void* m_Event;
+#else
+  GOWaitQueue m_Wait;
+#endif
+
+  GOWakeEvent(const GOWakeEvent&) = delete;
+  const GOWakeEvent& operator=(const GOWakeEvent&) = delete;
+
+public:
+  GOWakeEvent();
+  ~GOWakeEvent();
+
+  /* Waits at most WAIT_TIMEOUT_MS, returns false on a timeout */
+  bool Wait();
+  void Set();
+};
+
+#endif /* GOWAKEEVENT_H */
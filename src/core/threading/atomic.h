@@ -39,6 +39,12 @@ public:
 		return val;
 	}
 
+	atomic<T>& operator=(const atomic<T>& val)
+	{
+		m_Value = (T)val.m_Value;
+		return *this;
+	}
+
 	operator T() const
 	{
 		return m_Value;
@@ -92,6 +98,13 @@ public:
 		return val;
 	}
 
+	atomic<T>& operator=(const atomic<T>& val)
+	{
+		wxCriticalSectionLocker m_Locker(m_Lock);
+		m_Value = val.m_Value;
+		return *this;
+	}
+
 	operator T() const
 	{
 		return m_Value;
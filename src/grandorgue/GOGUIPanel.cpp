@@ -34,6 +34,7 @@
 #include "GOrgueTremulant.h"
 #include "GrandOrgueFile.h"
 #include "Images.h"
+#include "threading/GOMutexLocker.h"
 #include <wx/image.h>
 
 constexpr static int windowLimit = 10000;
@@ -581,6 +582,7 @@ void GOGUIPanel::Modified()
 
 void GOGUIPanel::HandleKey(int key)
 {
+	GOMutexLocker locker(m_organfile->GetModelLock());
 	switch(key)
 	{
 	case 259: /* Shift not down */
@@ -606,6 +608,13 @@ void GOGUIPanel::HandleMousePress(int x, int y, bool right)
 {
 	GOGUIMouseState tmp;
 	GOGUIMouseState& state = right ? tmp : m_MouseState.GetMouseState();
+	/* A right click only opens a dialog */
+	if (right)
+	{
+		SendMousePress(x, y, right, state);
+		return;
+	}
+	GOMutexLocker locker(m_organfile->GetModelLock());
 	SendMousePress(x, y, right, state);
 }
 
@@ -617,6 +626,7 @@ void GOGUIPanel::HandleMouseRelease(bool right)
 
 void GOGUIPanel::HandleMouseScroll(int x, int y, int amount)
 {
+	GOMutexLocker locker(m_organfile->GetModelLock());
 	for(unsigned i = 0; i < m_controls.size(); i++)
 		if (m_controls[i]->HandleMouseScroll(x, y, amount))
 			return;
@@ -15,6 +15,7 @@
 #include "GOrgueReleaseAlignTable.h"
 #include "GOrgueSampleStatistic.h"
 #include <wx/intl.h>
+#include <algorithm>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -30,6 +31,10 @@ static unsigned limited_diff(unsigned a, unsigned b)
 
 GOAudioSection::GOAudioSection(GOrgueMemoryPool& pool):
 	m_Data(NULL),
+	m_StreamStart(0),
+	m_StreamEnd(0),
+	m_HeadData(NULL),
+	m_TailData(NULL),
 	m_ReleaseAligner(NULL),
 	m_ReleaseStartSegment(0),
 	m_Pool(pool)
@@ -56,6 +61,18 @@ void GOAudioSection::ClearData()
 		m_Pool.Free(m_Data);
 		m_Data = NULL;
 	}
+	if (m_HeadData)
+	{
+		m_Pool.Free(m_HeadData);
+		m_HeadData = NULL;
+	}
+	if (m_TailData)
+	{
+		m_Pool.Free(m_TailData);
+		m_TailData = NULL;
+	}
+	m_StreamStart = 0;
+	m_StreamEnd = 0;
 	if (m_ReleaseAligner)
 	{
 		delete m_ReleaseAligner;
@@ -146,9 +163,160 @@ bool GOAudioSection::LoadCache(GOrgueCache& cache)
 			return false;
 	}
 
+	if (!m_Pool.IsCacheResident() && m_Pool.IsCacheData(m_Data))
+		SetupStreaming();
+
 	return true;
 }
 
+unsigned char* GOAudioSection::CopyToPool(const unsigned char* data, unsigned length)
+{
+	unsigned char* copy = (unsigned char*)m_Pool.Alloc(length, true);
+	if (!copy)
+		throw GOrgueOutOfMemory();
+	memcpy(copy, data, length);
+	return copy;
+}
+
+/* Called for sections loaded from the mapped cache, if the cache should not
+ * be kept in memory. The end segments and the part from the first loop on
+ * are copied into the pool. If the part before is long enough, only its head
+ * is copied and the rest is streamed, otherwise the whole section is copied. */
+void GOAudioSection::SetupStreaming()
+{
+	for (unsigned i = 0; i < m_EndSegments.size(); i++)
+	{
+		audio_end_data_segment& s = m_EndSegments[i];
+		if (!m_Pool.IsCacheData(s.end_data))
+			continue;
+		unsigned char* data = CopyToPool(s.end_data, s.end_size);
+		m_Pool.Free(s.end_data);
+		s.end_data = data;
+		s.end_ptr = s.end_data - m_BytesPerSample * s.transition_offset;
+	}
+
+	unsigned end = m_SampleCount;
+	for (unsigned i = 1; i < m_StartSegments.size(); i++)
+		end = std::min(end, m_StartSegments[i].start_offset);
+	for (unsigned i = 0; i < m_EndSegments.size(); i++)
+		end = std::min(end, m_EndSegments[i].transition_offset);
+
+	if (m_Compressed || m_BytesPerSample > STREAM_MAX_FRAME_SIZE || end < STREAM_HEAD_LENGTH + 2 * STREAM_CHUNK_SIZE)
+	{
+		unsigned char* data = CopyToPool(m_Data, m_AllocSize);
+		m_Pool.Free(m_Data);
+		m_Data = data;
+		return;
+	}
+
+	m_HeadData = CopyToPool(m_Data, (STREAM_HEAD_LENGTH + STREAM_MARGIN) * m_BytesPerSample);
+	m_TailData = CopyToPool(m_Data + end * m_BytesPerSample, (m_SampleCount - end) * m_BytesPerSample);
+	m_StreamStart = STREAM_HEAD_LENGTH;
+	m_StreamEnd = end;
+}
+
+void GOAudioSection::ReadStreamChunk(unsigned chunk, unsigned char *data) const
+{
+	unsigned start = m_StreamStart + chunk * STREAM_CHUNK_SIZE;
+	unsigned length = std::min((unsigned)(STREAM_CHUNK_SIZE + STREAM_MARGIN), m_SampleCount - start);
+	memcpy(data, m_Data + start * m_BytesPerSample, length * m_BytesPerSample);
+}
+
+void GOAudioSection::AttachStream(audio_section_stream *stream, GOSoundStreamer *streamer) const
+{
+	stream->streamer = m_StreamEnd ? streamer : NULL;
+	stream->buffer = NULL;
+	stream->next_chunk = 0;
+	if (stream->streamer && stream->position_index < m_StreamEnd)
+	{
+		stream->buffer = streamer->Acquire();
+		if (stream->buffer)
+		{
+			stream->buffer_generation = stream->buffer->generation;
+			if (stream->position_index >= m_StreamStart)
+				stream->next_chunk = (stream->position_index - m_StreamStart) / STREAM_CHUNK_SIZE;
+			RequestChunks(stream, stream->next_chunk + STREAM_CHUNKS);
+		}
+		else
+			streamer->AddUnderrun();
+	}
+	SeekStream(stream);
+}
+
+void GOAudioSection::ReleaseStream(audio_section_stream *stream)
+{
+	if (!stream->buffer)
+		return;
+	stream->streamer->Release(stream->buffer);
+	stream->buffer = NULL;
+}
+
+/* Request the chunks before limit, which are not requested yet. If the
+ * queue is full, the rest is requested again on the next seek. */
+void GOAudioSection::RequestChunks(audio_section_stream *stream, unsigned limit)
+{
+	if (!stream->buffer)
+		return;
+	const GOAudioSection* section = stream->audio_section;
+	unsigned count = (section->m_StreamEnd - section->m_StreamStart + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+	if (limit > count)
+		limit = count;
+	for (; stream->next_chunk < limit; stream->next_chunk++)
+		if (!stream->streamer->Request(stream->buffer, stream->buffer_generation, section, stream->next_chunk))
+			break;
+}
+
+/* Point the stream to the memory holding its current position */
+void GOAudioSection::SeekStream(audio_section_stream *stream)
+{
+	const GOAudioSection* section = stream->audio_section;
+	const unsigned pos = stream->position_index;
+	if (!section->m_StreamEnd)
+	{
+		stream->ptr = section->m_Data;
+		stream->window_end = (unsigned)-1;
+	}
+	else if (pos < section->m_StreamStart)
+	{
+		stream->ptr = section->m_HeadData;
+		stream->window_end = section->m_StreamStart;
+	}
+	else if (pos >= section->m_StreamEnd)
+	{
+		ReleaseStream(stream);
+		stream->ptr = section->m_TailData - section->m_StreamEnd * section->m_BytesPerSample;
+		stream->window_end = (unsigned)-1;
+	}
+	else if (!stream->buffer)
+	{
+		/* All stream buffers are in use, so read the mapped cache like a
+		 * section, which is not streamed */
+		stream->ptr = section->m_Data;
+		stream->window_end = section->m_StreamEnd;
+	}
+	else
+	{
+		const unsigned chunk = (pos - section->m_StreamStart) / STREAM_CHUNK_SIZE;
+		const unsigned start = section->m_StreamStart + chunk * STREAM_CHUNK_SIZE;
+		const unsigned slot = chunk % STREAM_CHUNKS;
+		stream->window_end = std::min(start + STREAM_CHUNK_SIZE, section->m_StreamEnd);
+		if (stream->next_chunk < chunk)
+			stream->next_chunk = chunk;
+		RequestChunks(stream, chunk + STREAM_CHUNKS);
+
+		GOSoundStreamBuffer* buffer = stream->buffer;
+		if (buffer->loaded[slot] == GOSoundStreamer::GetChunkTag(stream->buffer_generation, chunk))
+			stream->ptr = buffer->data + slot * STREAM_SLOT_SIZE - start * section->m_BytesPerSample;
+		else
+		{
+			/* Not loaded in time. Reading the mapped cache here could
+			 * block the sound thread, so the chunk stays silent. */
+			stream->ptr = stream->streamer->GetSilence() - start * section->m_BytesPerSample;
+			stream->streamer->AddUnderrun();
+		}
+	}
+}
+
 bool GOAudioSection::SaveCache(GOrgueCacheWriter& cache) const
 {
 	if (!cache.Write(&m_AllocSize, sizeof(m_AllocSize)))
@@ -341,7 +509,7 @@ void GOAudioSection::StereoUncompressedPolyphase(audio_section_stream *stream, f
 	stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
 }
 
-template<bool format16>
+template<class Decompression>
 inline
 void GOAudioSection::MonoCompressedLinear(audio_section_stream *stream, float *output, unsigned int n_blocks)
 {
@@ -352,7 +520,7 @@ void GOAudioSection::MonoCompressedLinear(audio_section_stream *stream, float *o
 
 		while (stream->cache.position <= stream->position_index + 1)
 		{
-			DecompressionStep(stream->cache, 1, format16);
+			Decompression::Step(stream->cache, 1);
 		}
 
 		output[0] = stream->cache.prev[0] * stream->resample_coefs->linear[stream->position_fraction][1] + stream->cache.value[0] * stream->resample_coefs->linear[stream->position_fraction][0];
@@ -363,7 +531,7 @@ void GOAudioSection::MonoCompressedLinear(audio_section_stream *stream, float *o
 	stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
 }
 
-template<bool format16>
+template<class Decompression>
 inline
 void GOAudioSection::StereoCompressedLinear(audio_section_stream *stream, float *output, unsigned int n_blocks)
 {
@@ -375,7 +543,7 @@ void GOAudioSection::StereoCompressedLinear(audio_section_stream *stream, float
 
 		while (stream->cache.position <= stream->position_index + 1)
 		{
-			DecompressionStep(stream->cache, 2, format16);
+			Decompression::Step(stream->cache, 2);
 		}
 
 		output[0] = stream->cache.prev[0] * stream->resample_coefs->linear[stream->position_fraction][1] + stream->cache.value[0] * stream->resample_coefs->linear[stream->position_fraction][0];
@@ -386,34 +554,122 @@ void GOAudioSection::StereoCompressedLinear(audio_section_stream *stream, float
 	stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
 }
 
+template<class Decompression>
 inline
-DecodeBlockFunction GOAudioSection::GetDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, bool compressed, interpolation_type interpolation, bool is_end)
+void GOAudioSection::MonoCompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks)
 {
-	if (compressed && !is_end)
+	const float* coef       = stream->resample_coefs->coefs;
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, stream->position_fraction += stream->increment_fraction)
 	{
-		/* TODO: Add support for polyphase compressed decoders. Fallback to
-		 * linear interpolation for now. */
-		if (channels == 1)
+		stream->position_index += stream->position_fraction >> UPSAMPLE_BITS;
+		stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
+
+		/* Decode until the history holds the whole filter window */
+		while (stream->cache.position < stream->position_index + SUBFILTER_TAPS)
 		{
-			if (bits_per_sample >= 20)
-				return MonoCompressedLinear<true>;
+			Decompression::Step(stream->cache, 1);
+		}
 
-			assert(bits_per_sample >= 12);
-			return MonoCompressedLinear<false>;
+		float out1 = 0.0f;
+		float out2 = 0.0f;
+		float out3 = 0.0f;
+		float out4 = 0.0f;
+		const float* coef_set = &coef[stream->position_fraction << SUBFILTER_BITS];
+		const int (*in_set)[MAX_OUTPUT_CHANNELS] = &stream->cache.history[stream->position_index & (DECOMPRESSION_HISTORY - 1)];
+		for (unsigned j = 0; j < SUBFILTER_TAPS; j += 4)
+		{
+			out1 += in_set[j][0]   * coef_set[j];
+			out2 += in_set[j+1][0] * coef_set[j+1];
+			out3 += in_set[j+2][0] * coef_set[j+2];
+			out4 += in_set[j+3][0] * coef_set[j+3];
 		}
-		else if (channels == 2)
+		output[0] = out1 + out2 + out3 + out4;
+		output[1] = output[0];
+	}
+
+	stream->position_index += stream->position_fraction >> UPSAMPLE_BITS;
+	stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+template<class Decompression>
+inline
+void GOAudioSection::StereoCompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	const float* coef       = stream->resample_coefs->coefs;
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, stream->position_fraction += stream->increment_fraction)
+	{
+		stream->position_index += stream->position_fraction >> UPSAMPLE_BITS;
+		stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
+
+		/* Decode until the history holds the whole filter window */
+		while (stream->cache.position < stream->position_index + SUBFILTER_TAPS)
 		{
-			if (bits_per_sample >= 20)
-				return StereoCompressedLinear<true>;
+			Decompression::Step(stream->cache, 2);
+		}
 
-			assert(bits_per_sample >= 12);
-			return StereoCompressedLinear<false>;
+		float out1 = 0.0f;
+		float out2 = 0.0f;
+		float out3 = 0.0f;
+		float out4 = 0.0f;
+		const float* coef_set = &coef[stream->position_fraction << SUBFILTER_BITS];
+		const int (*in_set)[MAX_OUTPUT_CHANNELS] = &stream->cache.history[stream->position_index & (DECOMPRESSION_HISTORY - 1)];
+		for (unsigned j = 0; j < SUBFILTER_TAPS; j += 2)
+		{
+			out1 += in_set[j][0]   * coef_set[j];
+			out2 += in_set[j][1]   * coef_set[j];
+			out3 += in_set[j+1][0] * coef_set[j+1];
+			out4 += in_set[j+1][1] * coef_set[j+1];
 		}
+		output[0]     = out1 + out3;
+		output[1]     = out2 + out4;
+	}
+
+	stream->position_index += stream->position_fraction >> UPSAMPLE_BITS;
+	stream->position_fraction = stream->position_fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+template<class Decompression>
+DecodeBlockFunction GOAudioSection::GetCompressedDecodeBlockFunction(unsigned channels, interpolation_type interpolation)
+{
+	if (interpolation == GO_POLYPHASE_INTERPOLATION)
+	{
+		if (channels == 1)
+			return MonoCompressedPolyphase<Decompression>;
+		else if (channels == 2)
+			return StereoCompressedPolyphase<Decompression>;
+	}
+	else
+	{
+		if (channels == 1)
+			return MonoCompressedLinear<Decompression>;
+		else if (channels == 2)
+			return StereoCompressedLinear<Decompression>;
+	}
+
+	assert(0 && "unsupported decoder configuration");
+	return NULL;
+}
+
+DecodeBlockFunction GOAudioSection::GetDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, unsigned compression, interpolation_type interpolation, bool is_end, simd_type simd)
+{
+	if (compression && !is_end)
+	{
+		if (compression == GO_COMPRESSION_BLOCK)
+			return GetCompressedDecodeBlockFunction<BlockDecompression>(channels, interpolation);
+		if (bits_per_sample >= 20)
+			return GetCompressedDecodeBlockFunction<PredictiveDecompression<true> >(channels, interpolation);
+
+		assert(bits_per_sample >= 12);
+		return GetCompressedDecodeBlockFunction<PredictiveDecompression<false> >(channels, interpolation);
 	}
 	else
 	{
-		if (interpolation == GO_POLYPHASE_INTERPOLATION && !compressed)
+		if (interpolation == GO_POLYPHASE_INTERPOLATION)
 		{
+			DecodeBlockFunction simd_function = GetSIMDDecodeBlockFunction(channels, bits_per_sample, interpolation, simd);
+			if (simd_function)
+				return simd_function;
+
 			if (channels == 1)
 			{
 				if (bits_per_sample <= 8)
@@ -515,7 +771,7 @@ bool GOAudioSection::ReadBlock(audio_section_stream *stream, float *buffer, unsi
 				const audio_end_data_segment *next_end = &stream->audio_section->m_EndSegments[next_end_segment_index];
 
 				stream->position_index += next->start_offset;
-				stream->ptr = stream->audio_section->m_Data;
+				SeekStream(stream);
 				stream->cache = next->cache;
 				stream->cache.ptr = stream->audio_section->m_Data + (intptr_t)stream->cache.ptr;
 				assert(next_end->end_offset >= next->start_offset);
@@ -526,10 +782,13 @@ bool GOAudioSection::ReadBlock(audio_section_stream *stream, float *buffer, unsi
 				stream->end_seg = next_end;
 			}
 		}
+		else if (stream->position_index >= stream->window_end)
+			SeekStream(stream);
 		else
 		{
 			assert(stream->decode_call);
-			unsigned len = ((stream->read_end - stream->position_index) << UPSAMPLE_BITS) / stream->increment_fraction;
+			unsigned end = std::min(stream->read_end, stream->window_end);
+			unsigned len = ((end - stream->position_index) << UPSAMPLE_BITS) / stream->increment_fraction;
 			if (len == 0)
 				len = 1;
 			len = std::min(len, n_blocks);
@@ -643,13 +902,14 @@ void GOAudioSection::DoCrossfade(unsigned char* dest, unsigned dest_offset, cons
 }
 
 void GOAudioSection::Setup(const void *pcm_data, const GOrgueWave::SAMPLE_FORMAT pcm_data_format, const unsigned pcm_data_channels, const unsigned pcm_data_sample_rate, const unsigned pcm_data_nb_samples, 
-			   const std::vector<GO_WAVE_LOOP> *loop_points, bool compress, unsigned crossfade_length)
+			   const std::vector<GO_WAVE_LOOP> *loop_points, compression_type compress, unsigned crossfade_length)
 {
 	if (pcm_data_channels < 1 || pcm_data_channels > 2)
 		throw (wxString)_("< More than 2 channels in");
 
 	m_BitsPerSample  = wave_bits_per_sample(pcm_data_format);
-	compress = (compress) && (m_BitsPerSample > 8);
+	if (m_BitsPerSample <= 8)
+		compress = GO_COMPRESSION_NONE;
 	crossfade_length = crossfade_length * pcm_data_sample_rate / 1000;
 
 	assert(pcm_data_nb_samples > 0);
@@ -768,22 +1028,24 @@ void GOAudioSection::Setup(const void *pcm_data, const GOrgueWave::SAMPLE_FORMAT
 	}
 
 	m_AllocSize = total_alloc_samples * m_BytesPerSample;
-	m_Data = (unsigned char*)m_Pool.Alloc(m_AllocSize, !compress);
+	m_Data = (unsigned char*)m_Pool.Alloc(m_AllocSize, compress == GO_COMPRESSION_NONE);
 	if (m_Data == NULL)
 		throw GOrgueOutOfMemory();
 	m_SampleRate     = pcm_data_sample_rate;
 	m_SampleCount    = total_alloc_samples;
 	m_SampleFracBits = m_BitsPerSample - 1;
 	m_Channels       = pcm_data_channels;
-	m_Compressed     = false;
+	m_Compressed     = GO_COMPRESSION_NONE;
 
 	/* Store the main data blob. */
 	memcpy(m_Data, pcm_data, m_AllocSize);
 
 	GetMaxAmplitudeAndDerivative();
 
-	if (compress)
+	if (compress == GO_COMPRESSION_PREDICTIVE)
 		Compress(m_BitsPerSample > 16);
+	else if (compress == GO_COMPRESSION_BLOCK)
+		CompressBlocks();
 
 }
 
@@ -817,6 +1079,8 @@ void GOAudioSection::Compress(bool format16)
 		state.value[0] = GetSample(i, 0);
 		if (m_Channels > 1)
 			state.value[1] = GetSample(i, 1);
+		for (unsigned j = 0; j < m_Channels; j++)
+			StoreDecompressionHistory(state, j);
 
 		for (unsigned j = 0; j < m_Channels; j++)
 		{
@@ -893,7 +1157,64 @@ void GOAudioSection::Compress(bool format16)
 	m_Pool.Free(m_Data);
 	m_Data = data;
 	m_AllocSize = output_len;
-	m_Compressed = true;
+	m_Compressed = GO_COMPRESSION_PREDICTIVE;
+
+	m_Data = (unsigned char*)m_Pool.MoveToPool(m_Data, m_AllocSize);
+	if (m_Data == NULL)
+		throw GOrgueOutOfMemory();
+}
+
+void GOAudioSection::CompressBlocks()
+{
+	const unsigned block_count = (m_SampleCount + BLOCK_COMPRESSION_FRAMES - 1) >> BLOCK_COMPRESSION_BITS;
+	unsigned char* data = (unsigned char*)m_Pool.Alloc(m_AllocSize, false);
+	if (data == NULL)
+		throw GOrgueOutOfMemory();
+
+	uint32_t* offsets = (uint32_t*)data;
+	unsigned output_len = block_count * sizeof(uint32_t);
+	int samples[BLOCK_COMPRESSION_FRAMES * MAX_OUTPUT_CHANNELS];
+
+	for (unsigned i = 0; i < block_count; i++)
+	{
+		/* Early abort if the compressed data will be larger than the
+		 * uncompressed data. */
+		if (output_len + BLOCK_COMPRESSION_MAX_SIZE + BLOCK_COMPRESSION_PADDING >= m_AllocSize)
+		{
+			m_Pool.Free(data);
+			m_Data = (unsigned char*)m_Pool.MoveToPool(m_Data, m_AllocSize);
+			if (m_Data == NULL)
+				throw GOrgueOutOfMemory();
+			return;
+		}
+
+		/* The last block is padded with its last frame */
+		for (unsigned k = 0; k < BLOCK_COMPRESSION_FRAMES; k++)
+			for (unsigned j = 0; j < m_Channels; j++)
+				samples[k * m_Channels + j] = GetSample(std::min((i << BLOCK_COMPRESSION_BITS) + k, m_SampleCount - 1), j);
+
+		offsets[i] = output_len;
+		AudioWriteBlockCompressed(data, output_len, samples, m_Channels);
+	}
+	memset(data + output_len, 0, BLOCK_COMPRESSION_PADDING);
+	output_len += BLOCK_COMPRESSION_PADDING;
+
+	for (unsigned j = 0; j < m_StartSegments.size(); j++)
+	{
+		DecompressionCache& state = m_StartSegments[j].cache;
+		unsigned start = m_StartSegments[j].start_offset;
+		InitDecompressionCache(state);
+		if (start)
+			BlockDecompressTo(state, start - 1, data, m_Channels);
+		else
+			state.ptr = data + offsets[0];
+		state.ptr = (const unsigned char*)(intptr_t)(state.ptr - data);
+	}
+
+	m_Pool.Free(m_Data);
+	m_Data = data;
+	m_AllocSize = output_len;
+	m_Compressed = GO_COMPRESSION_BLOCK;
 
 	m_Data = (unsigned char*)m_Pool.MoveToPool(m_Data, m_AllocSize);
 	if (m_Data == NULL)
@@ -938,7 +1259,7 @@ void GOAudioSection::SetupStreamAlignment(const std::vector<const GOAudioSection
 
 unsigned GOAudioSection::GetMargin(bool compressed, interpolation_type interpolation)
 {
-	if (interpolation == GO_POLYPHASE_INTERPOLATION && !compressed)
+	if (interpolation == GO_POLYPHASE_INTERPOLATION)
 		return POLYPHASE_READAHEAD;
 	else if (compressed)
 		return LINEAR_COMPRESSED_READAHEAD;
@@ -946,7 +1267,7 @@ unsigned GOAudioSection::GetMargin(bool compressed, interpolation_type interpola
 		return LINEAR_READAHEAD;
 }
 
-void GOAudioSection::InitStream(const struct resampler_coefs_s *resampler_coefs, audio_section_stream *stream, float sample_rate_adjustment) const
+void GOAudioSection::InitStream(const struct resampler_coefs_s *resampler_coefs, audio_section_stream *stream, float sample_rate_adjustment, GOSoundStreamer *streamer) const
 {
 	stream->audio_section = this;
 
@@ -969,9 +1290,10 @@ void GOAudioSection::InitStream(const struct resampler_coefs_s *resampler_coefs,
 	stream->end_pos = end.end_pos - stream->margin;
 	stream->cache = start.cache;
 	stream->cache.ptr = stream->audio_section->m_Data + (intptr_t)stream->cache.ptr;
+	AttachStream(stream, streamer);
 }
 
-void GOAudioSection::InitAlignedStream(audio_section_stream *stream, const audio_section_stream *existing_stream) const
+void GOAudioSection::InitAlignedStream(audio_section_stream *stream, const audio_section_stream *existing_stream, GOSoundStreamer *streamer) const
 {
 	stream->audio_section = this;
 
@@ -996,11 +1318,9 @@ void GOAudioSection::InitAlignedStream(audio_section_stream *stream, const audio
 	stream->end_pos = end.end_pos - stream->margin;
 	stream->cache = start.cache;
 	stream->cache.ptr = stream->audio_section->m_Data + (intptr_t)stream->cache.ptr;
-	if (!m_ReleaseAligner)
-	{
-		return;
-	}
-	m_ReleaseAligner->SetupRelease(*stream, *existing_stream);
+	if (m_ReleaseAligner)
+		m_ReleaseAligner->SetupRelease(*stream, *existing_stream);
+	AttachStream(stream, streamer);
 }
 
 unsigned GOAudioSection::GetSampleRate() const
@@ -1033,7 +1353,10 @@ void GOAudioSection::GetHistory(const audio_section_stream *stream, int history[
 			{
 				for(unsigned j = 0; j < stream->audio_section->m_Channels; j++)
 					history[i][j] = cache.value[j];
-				DecompressionStep(cache, stream->audio_section->m_Channels, stream->audio_section->m_BitsPerSample >= 20);
+				if (stream->audio_section->m_Compressed == GO_COMPRESSION_BLOCK)
+					BlockDecompressionStep(cache, stream->audio_section->m_Channels);
+				else
+					DecompressionStep(cache, stream->audio_section->m_Channels, stream->audio_section->m_BitsPerSample >= 20);
 			}
 		}
 	}
@@ -10,6 +10,8 @@
 #include "GOSoundCompress.h"
 #include "GOSoundDefs.h"
 #include "GOSoundResample.h"
+#include "GOSoundSIMD.h"
+#include "GOSoundStreamer.h"
 #include "GOrgueInt.h"
 #include "GOrgueWave.h"
 #include <assert.h>
@@ -91,6 +93,14 @@ typedef struct audio_section_stream_s
 
 	/* for decoding compressed format */
 	DecompressionCache           cache;
+
+	/* ptr is valid for the positions before window_end. Streamed sections
+	 * move it between the head, the chunks of the buffer and the tail. */
+	unsigned                     window_end;
+	GOSoundStreamer             *streamer;
+	GOSoundStreamBuffer         *buffer;
+	unsigned                     buffer_generation;
+	unsigned                     next_chunk;
 } audio_section_stream;
 
 class GOAudioSection
@@ -105,15 +115,28 @@ private:
 	static void MonoUncompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks);
 	template<class T>
 	static void StereoUncompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks);
-	template<bool format16>
+	template<class Decompression>
 	static void MonoCompressedLinear(audio_section_stream *stream, float *output, unsigned int n_blocks);
-	template<bool format16>
+	template<class Decompression>
 	static void StereoCompressedLinear(audio_section_stream *stream, float *output, unsigned int n_blocks);
-
-	static DecodeBlockFunction GetDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, bool compressed, interpolation_type interpolation, bool is_end);
+	template<class Decompression>
+	static void MonoCompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks);
+	template<class Decompression>
+	static void StereoCompressedPolyphase(audio_section_stream *stream, float *output, unsigned int n_blocks);
+
+	template<class Decompression>
+	static DecodeBlockFunction GetCompressedDecodeBlockFunction(unsigned channels, interpolation_type interpolation);
+	static DecodeBlockFunction GetSIMDDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, interpolation_type interpolation, simd_type simd);
 	static unsigned GetMargin(bool compressed, interpolation_type interpolation);
 
 	void Compress(bool format16);
+	void CompressBlocks();
+
+	void SetupStreaming();
+	unsigned char* CopyToPool(const unsigned char* data, unsigned length);
+	void AttachStream(audio_section_stream *stream, GOSoundStreamer *streamer) const;
+	static void SeekStream(audio_section_stream *stream);
+	static void RequestChunks(audio_section_stream *stream, unsigned limit);
 
 	unsigned PickEndSegment(unsigned start_segment_index) const;
 
@@ -127,6 +150,14 @@ private:
 	/* Pointer to (size) bytes of data encoded in the format (type) */
 	unsigned char             *m_Data;
 
+	/* A streamed section keeps the frames before m_StreamStart and from
+	 * m_StreamEnd on in memory. The part in between is read from the
+	 * mapped cache (m_Data) in chunks. m_StreamEnd is 0 if not streamed. */
+	unsigned                   m_StreamStart;
+	unsigned                   m_StreamEnd;
+	unsigned char             *m_HeadData;
+	unsigned char             *m_TailData;
+
 	/* If this is a release section, it may contain an alignment table */
 	GOrgueReleaseAlignTable   *m_ReleaseAligner;
 	unsigned                   m_ReleaseStartSegment;
@@ -137,7 +168,7 @@ private:
 	unsigned                   m_SampleCount;
 	unsigned                   m_SampleRate;
 
-	/* Type of the data which is stored in the data pointer */
+	/* Type of the data which is stored in the data pointer (compression_type) */
 	unsigned                   m_Compressed;
 	unsigned                   m_BitsPerSample;
 	unsigned                   m_BytesPerSample;
@@ -163,17 +194,29 @@ public:
 
 	/* Initialize a stream to play this audio section and seek into it using
 	 * release alignment if available. */
-	void InitAlignedStream(audio_section_stream *stream, const audio_section_stream *existing_stream) const;
+	void InitAlignedStream(audio_section_stream *stream, const audio_section_stream *existing_stream, GOSoundStreamer *streamer = NULL) const;
 
 	/* Initialize a stream to play this audio section */
-	void InitStream(const struct resampler_coefs_s *resampler_coefs, audio_section_stream *stream, float sample_rate_adjustment) const;
+	void InitStream(const struct resampler_coefs_s *resampler_coefs, audio_section_stream *stream, float sample_rate_adjustment, GOSoundStreamer *streamer = NULL) const;
+
+	/* Return the stream buffer of a stream, which is no longer played */
+	static void ReleaseStream(audio_section_stream *stream);
+	/* Copy a chunk of the streamed part, called by the prefetch threads */
+	void ReadStreamChunk(unsigned chunk, unsigned char *data) const;
+	bool IsStreamed() const;
 
 	/* Read an audio buffer from an audio section stream */
 	static bool ReadBlock(audio_section_stream *stream, float *buffer, unsigned int n_blocks);
 	static void GetHistory(const audio_section_stream *stream, int history[BLOCK_HISTORY][MAX_OUTPUT_CHANNELS]);
+	/* Hint the CPU to load the data the next ReadBlock will start with */
+	static void PrefetchStream(const audio_section_stream *stream);
+
+	/* Pick the decoder for a data format. Vectorized kernels of the requested
+	 * instruction set are used where available, the scalar ones otherwise. */
+	static DecodeBlockFunction GetDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, unsigned compression, interpolation_type interpolation, bool is_end, simd_type simd = GOSoundSIMD::GetType());
 
 	void Setup(const void *pcm_data, GOrgueWave::SAMPLE_FORMAT pcm_data_format, unsigned pcm_data_channels, unsigned pcm_data_sample_rate, unsigned pcm_data_nb_samples, 
-		   const std::vector<GO_WAVE_LOOP> *loop_points, bool compress, unsigned crossfade_length);
+		   const std::vector<GO_WAVE_LOOP> *loop_points, compression_type compress, unsigned crossfade_length);
 
 	bool IsOneshot() const;
 
@@ -202,6 +245,19 @@ unsigned GOAudioSection::GetBytesPerSample() const
 	return (m_Compressed) ? 0 : (m_BitsPerSample / 8);
 }
 
+inline
+void GOAudioSection::PrefetchStream(const audio_section_stream *stream)
+{
+	const GOAudioSection* section = stream->audio_section;
+	const unsigned char* ptr;
+	if (section->m_Compressed && stream->position_index < stream->transition_position)
+		ptr = stream->cache.ptr;
+	else
+		ptr = stream->ptr + stream->position_index * section->m_BytesPerSample;
+	GO_PREFETCH(ptr);
+	GO_PREFETCH(ptr + 64);
+}
+
 inline
 unsigned GOAudioSection::GetLength() const
 {
@@ -252,6 +308,12 @@ int GOAudioSection::GetSample(unsigned position, unsigned channel, Decompression
 			InitDecompressionCache(*cache);
 		}
 
+		if (m_Compressed == GO_COMPRESSION_BLOCK)
+		{
+			BlockDecompressTo(*cache, position, m_Data, m_Channels);
+			return cache->value[channel];
+		}
+
 		assert(m_BitsPerSample >= 12);
 		DecompressTo
 			(*cache
@@ -295,6 +357,12 @@ float GOAudioSection::GetNormGain() const
 	return scalbnf(1.0f, -((int)m_SampleFracBits));
 }
 
+inline
+bool GOAudioSection::IsStreamed() const
+{
+	return m_StreamEnd > 0;
+}
+
 inline
 bool GOAudioSection::SupportsStreamAlignment() const
 {
@@ -0,0 +1,365 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundAudioSection.h"
+
+#include "GOSoundResample.h"
+
+#if defined(GO_SIMD_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GO_SIMD_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(GO_SIMD_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Vectorized polyphase decode kernels.
+ *
+ * The scalar kernels in GOSoundAudioSection.cpp are the reference. These
+ * variants keep the stream position in registers and evaluate the
+ * SUBFILTER_TAPS wide FIR of one output frame with a few vector
+ * multiply-adds, converting the integer samples to float in the vector unit.
+ * Linear and compressed decoders are not vectorized: the former only uses two
+ * taps and is bound by memory access, the latter is a serial decoder. */
+
+#if defined(GO_SIMD_HAVE_SSE2)
+
+static inline void LoadSSE2(GOInt8* input, __m128& lo, __m128& hi)
+{
+	__m128i v = _mm_loadl_epi64((const __m128i*)input);
+	v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+	lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+	hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+static inline void LoadSSE2(GOInt16* input, __m128& lo, __m128& hi)
+{
+	__m128i v = _mm_loadu_si128((const __m128i*)input);
+	lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+	hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+static inline void LoadSSE2(GOInt24* input, __m128& lo, __m128& hi)
+{
+	/* Assemble in registers, a round trip through memory would stall on
+	 * store forwarding */
+	lo = _mm_cvtepi32_ps(_mm_set_epi32(input[3], input[2], input[1], input[0]));
+	hi = _mm_cvtepi32_ps(_mm_set_epi32(input[7], input[6], input[5], input[4]));
+}
+
+template<class T>
+static void MonoPolyphaseSSE2(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		const float* coef_set = &coef[fraction << SUBFILTER_BITS];
+		__m128 lo, hi;
+		LoadSSE2(&input[index], lo, hi);
+		__m128 sum = _mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(coef_set)), _mm_mul_ps(hi, _mm_loadu_ps(coef_set + 4)));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		sum = _mm_unpacklo_ps(sum, sum);
+		_mm_storel_pi((__m64*)output, sum);
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+template<class T>
+static void StereoPolyphaseSSE2(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		const float* coef_set = &coef[fraction << SUBFILTER_BITS];
+		/* Interleaved frames: f01 = L0 R0 L1 R1, ... */
+		__m128 f01, f23, f45, f67;
+		LoadSSE2(&input[2 * index], f01, f23);
+		LoadSSE2(&input[2 * index + SUBFILTER_TAPS], f45, f67);
+		const __m128 c03 = _mm_loadu_ps(coef_set);
+		const __m128 c47 = _mm_loadu_ps(coef_set + 4);
+		__m128 sum = _mm_mul_ps(f01, _mm_unpacklo_ps(c03, c03));
+		sum = _mm_add_ps(sum, _mm_mul_ps(f23, _mm_unpackhi_ps(c03, c03)));
+		sum = _mm_add_ps(sum, _mm_mul_ps(f45, _mm_unpacklo_ps(c47, c47)));
+		sum = _mm_add_ps(sum, _mm_mul_ps(f67, _mm_unpackhi_ps(c47, c47)));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		_mm_storel_pi((__m64*)output, sum);
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+#endif
+
+#if defined(GO_SIMD_HAVE_AVX2)
+
+#define GO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+
+GO_TARGET_AVX2
+static inline __m256 LoadAVX2(GOInt8* input)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)input)));
+}
+
+GO_TARGET_AVX2
+static inline __m256 LoadAVX2(GOInt16* input)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)input)));
+}
+
+GO_TARGET_AVX2
+static inline __m256 LoadAVX2(GOInt24* input)
+{
+	return _mm256_cvtepi32_ps(_mm256_set_epi32(input[7], input[6], input[5], input[4], input[3], input[2], input[1], input[0]));
+}
+
+template<class T>
+GO_TARGET_AVX2
+static void MonoPolyphaseAVX2(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		const __m256 prod = _mm256_mul_ps(LoadAVX2(&input[index]), _mm256_loadu_ps(&coef[fraction << SUBFILTER_BITS]));
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(prod), _mm256_extractf128_ps(prod, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		sum = _mm_unpacklo_ps(sum, sum);
+		_mm_storel_pi((__m64*)output, sum);
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+template<class T>
+GO_TARGET_AVX2
+static void StereoPolyphaseAVX2(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+	/* Duplicate every coefficient for the left and right channel */
+	const __m256i dup_lo = _mm256_set_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+	const __m256i dup_hi = _mm256_set_epi32(7, 7, 6, 6, 5, 5, 4, 4);
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		const __m256 c = _mm256_loadu_ps(&coef[fraction << SUBFILTER_BITS]);
+		__m256 prod = _mm256_mul_ps(LoadAVX2(&input[2 * index]), _mm256_permutevar8x32_ps(c, dup_lo));
+		prod = _mm256_fmadd_ps(LoadAVX2(&input[2 * index + SUBFILTER_TAPS]), _mm256_permutevar8x32_ps(c, dup_hi), prod);
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(prod), _mm256_extractf128_ps(prod, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		_mm_storel_pi((__m64*)output, sum);
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+#endif
+
+#if defined(GO_SIMD_HAVE_NEON)
+
+/* Convert SUBFILTER_TAPS 24 bit samples (every stride-th value) to int */
+static inline void LoadInt24(GOInt24* input, unsigned stride, int* output)
+{
+	for (unsigned j = 0; j < SUBFILTER_TAPS; j++)
+		output[j] = input[j * stride];
+}
+
+static inline float SumNEON(float32x4_t v)
+{
+#if defined(__aarch64__)
+	return vaddvq_f32(v);
+#else
+	float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+
+static inline float DotNEON(int16x8_t v, const float* coef)
+{
+	float32x4_t sum = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vld1q_f32(coef));
+	sum = vmlaq_f32(sum, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vld1q_f32(coef + 4));
+	return SumNEON(sum);
+}
+
+static inline float DotNEON(const int* values, const float* coef)
+{
+	float32x4_t sum = vmulq_f32(vcvtq_f32_s32(vld1q_s32(values)), vld1q_f32(coef));
+	sum = vmlaq_f32(sum, vcvtq_f32_s32(vld1q_s32(values + 4)), vld1q_f32(coef + 4));
+	return SumNEON(sum);
+}
+
+static inline float MonoNEON(GOInt8* input, const float* coef)
+{
+	return DotNEON(vmovl_s8(vld1_s8((const int8_t*)input)), coef);
+}
+
+static inline float MonoNEON(GOInt16* input, const float* coef)
+{
+	return DotNEON(vld1q_s16((const int16_t*)input), coef);
+}
+
+static inline float MonoNEON(GOInt24* input, const float* coef)
+{
+	int values[SUBFILTER_TAPS];
+	LoadInt24(input, 1, values);
+	return DotNEON(values, coef);
+}
+
+static inline void StereoNEON(GOInt8* input, const float* coef, float* output)
+{
+	int8x8x2_t v = vld2_s8((const int8_t*)input);
+	output[0] = DotNEON(vmovl_s8(v.val[0]), coef);
+	output[1] = DotNEON(vmovl_s8(v.val[1]), coef);
+}
+
+static inline void StereoNEON(GOInt16* input, const float* coef, float* output)
+{
+	int16x8x2_t v = vld2q_s16((const int16_t*)input);
+	output[0] = DotNEON(v.val[0], coef);
+	output[1] = DotNEON(v.val[1], coef);
+}
+
+static inline void StereoNEON(GOInt24* input, const float* coef, float* output)
+{
+	int left[SUBFILTER_TAPS];
+	int right[SUBFILTER_TAPS];
+	LoadInt24(input, 2, left);
+	LoadInt24(input + 1, 2, right);
+	output[0] = DotNEON(left, coef);
+	output[1] = DotNEON(right, coef);
+}
+
+template<class T>
+static void MonoPolyphaseNEON(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		output[0] = MonoNEON(&input[index], &coef[fraction << SUBFILTER_BITS]);
+		output[1] = output[0];
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+template<class T>
+static void StereoPolyphaseNEON(audio_section_stream *stream, float *output, unsigned int n_blocks)
+{
+	T* input = (T*)stream->ptr;
+	const float* coef = stream->resample_coefs->coefs;
+	unsigned index = stream->position_index;
+	unsigned fraction = stream->position_fraction;
+	const unsigned increment = stream->increment_fraction;
+
+	for (unsigned i = 0; i < n_blocks; ++i, output += 2, fraction += increment)
+	{
+		index += fraction >> UPSAMPLE_BITS;
+		fraction &= UPSAMPLE_FACTOR - 1;
+		StereoNEON(&input[2 * index], &coef[fraction << SUBFILTER_BITS], output);
+	}
+
+	stream->position_index = index + (fraction >> UPSAMPLE_BITS);
+	stream->position_fraction = fraction & (UPSAMPLE_FACTOR - 1);
+}
+
+#endif
+
+#if defined(GO_SIMD_HAVE_SSE2) || defined(GO_SIMD_HAVE_AVX2) || defined(GO_SIMD_HAVE_NEON)
+#define GO_SIMD_SELECT(name, channels, bits_per_sample)			\
+	do								\
+	{								\
+		if (channels == 1)					\
+		{							\
+			if (bits_per_sample <= 8)			\
+				return Mono##name<GOInt8>;		\
+			if (bits_per_sample <= 16)			\
+				return Mono##name<GOInt16>;		\
+			if (bits_per_sample <= 24)			\
+				return Mono##name<GOInt24>;		\
+		}							\
+		else if (channels == 2)					\
+		{							\
+			if (bits_per_sample <= 8)			\
+				return Stereo##name<GOInt8>;		\
+			if (bits_per_sample <= 16)			\
+				return Stereo##name<GOInt16>;		\
+			if (bits_per_sample <= 24)			\
+				return Stereo##name<GOInt24>;		\
+		}							\
+	}								\
+	while (0)
+#endif
+
+DecodeBlockFunction GOAudioSection::GetSIMDDecodeBlockFunction(unsigned channels, unsigned bits_per_sample, interpolation_type interpolation, simd_type simd)
+{
+	if (interpolation != GO_POLYPHASE_INTERPOLATION)
+		return NULL;
+
+	switch (simd)
+	{
+#if defined(GO_SIMD_HAVE_SSE2)
+	case GO_SIMD_SSE2:
+		GO_SIMD_SELECT(PolyphaseSSE2, channels, bits_per_sample);
+		break;
+#endif
+#if defined(GO_SIMD_HAVE_AVX2)
+	case GO_SIMD_AVX2:
+		GO_SIMD_SELECT(PolyphaseAVX2, channels, bits_per_sample);
+		break;
+#endif
+#if defined(GO_SIMD_HAVE_NEON)
+	case GO_SIMD_NEON:
+		GO_SIMD_SELECT(PolyphaseNEON, channels, bits_per_sample);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	return NULL;
+}
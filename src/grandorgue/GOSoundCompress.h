@@ -10,6 +10,35 @@
 #include "GOSoundDefs.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+typedef enum
+{
+	GO_COMPRESSION_NONE = 0,
+	/* Variable length predictive coding, decoded serially */
+	GO_COMPRESSION_PREDICTIVE = 1,
+	/* Fixed size blocks of bit packed deltas with a block index */
+	GO_COMPRESSION_BLOCK = 2,
+} compression_type;
+
+/* Frames per block of the block codec */
+#define BLOCK_COMPRESSION_BITS    (6U)
+#define BLOCK_COMPRESSION_FRAMES  (1U << BLOCK_COMPRESSION_BITS)
+/* Largest block, the reader may access up to 8 bytes past its end */
+#define BLOCK_COMPRESSION_MAX_SIZE (sizeof(BlockCompressionHeader) + MAX_OUTPUT_CHANNELS * BLOCK_COMPRESSION_FRAMES * 4)
+#define BLOCK_COMPRESSION_PADDING  (8)
+
+/* Block layout: the header, then for each channel BLOCK_COMPRESSION_FRAMES
+ * zigzag coded deltas to the previous frame, packed with bits[channel] bits
+ * each (so always bits[channel] * 8 bytes). The delta of the first frame is
+ * zero, its value is stored in the header. A section starts with a table of
+ * the block offsets. */
+typedef struct
+{
+	int32_t value[MAX_OUTPUT_CHANNELS];
+	uint8_t bits[MAX_OUTPUT_CHANNELS];
+	uint16_t size;
+} BlockCompressionHeader;
 
 static inline int AudioReadCompressed8(const unsigned char*& ptr)
 {
@@ -114,6 +143,10 @@ typedef struct {
 	int value[MAX_OUTPUT_CHANNELS];
 	int last[MAX_OUTPUT_CHANNELS];
 	int prev[MAX_OUTPUT_CHANNELS];
+	/* Ring of the last decoded samples, sample n is stored at n % DECOMPRESSION_HISTORY
+	 * and mirrored DECOMPRESSION_HISTORY entries later, so any window of
+	 * DECOMPRESSION_HISTORY samples is contiguous */
+	int history[2 * DECOMPRESSION_HISTORY][MAX_OUTPUT_CHANNELS];
 	const unsigned char* ptr;
 } DecompressionCache;
 
@@ -126,9 +159,18 @@ static inline void InitDecompressionCache(DecompressionCache& cache)
 		cache.last[j] = 0;
 		cache.value[j] = 0;
 		cache.prev[j] = 0;
+		for(unsigned i = 0; i < 2 * DECOMPRESSION_HISTORY; i++)
+			cache.history[i][j] = 0;
 	}
 }
 
+static inline void StoreDecompressionHistory(DecompressionCache& cache, unsigned channel)
+{
+	unsigned slot = cache.position & (DECOMPRESSION_HISTORY - 1);
+	cache.history[slot][channel] = cache.value[channel];
+	cache.history[slot + DECOMPRESSION_HISTORY][channel] = cache.value[channel];
+}
+
 static inline void DecompressionStep(DecompressionCache& cache, unsigned channels, bool format16)
 {
 	for (unsigned j = 0; j < channels; j++)
@@ -141,6 +183,7 @@ static inline void DecompressionStep(DecompressionCache& cache, unsigned channel
 		cache.last[j] = cache.prev[j];
 		cache.prev[j] = cache.value[j];
 		cache.value[j] = cache.prev[j] + (cache.prev[j] - cache.last[j]) / 2 + val;
+		StoreDecompressionHistory(cache, j);
 	}
 	cache.position++;
 }
@@ -156,4 +199,108 @@ static inline void DecompressTo(DecompressionCache& cache, unsigned position, co
 		DecompressionStep(cache, channels, format16);
 }
 
+/* Encode BLOCK_COMPRESSION_FRAMES interleaved frames */
+static inline void AudioWriteBlockCompressed(unsigned char* data, unsigned& output_len, const int* samples, unsigned channels)
+{
+	BlockCompressionHeader* header = (BlockCompressionHeader*)(data + output_len);
+	unsigned char* payload = data + output_len + sizeof(BlockCompressionHeader);
+	unsigned size = sizeof(BlockCompressionHeader);
+
+	memset(header, 0, sizeof(BlockCompressionHeader));
+	for (unsigned j = 0; j < channels; j++)
+	{
+		uint32_t codes[BLOCK_COMPRESSION_FRAMES];
+		uint32_t all = 0;
+		codes[0] = 0;
+		for (unsigned k = 1; k < BLOCK_COMPRESSION_FRAMES; k++)
+		{
+			int32_t delta = samples[k * channels + j] - samples[(k - 1) * channels + j];
+			codes[k] = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+			all |= codes[k];
+		}
+		unsigned bits = 0;
+		while (bits < 32 && (all >> bits))
+			bits++;
+
+		unsigned length = bits * (BLOCK_COMPRESSION_FRAMES / 8);
+		memset(payload, 0, length);
+		for (unsigned k = 1; k < BLOCK_COMPRESSION_FRAMES; k++)
+		{
+			unsigned bitpos = k * bits;
+			uint64_t code = (uint64_t)codes[k] << (bitpos & 7);
+			for (unsigned b = 0; code; b++, code >>= 8)
+				payload[(bitpos >> 3) + b] |= code & 0xFF;
+		}
+
+		header->value[j] = samples[j];
+		header->bits[j] = bits;
+		payload += length;
+		size += length;
+	}
+	header->size = size;
+	output_len += size;
+}
+
+/* Branch-free read of the delta of a frame */
+static inline int AudioReadBlockCompressed(const unsigned char* payload, unsigned bits, unsigned index)
+{
+	unsigned bitpos = index * bits;
+	uint64_t word;
+	memcpy(&word, payload + (bitpos >> 3), sizeof(word));
+	uint32_t code = (word >> (bitpos & 7)) & (((uint64_t)1 << bits) - 1);
+	return (int)(code >> 1) ^ -(int)(code & 1);
+}
+
+static inline void BlockDecompressionStep(DecompressionCache& cache, unsigned channels)
+{
+	const BlockCompressionHeader* header = (const BlockCompressionHeader*)cache.ptr;
+	const unsigned char* payload = cache.ptr + sizeof(BlockCompressionHeader);
+	unsigned index = cache.position & (BLOCK_COMPRESSION_FRAMES - 1);
+	for (unsigned j = 0; j < channels; j++)
+	{
+		int delta = AudioReadBlockCompressed(payload, header->bits[j], index);
+		cache.last[j] = cache.prev[j];
+		cache.prev[j] = cache.value[j];
+		cache.value[j] = (index ? cache.prev[j] : header->value[j]) + delta;
+		StoreDecompressionHistory(cache, j);
+		payload += header->bits[j] * (BLOCK_COMPRESSION_FRAMES / 8);
+	}
+	cache.ptr += index == BLOCK_COMPRESSION_FRAMES - 1 ? header->size : 0;
+	cache.position++;
+}
+
+/* Seeks through the block index, so any position is at most one block of
+ * steps away */
+static inline void BlockDecompressTo(DecompressionCache& cache, unsigned position, const unsigned char* data, unsigned channels)
+{
+	if (!cache.ptr || cache.position > position + 1 || (position >> BLOCK_COMPRESSION_BITS) > (cache.position >> BLOCK_COMPRESSION_BITS))
+	{
+		const uint32_t* offsets = (const uint32_t*)data;
+		unsigned block = position >> BLOCK_COMPRESSION_BITS;
+		InitDecompressionCache(cache);
+		cache.position = block << BLOCK_COMPRESSION_BITS;
+		cache.ptr = data + offsets[block];
+	}
+	while(cache.position <= position)
+		BlockDecompressionStep(cache, channels);
+}
+
+/* Decoder policies for the compressed stream decoders */
+template<bool format16>
+struct PredictiveDecompression
+{
+	static inline void Step(DecompressionCache& cache, unsigned channels)
+	{
+		DecompressionStep(cache, channels, format16);
+	}
+};
+
+struct BlockDecompression
+{
+	static inline void Step(DecompressionCache& cache, unsigned channels)
+	{
+		BlockDecompressionStep(cache, channels);
+	}
+};
+
 #endif
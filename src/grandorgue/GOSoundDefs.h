@@ -16,6 +16,9 @@
 #define LINEAR_READAHEAD    (1)
 /* Maximum of the above values */
 #define MAX_READAHEAD       (8)
+/* Samples kept by the decompression cache for compressed polyphase
+ * interpolation (power of two, at least the polyphase filter length) */
+#define DECOMPRESSION_HISTORY  (8)
 /* Minimum remaining loop length after a crossfade */
 #define REMAINING_AFTER_CROSSFADE  256
 
@@ -25,6 +28,12 @@
 /* Maximum number of blocks (1 block is nChannels samples) per frame */
 #define MAX_FRAME_SIZE         (1024)
 
+/* Maximum number of periods rendered ahead of the audio callback */
+#define MAX_PRERENDER_PERIODS  (2)
+
+/* Number of samplers a sound thread claims at once from an audio group */
+#define SAMPLER_CHUNK_SIZE     (32)
+
 /* Maximum number of channels the engine supports. This value can not be
  * changed at present.
  */
@@ -8,6 +8,7 @@
 
 #include "GOSoundProvider.h"
 #include "GOSoundRecorder.h"
+#include "GOSoundReverb.h"
 #include "GOSoundSampler.h"
 #include "GOSoundGroupWorkItem.h"
 #include "GOSoundOutputWorkItem.h"
@@ -20,6 +21,16 @@
 #include "GOrgueReleaseAlignTable.h"
 #include "GOrgueWindchest.h"
 #include "GrandOrgueFile.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <math.h>
+
+/* Fade out times of stolen samplers in ms */
+#define SOFT_STEAL_FADE 370
+#define HARD_STEAL_FADE 20
+/* Assumed decay of a release in powers of two per second */
+#define RELEASE_DECAY_RATE 6
 
 GOSoundEngine::GOSoundEngine() :
 	m_PolyphonyLimiting(true),
@@ -32,7 +43,17 @@ GOSoundEngine::GOSoundEngine() :
 	m_Gain(1),
 	m_SampleRate(0),
 	m_CurrentTime(1),
+	m_TimeReference(GO_NO_TIME_REFERENCE),
 	m_SamplerPool(),
+	m_Streamer(),
+	m_Releases(),
+	m_FadingSamplers(0),
+	m_StolenSamplers(0),
+	m_DroppedSamplers(0),
+	m_CommittedTransactions(NULL),
+	m_FreeTransactions(NULL),
+	m_TransactionSize(0),
+	m_TransactionTime(0),
 	m_AudioGroupCount(1),
 	m_UsedPolyphony(0),
 	m_WorkerSlots(0),
@@ -48,6 +69,7 @@ GOSoundEngine::GOSoundEngine() :
 	memset(&m_ResamplerCoefs, 0, sizeof(m_ResamplerCoefs));
 	m_SamplerPool.SetUsageLimit(2048);
 	m_PolyphonySoftLimit = (m_SamplerPool.GetUsageLimit() * 3) / 4;
+	m_Releases.Reserve(m_SamplerPool.GetUsageLimit() + SAMPLER_STEAL_RESERVE);
 	m_ReleaseProcessor = new GOSoundReleaseWorkItem(*this, m_AudioGroups);
 	Reset();
 }
@@ -56,6 +78,8 @@ GOSoundEngine::~GOSoundEngine()
 {
 	if (m_ReleaseProcessor)
 		delete m_ReleaseProcessor;
+	FreeTransactions(m_CommittedTransactions.exchange(NULL));
+	FreeTransactions(m_FreeTransactions.exchange(NULL));
 }
 
 void GOSoundEngine::Reset()
@@ -77,7 +101,12 @@ void GOSoundEngine::Reset()
 	for (unsigned i = 0; i < m_AudioGroups.size(); i++)
 		m_Scheduler.Add(m_AudioGroups[i]);
 	for (unsigned i = 0; i < m_AudioOutputs.size(); i++)
+	{
 		m_Scheduler.Add(m_AudioOutputs[i]);
+		GOSoundReverb* reverb = m_AudioOutputs[i]->GetReverb();
+		for (unsigned j = 0; j < reverb->GetPartitionCount(); j++)
+			m_Scheduler.Add(reverb->GetPartition(j));
+	}
 	m_Scheduler.Add(m_AudioRecorder);
 	m_Scheduler.Add(m_ReleaseProcessor);
 	if (m_TouchProcessor)
@@ -85,8 +114,13 @@ void GOSoundEngine::Reset()
   }
 	m_UsedPolyphony = 0;
 
+	FreeTransactions(m_CommittedTransactions.exchange(NULL));
+	m_Releases.Clear();
 	m_SamplerPool.ReturnAll();
+	m_FadingSamplers = 0;
+	m_Streamer.Reset();
 	m_CurrentTime = 1;
+	m_TimeReference = GO_NO_TIME_REFERENCE;
 	m_Scheduler.Reset();
 }
 
@@ -126,6 +160,7 @@ void GOSoundEngine::SetHardPolyphony(unsigned polyphony)
 {
 	m_SamplerPool.SetUsageLimit(polyphony);
 	m_PolyphonySoftLimit = (m_SamplerPool.GetUsageLimit() * 3) / 4;
+	m_Releases.Reserve(m_SamplerPool.GetUsageLimit() + SAMPLER_STEAL_RESERVE);
 }
 
 void GOSoundEngine::SetReleaseLength(unsigned reverb)
@@ -200,7 +235,7 @@ void GOSoundEngine::PassSampler(GO_SAMPLER* sampler)
 	}
 }
 
-void GOSoundEngine::StartSampler(GO_SAMPLER* sampler, int sampler_group_id, unsigned audio_group)
+void GOSoundEngine::InitSampler(GO_SAMPLER* sampler, int sampler_group_id, unsigned audio_group)
 {
 	if (audio_group >= m_AudioGroupCount)
 		audio_group = 0;
@@ -210,21 +245,16 @@ void GOSoundEngine::StartSampler(GO_SAMPLER* sampler, int sampler_group_id, unsi
 	sampler->stop = 0;
 	sampler->new_attack = 0;
 
-	if (sampler_group_id == 0)
-	{
-		sampler->windchest = m_Windchests[sampler_group_id];
-		m_AudioGroups[audio_group]->Add(sampler);
-	}
-	else if (sampler_group_id < 0)
-	{
+	if (sampler_group_id < 0)
 		sampler->windchest = NULL;
-		m_Tremulants[-1-sampler_group_id]->Add(sampler);
-	}
 	else
-	{
 		sampler->windchest = m_Windchests[sampler_group_id];
-		m_AudioGroups[audio_group]->Add(sampler);
-	}
+}
+
+void GOSoundEngine::StartSampler(GO_SAMPLER* sampler, int sampler_group_id, unsigned audio_group)
+{
+	InitSampler(sampler, sampler_group_id, audio_group);
+	PassSampler(sampler);
 }
 
 void GOSoundEngine::ClearSetup()
@@ -234,6 +264,7 @@ void GOSoundEngine::ClearSetup()
 	m_Windchests.clear();
 	m_Tremulants.clear();
 	m_TouchProcessor = NULL;
+	m_Streamer.Stop();
 	Reset();
 }
 
@@ -251,25 +282,78 @@ void GOSoundEngine::Setup(GrandOrgueFile* organ_file, unsigned release_count)
 	for(unsigned i = 0; i < organ_file->GetWindchestGroupCount(); i++)
 		m_Windchests.push_back(new GOSoundWindchestWorkItem(*this, organ_file->GetWindchest(i)));
 	m_TouchProcessor = std::unique_ptr<GOSoundTouchWorkItem>(new GOSoundTouchWorkItem(organ_file->GetMemoryPool()));
+	if (organ_file->GetMemoryPool().IsCacheResident())
+		m_Streamer.Stop();
+	else
+		m_Streamer.Start();
+	m_StolenSamplers = 0;
+	m_DroppedSamplers = 0;
 	m_HasBeenSetup = true;
 	Reset();
 }
 
 bool GOSoundEngine::ProcessSampler(float *output_buffer, GO_SAMPLER* sampler, unsigned n_frames, float volume)
 {
-	const unsigned block_time = n_frames;
 	float temp[n_frames * 2];
-	const bool process_sampler = (sampler->time <= m_CurrentTime);
+	return MixSampler(output_buffer, temp, sampler, n_frames, volume);
+}
 
-	if (process_sampler)
+/* Processes a chunk of samplers of one audio group and compacts the
+ * samplers which keep playing to the start of the array.
+ *
+ * The chunk is grouped by decode function first, so consecutive indirect
+ * calls go to the same kernel, and all samplers share one scratch buffer.
+ * While a sampler is mixed, the state of the one after next and the sample
+ * data of the next one are prefetched. */
+unsigned GOSoundEngine::ProcessSamplers(float *output_buffer, GO_SAMPLER** samplers, unsigned count, unsigned n_frames)
+{
+	float temp[n_frames * 2];
+	std::sort(samplers, samplers + count, [](const GO_SAMPLER* a, const GO_SAMPLER* b) {
+		return std::less<DecodeBlockFunction>()(a->stream.decode_call, b->stream.decode_call);
+	});
+
+	if (count > 0)
+		GOAudioSection::PrefetchStream(&samplers[0]->stream);
+	if (count > 1)
+		GO_PREFETCH(samplers[1]);
+	unsigned kept = 0;
+	for(unsigned i = 0; i < count; i++)
 	{
+		GO_SAMPLER* sampler = samplers[i];
+		if (i + 2 < count)
+			GO_PREFETCH(samplers[i + 2]);
+		if (i + 1 < count)
+			GOAudioSection::PrefetchStream(&samplers[i + 1]->stream);
+		if (MixSampler(output_buffer, temp, sampler, n_frames, sampler->windchest->GetVolume()))
+			samplers[kept++] = sampler;
+	}
+	return kept;
+}
 
-		if  (sampler->is_release &&
-		     ((m_PolyphonyLimiting && m_SamplerPool.UsedSamplerCount() >= m_PolyphonySoftLimit && m_CurrentTime - sampler->time > 172 * 16) ||
-		      sampler->drop_counter > 1))
-			sampler->fader.StartDecay(370, m_SampleRate); /* Approx 0.37s at 44.1kHz */
+/* Samplers may start, stop or switch at any frame of a period. The part of
+ * the period before the start is skipped, a pending decay splits the mixing
+ * at its frame. Stops and switches are handed to the release processor one
+ * period ahead, so the release or new attack can begin at the exact frame. */
+bool GOSoundEngine::MixSampler(float *output_buffer, float *temp, GO_SAMPLER* sampler, unsigned n_frames, float volume)
+{
+	const unsigned block_time = n_frames;
+	const uint64_t block_end = m_CurrentTime + n_frames;
+	const bool process_sampler = (sampler->time < block_end);
 
-		if (sampler->stop && sampler->stop <= m_CurrentTime && sampler->stop - sampler->time <= block_time)
+	if (process_sampler)
+	{
+		const unsigned start = sampler->time > m_CurrentTime ? sampler->time - m_CurrentTime : 0;
+		const bool transition =
+			(sampler->stop && sampler->stop < block_end + block_time) ||
+			(sampler->new_attack && sampler->new_attack < block_end + block_time);
+
+		const unsigned steal_fade = GOSoundSamplerHeap::GetStealFade(sampler);
+		if (steal_fade)
+			sampler->fader.StartDecay(steal_fade, m_SampleRate);
+		else if (sampler->is_release && sampler->drop_counter > 1)
+			sampler->fader.StartDecay(SOFT_STEAL_FADE, m_SampleRate);
+
+		if (sampler->stop && transition && sampler->stop <= sampler->time + block_time)
 			sampler->pipe = NULL;
 
 		/* The decoded sampler frame will contain values containing
@@ -279,21 +363,44 @@ bool GOSoundEngine::ProcessSampler(float *output_buffer, GO_SAMPLER* sampler, un
 		 * fade parameters. The gain target should be:
 		 *
 		 *     playback gain * (2 ^ -sampler->pipe_section->sample_bits)
+		 *
+		 * An aligned stream was positioned for the start of the period, so
+		 * it is decoded from there and the frames before its start dropped.
 		 */
-		if (!GOAudioSection::ReadBlock(&sampler->stream, temp, n_frames))
+		unsigned count = n_frames - start;
+		float* in = temp;
+		float* out = output_buffer + 2 * start;
+		if (sampler->align_start && start)
+		{
+			if (!GOAudioSection::ReadBlock(&sampler->stream, temp, n_frames))
+				sampler->pipe = NULL;
+			in += 2 * start;
+		}
+		else if (!GOAudioSection::ReadBlock(&sampler->stream, temp, count))
 			sampler->pipe = NULL;
+		sampler->align_start = false;
 
-		sampler->fader.Process(n_frames, temp, volume);
-		
-		/* Add these samples to the current output buffer shifting
-		 * right by the necessary amount to bring the sample gain back
-		 * to unity (this value is computed in GOrguePipe.cpp)
+		/* Fade the samples and add them to the current output buffer in
+		 * one pass. The fader gain also brings the sample gain back to
+		 * unity (this value is computed in GOrguePipe.cpp)
 		 */
-		for(unsigned i = 0; i < n_frames * 2; i++)
-			output_buffer[i] += temp[i];
+		if (sampler->decay_time && sampler->decay_time < block_end)
+		{
+			unsigned split = sampler->decay_time > m_CurrentTime + start ? sampler->decay_time - m_CurrentTime - start : 0;
+			if (split)
+			{
+				sampler->fader.ProcessAndAdd(split, in, out, volume);
+				in += 2 * split;
+				out += 2 * split;
+				count -= split;
+			}
+			if (sampler->pipe)
+				sampler->fader.StartDecay(sampler->pipe->GetReleaseCrossfadeLength(), m_SampleRate);
+			sampler->decay_time = 0;
+		}
+		sampler->fader.ProcessAndAdd(count, in, out, volume);
 
-		if ((sampler->stop && sampler->stop <= m_CurrentTime) ||
-		    (sampler->new_attack && sampler->new_attack <= m_CurrentTime))
+		if (transition)
 		{
 			m_ReleaseProcessor->Add(sampler);
 			return false;
@@ -326,6 +433,9 @@ void GOSoundEngine::ProcessRelease(GO_SAMPLER* sampler)
 
 void GOSoundEngine::ReturnSampler(GO_SAMPLER* sampler)
 {
+	if (m_Releases.Remove(sampler))
+		m_FadingSamplers.fetch_add(-1);
+	GOAudioSection::ReleaseStream(&sampler->stream);
 	m_SamplerPool.ReturnSampler(sampler);
 }
 
@@ -398,7 +508,16 @@ void GOSoundEngine::SetupReverb(GOrgueSettings& settings)
 {
 	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
 		if (m_AudioOutputs[i])
+		{
+			/* The partitions of the old reverb are replaced */
+			GOSoundReverb* reverb = m_AudioOutputs[i]->GetReverb();
+			for(unsigned j = 0; j < reverb->GetPartitionCount(); j++)
+				m_Scheduler.Remove(reverb->GetPartition(j));
 			m_AudioOutputs[i]->SetupReverb(settings);
+			if (m_HasBeenSetup)
+				for(unsigned j = 0; j < reverb->GetPartitionCount(); j++)
+					m_Scheduler.Add(reverb->GetPartition(j));
+		}
 }
 
 void GOSoundEngine::GetAudioOutput(float *output_buffer, unsigned n_frames, unsigned audio_output, bool last)
@@ -412,26 +531,59 @@ void GOSoundEngine::NextPeriod()
 	m_Scheduler.Exec();
 
 	m_CurrentTime += m_SamplesPerBuffer;
+	ApplyTransactions();
+	m_Releases.Update();
 	unsigned used_samplers = m_SamplerPool.UsedSamplerCount();
 	if (used_samplers > m_UsedPolyphony)
 			m_UsedPolyphony = used_samplers;
 
+	/* Above the soft limit, the least audible releases are faded out */
+	if (m_PolyphonyLimiting)
+		while((int)m_SamplerPool.UsedSamplerCount() - m_FadingSamplers >= (int)m_PolyphonySoftLimit)
+			if (!StealSampler(SOFT_STEAL_FADE))
+				break;
+
 	m_Scheduler.Reset();
 }
 
+/* The reference maps the wall clock of the MIDI events to sample positions.
+ * It is refreshed after every period, so the mapping follows the drift of
+ * the audio clock. */
+void GOSoundEngine::SetTimeReference(int64_t time, uint64_t position)
+{
+	m_TimeReference = (int64_t)position - time * m_SampleRate / 1000;
+}
 
-GO_SAMPLER* GOSoundEngine::StartSample(const GOSoundProvider* pipe, int sampler_group_id, unsigned audio_group, unsigned velocity, unsigned delay, uint64_t last_stop)
+/* Returns the frame offset relative to the current time, at which an event
+ * of the given time (in ms) should start. Late events start at once, the
+ * offset is limited to the period after the current one. */
+unsigned GOSoundEngine::GetEventOffset(int64_t time)
+{
+	int64_t reference = m_TimeReference;
+	if (reference == GO_NO_TIME_REFERENCE)
+		return 0;
+	int64_t offset = reference + time * m_SampleRate / 1000 - (int64_t)m_CurrentTime;
+	if (offset <= 0)
+		return 0;
+	if (offset >= 2 * m_SamplesPerBuffer)
+		return 2 * m_SamplesPerBuffer - 1;
+	return offset;
+}
+
+GO_SAMPLER* GOSoundEngine::StartSample(const GOSoundProvider* pipe, int sampler_group_id, unsigned audio_group, unsigned velocity, unsigned delay, uint64_t last_stop, unsigned offset)
 {
 	unsigned delay_samples = (delay * m_SampleRate) / (1000);
-	uint64_t start_time = m_CurrentTime + delay_samples;
-	uint64_t released_time = ((start_time - last_stop) * 1000) / m_SampleRate;
+	uint64_t start_time = m_CurrentTime + delay_samples + offset;
+	/* A stop inside a transaction returns the earliest time it may be
+	 * applied, which can be up to a period after this start */
+	uint64_t released_time = start_time > last_stop ? ((start_time - last_stop) * 1000) / m_SampleRate : 0;
 	if (released_time > (unsigned)-1)
 		released_time = (unsigned)-1;
 
 	const GOAudioSection* attack = pipe->GetAttack(velocity, released_time);
 	if (!attack || attack->GetChannels() == 0)
 		return NULL;
-	GO_SAMPLER* sampler = m_SamplerPool.GetSampler();
+	GO_SAMPLER* sampler = AllocSampler();
 	if (sampler)
 	{
 		sampler->pipe = pipe;
@@ -440,13 +592,16 @@ GO_SAMPLER* GOSoundEngine::StartSample(const GOSoundProvider* pipe, int sampler_
 			(&m_ResamplerCoefs
 			,&sampler->stream
 			,GetRandomFactor() * pipe->GetTuning() / (float)m_SampleRate
+			,&m_Streamer
 			);
 		const float playback_gain = pipe->GetGain() * attack->GetNormGain();
 		sampler->fader.NewConstant(playback_gain);
 		sampler->delay = delay_samples;
 		sampler->time = start_time;
 		sampler->fader.SetVelocityVolume(sampler->pipe->GetVelocityVolume(sampler->velocity));
-		StartSampler(sampler, sampler_group_id, audio_group);
+		InitSampler(sampler, sampler_group_id, audio_group);
+		if (!AddTransaction(GO_TRANSACTION_START, sampler, delay_samples + offset))
+			PassSampler(sampler);
 	}
 	return sampler;
 }
@@ -465,24 +620,29 @@ void GOSoundEngine::SwitchAttackSampler(GO_SAMPLER* handle)
 	if (handle->is_release)
 		return;
 
-	GO_SAMPLER* new_sampler = m_SamplerPool.GetSampler();
+	GO_SAMPLER* new_sampler = AllocSampler();
 	if (new_sampler != NULL)
 	{
+		uint64_t switch_time = GetTransitionTime(handle->new_attack);
+		unsigned generation = new_sampler->generation;
 		*new_sampler = *handle;
+		new_sampler->generation = generation;
 		
 		handle->pipe = this_pipe;
-		handle->time = m_CurrentTime + 1;
+		handle->time = switch_time;
+		handle->align_start = true;
 
 		float gain_target = this_pipe->GetGain() * section->GetNormGain();
 		unsigned cross_fade_len = this_pipe->GetReleaseCrossfadeLength();
 		handle->fader.NewAttacking(gain_target, cross_fade_len, m_SampleRate);
 
-		section->InitAlignedStream(&handle->stream, &new_sampler->stream);
+		section->InitAlignedStream(&handle->stream, &new_sampler->stream, &m_Streamer);
 		handle->is_release = false;
 		new_sampler->is_release = true;
 		new_sampler->time = m_CurrentTime;
-		new_sampler->fader.StartDecay(cross_fade_len, m_SampleRate);
+		new_sampler->decay_time = switch_time;
 		new_sampler->fader.SetVelocityVolume(new_sampler->pipe->GetVelocityVolume(new_sampler->velocity));
+		AddRelease(new_sampler);
 
 		StartSampler(new_sampler, new_sampler->sampler_group_id, new_sampler->audio_group_id);
 	}
@@ -498,9 +658,13 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 	 * in either the attack or loop section) and sets the fadeout property
 	 * which will decay this portion of the pipe. The sampler will
 	 * automatically be placed back in the pool when the fade restores to
-	 * zero. */
-	unsigned cross_fade_len = handle->pipe->GetReleaseCrossfadeLength();
-	handle->fader.StartDecay(cross_fade_len, m_SampleRate);
+	 * zero. Both start at the frame of the stop. */
+	uint64_t release_time = GetTransitionTime(handle->stop);
+	/* The stop of a sampler, which was started by a transaction, may have
+	 * been computed before the start was moved to the period boundary */
+	if (release_time < handle->time)
+		release_time = handle->time;
+	handle->decay_time = release_time;
 	handle->is_release = true;
 
 	const GOSoundProvider* this_pipe = handle->pipe;
@@ -511,15 +675,15 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 	// against a double. We should test against a minimum level.
 	if (vol)
 	{
-		const GOAudioSection* release_section = this_pipe->GetRelease(&handle->stream, ((double)(m_CurrentTime - handle->time)) / m_SampleRate);
+		const GOAudioSection* release_section = this_pipe->GetRelease(&handle->stream, ((double)(release_time - handle->time)) / m_SampleRate);
 		if (!release_section)
 			return;
 
-		GO_SAMPLER* new_sampler = m_SamplerPool.GetSampler();
+		GO_SAMPLER* new_sampler = AllocSampler();
 		if (new_sampler != NULL)
 		{
 			new_sampler->pipe = this_pipe;
-			new_sampler->time = m_CurrentTime + 1;
+			new_sampler->time = release_time;
 			new_sampler->velocity = handle->velocity;
 
 			unsigned gain_decay_length = 0;
@@ -536,7 +700,7 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 				if (m_ScaledReleases)
 				{
 					/* Note: "time" is in milliseconds. */
-					int time = ((m_CurrentTime - handle->time) * 1000) / m_SampleRate;
+					int time = ((release_time - handle->time) * 1000) / m_SampleRate;
 					/* TODO: below code should be replaced by a more accurate model of the attack to get a better estimate of the amplitude when playing very short notes
 					* estimating attack duration from pipe midi pitch */
 					unsigned midikey_frequency = this_pipe->GetMidiKeyNumber();
@@ -590,11 +754,12 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 
 			if (m_ReleaseAlignmentEnabled && release_section->SupportsStreamAlignment())
 			{
-				release_section->InitAlignedStream(&new_sampler->stream, &handle->stream);
+				release_section->InitAlignedStream(&new_sampler->stream, &handle->stream, &m_Streamer);
+				new_sampler->align_start = true;
 			}
 			else
 			{
-				release_section->InitStream(&m_ResamplerCoefs, &new_sampler->stream, this_pipe->GetTuning() / (float)m_SampleRate);
+				release_section->InitStream(&m_ResamplerCoefs, &new_sampler->stream, this_pipe->GetTuning() / (float)m_SampleRate, &m_Streamer);
 			}
 			new_sampler->is_release = true;
 
@@ -613,6 +778,7 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 				windchest_index = handle->sampler_group_id;
 			}
 			new_sampler->fader.SetVelocityVolume(new_sampler->pipe->GetVelocityVolume(new_sampler->velocity));
+			AddRelease(new_sampler);
 			StartSampler(new_sampler, windchest_index, handle->audio_group_id);
 			handle->time = m_CurrentTime;
 		}
@@ -621,7 +787,46 @@ void GOSoundEngine::CreateReleaseSampler(GO_SAMPLER* handle)
 }
 
 
-uint64_t GOSoundEngine::StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle)
+/* At the hard limit, the least audible release is stolen. Until it has
+ * faded out, its replacement comes from the reserve of the pool. */
+GO_SAMPLER* GOSoundEngine::AllocSampler()
+{
+	GO_SAMPLER* sampler = m_SamplerPool.GetSampler();
+	if (!sampler && StealSampler(HARD_STEAL_FADE))
+		sampler = m_SamplerPool.GetSampler(true);
+	if (!sampler)
+		m_DroppedSamplers.fetch_add(1);
+	return sampler;
+}
+
+/* The fade is started by MixSampler, which owns the fader */
+bool GOSoundEngine::StealSampler(unsigned fade)
+{
+	if (!m_Releases.Steal(fade))
+		return false;
+	m_FadingSamplers.fetch_add(1);
+	m_StolenSamplers.fetch_add(1);
+	return true;
+}
+
+/* A release is assumed to decay by RELEASE_DECAY_RATE (in powers of two per
+ * second). As all releases share this rate, the audibility, which is the
+ * level at the time 0, keeps the order of the releases while they play. */
+void GOSoundEngine::AddRelease(GO_SAMPLER* sampler)
+{
+	float gain = std::max(sampler->fader.GetTargetGain(), 1e-10f);
+	sampler->audibility = log2f(gain) + RELEASE_DECAY_RATE * (float)((double)sampler->time / m_SampleRate);
+	m_Releases.Add(sampler);
+}
+
+/* A stop or switch takes effect at its own frame, but not before the next
+ * period, as the current one is already mixed */
+uint64_t GOSoundEngine::GetTransitionTime(uint64_t time)
+{
+	return std::max(time, m_CurrentTime + m_SamplesPerBuffer);
+}
+
+uint64_t GOSoundEngine::StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle, unsigned offset)
 {
 
 	assert(handle);
@@ -634,11 +839,15 @@ uint64_t GOSoundEngine::StopSample(const GOSoundProvider *pipe, GO_SAMPLER* hand
 	if (pipe != handle->pipe)
 		return 0;
 
-	handle->stop = m_CurrentTime + handle->delay;
+	/* The earliest time of a queued stop, it is applied at the boundary
+	 * after the commit, which may be a later one */
+	if (AddTransaction(GO_TRANSACTION_STOP, handle, handle->delay + offset))
+		return m_CurrentTime + m_SamplesPerBuffer + handle->delay + offset;
+	handle->stop = m_CurrentTime + handle->delay + offset;
 	return handle->stop;
 }
 
-void GOSoundEngine::SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle)
+void GOSoundEngine::SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle, unsigned offset)
 {
 
 	assert(handle);
@@ -651,7 +860,9 @@ void GOSoundEngine::SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle
 	if (pipe != handle->pipe)
 		return;
 
-	handle->new_attack = m_CurrentTime + handle->delay;
+	if (AddTransaction(GO_TRANSACTION_SWITCH, handle, handle->delay + offset))
+		return;
+	handle->new_attack = m_CurrentTime + handle->delay + offset;
 }
 
 void GOSoundEngine::UpdateVelocity(GO_SAMPLER* handle, unsigned velocity)
@@ -662,6 +873,162 @@ void GOSoundEngine::UpdateVelocity(GO_SAMPLER* handle, unsigned velocity)
 	handle->fader.SetVelocityVolume(handle->pipe->GetVelocityVolume(handle->velocity));
 }
 
+/* The open transaction of the calling thread, so notes played on one
+ * thread never end up in a combination pushed on another one */
+static thread_local unsigned t_TransactionDepth = 0;
+static thread_local GOSoundTransactionBatch* t_Transaction = NULL;
+
+void GOSoundEngine::BeginTransaction()
+{
+	if (t_TransactionDepth++)
+		return;
+	/* Reuse an applied batch, the others are freed here and not in the
+	 * sound thread */
+	GOSoundTransactionBatch* batch = m_FreeTransactions.exchange(NULL);
+	if (batch)
+	{
+		FreeTransactions(batch->next);
+		batch->entries.clear();
+	}
+	else
+		batch = new GOSoundTransactionBatch;
+	batch->next = NULL;
+	t_Transaction = batch;
+}
+
+void GOSoundEngine::CommitTransaction()
+{
+	if (!t_TransactionDepth || --t_TransactionDepth)
+		return;
+	GOSoundTransactionBatch* batch = t_Transaction;
+	t_Transaction = NULL;
+	if (batch->entries.size())
+		PushTransactions(m_CommittedTransactions, batch, batch);
+	else
+		PushTransactions(m_FreeTransactions, batch, batch);
+}
+
+/* Returns false, if no transaction is open and the change must be applied
+ * at once */
+bool GOSoundEngine::AddTransaction(GOSoundTransactionType type, GO_SAMPLER* sampler, unsigned offset)
+{
+	if (!t_TransactionDepth)
+		return false;
+	GOSoundTransactionEntry entry = { type, sampler, sampler->generation, offset };
+	t_Transaction->entries.push_back(entry);
+	return true;
+}
+
+/* Lock free push of the chain first..last onto the list. Batches are only
+ * removed by taking the whole list, so there is no ABA problem. */
+void GOSoundEngine::PushTransactions(atomic<GOSoundTransactionBatch*>& list, GOSoundTransactionBatch* first, GOSoundTransactionBatch* last)
+{
+	GOSoundTransactionBatch* head = list;
+	do
+		last->next = head;
+	while (!list.compare_exchange(head, first));
+}
+
+void GOSoundEngine::FreeTransactions(GOSoundTransactionBatch* batch)
+{
+	while (batch)
+	{
+		GOSoundTransactionBatch* next = batch->next;
+		delete batch;
+		batch = next;
+	}
+}
+
+/* Called at the period boundary, when no sampler is mixed. The samplers of
+ * a transaction are only passed to the audio groups here, so all changes of
+ * one control action start in the same period. Every transaction committed
+ * before the boundary is applied, no lock is taken. */
+void GOSoundEngine::ApplyTransactions()
+{
+	GOSoundTransactionBatch* batch = m_CommittedTransactions.exchange(NULL);
+	if (!batch)
+		return;
+
+	/* Apply the batches in the order of their commits */
+	GOSoundTransactionBatch* first = NULL;
+	GOSoundTransactionBatch* last = batch;
+	while (batch)
+	{
+		GOSoundTransactionBatch* next = batch->next;
+		batch->next = first;
+		first = batch;
+		batch = next;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned count = 0;
+	for(batch = first; batch; batch = batch->next)
+	{
+		count += batch->entries.size();
+		for(unsigned i = 0; i < batch->entries.size(); i++)
+		{
+			const GOSoundTransactionEntry& entry = batch->entries[i];
+			GO_SAMPLER* sampler = entry.sampler;
+			switch(entry.type)
+			{
+			case GO_TRANSACTION_START:
+				sampler->time = m_CurrentTime + entry.offset;
+				/* A stop or switch outside of the transaction may already
+				 * have been set against the earlier start time */
+				if (sampler->stop && sampler->stop < sampler->time)
+					sampler->stop = sampler->time;
+				if (sampler->new_attack && sampler->new_attack < sampler->time)
+					sampler->new_attack = sampler->time;
+				PassSampler(sampler);
+				break;
+
+			case GO_TRANSACTION_STOP:
+				/* The sampler may have decayed and been reused meanwhile,
+				 * even by the same pipe */
+				if (sampler->generation == entry.generation)
+					sampler->stop = m_CurrentTime + entry.offset;
+				break;
+
+			case GO_TRANSACTION_SWITCH:
+				if (sampler->generation == entry.generation)
+					sampler->new_attack = m_CurrentTime + entry.offset;
+				break;
+			}
+		}
+	}
+	m_TransactionSize = count;
+	m_TransactionTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	/* The batches are freed or reused by the next BeginTransaction */
+	PushTransactions(m_FreeTransactions, first, last);
+}
+
+unsigned GOSoundEngine::GetStreamUnderruns() const
+{
+	return m_Streamer.GetUnderruns();
+}
+
+unsigned GOSoundEngine::GetStolenSamplers() const
+{
+	return m_StolenSamplers;
+}
+
+unsigned GOSoundEngine::GetDroppedSamplers() const
+{
+	return m_DroppedSamplers;
+}
+
+/* Number of changes in the last applied transactions */
+unsigned GOSoundEngine::GetTransactionSize() const
+{
+	return m_TransactionSize;
+}
+
+/* Time in us to apply the last transactions */
+unsigned GOSoundEngine::GetTransactionTime() const
+{
+	return m_TransactionTime;
+}
+
 const std::vector<double>& GOSoundEngine::GetMeterInfo()
 {
 	m_MeterInfo[0] = m_UsedPolyphony / (double)GetHardPolyphony();
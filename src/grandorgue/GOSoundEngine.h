@@ -9,7 +9,10 @@
 
 #include "GOSoundResample.h"
 #include "GOSoundScheduler.h"
+#include "GOSoundSamplerHeap.h"
 #include "GOSoundSamplerPool.h"
+#include "GOSoundStreamer.h"
+#include "threading/atomic.h"
 #include <vector>
 
 class GOrgueWindchest;
@@ -33,6 +36,32 @@ typedef struct
 
 class GO_SAMPLER;
 
+typedef enum
+{
+	GO_TRANSACTION_START,
+	GO_TRANSACTION_STOP,
+	GO_TRANSACTION_SWITCH
+} GOSoundTransactionType;
+
+typedef struct
+{
+	GOSoundTransactionType type;
+	GO_SAMPLER* sampler;
+	/* generation of the sampler, when the change was made */
+	unsigned generation;
+	/* Frames after the start of the period, in which it is applied */
+	unsigned offset;
+} GOSoundTransactionEntry;
+
+/* The changes of one committed transaction */
+typedef struct GOSoundTransactionBatch
+{
+	std::vector<GOSoundTransactionEntry> entries;
+	struct GOSoundTransactionBatch* next;
+} GOSoundTransactionBatch;
+
+#define GO_NO_TIME_REFERENCE INT64_MIN
+
 class GOSoundEngine
 {
 private:
@@ -48,7 +77,20 @@ private:
 	float                         m_Gain;
 	unsigned                      m_SampleRate;
 	uint64_t                      m_CurrentTime;
+	atomic<int64_t>               m_TimeReference;
 	GOSoundSamplerPool            m_SamplerPool;
+	GOSoundStreamer               m_Streamer;
+	/* The releases, which may be stolen */
+	GOSoundSamplerHeap            m_Releases;
+	atomic_int                    m_FadingSamplers;
+	atomic_uint                   m_StolenSamplers;
+	atomic_uint                   m_DroppedSamplers;
+	/* Committed transactions, which wait for the next period boundary,
+	 * newest first, and the applied ones, which may be reused */
+	atomic<GOSoundTransactionBatch*> m_CommittedTransactions;
+	atomic<GOSoundTransactionBatch*> m_FreeTransactions;
+	atomic_uint                   m_TransactionSize;
+	atomic_uint                   m_TransactionTime;
 	unsigned                      m_AudioGroupCount;
 	unsigned m_UsedPolyphony;
 	unsigned                      m_WorkerSlots;
@@ -72,10 +114,20 @@ private:
 	   0 detached release
 	   1 .. n Windchests
 	*/
+	void InitSampler(GO_SAMPLER* sampler, int sampler_group_id, unsigned audio_group);
 	void StartSampler(GO_SAMPLER* sampler, int sampler_group_id, unsigned audio_group);
 	void CreateReleaseSampler(GO_SAMPLER* sampler);
 	void SwitchAttackSampler(GO_SAMPLER* sampler);
+	uint64_t GetTransitionTime(uint64_t time);
+	GO_SAMPLER* AllocSampler();
+	bool StealSampler(unsigned fade);
+	void AddRelease(GO_SAMPLER* sampler);
+	bool AddTransaction(GOSoundTransactionType type, GO_SAMPLER* sampler, unsigned offset);
+	static void PushTransactions(atomic<GOSoundTransactionBatch*>& list, GOSoundTransactionBatch* first, GOSoundTransactionBatch* last);
+	static void FreeTransactions(GOSoundTransactionBatch* batch);
+	void ApplyTransactions();
 	float GetRandomFactor();
+	bool MixSampler(float *output_buffer, float *temp, GO_SAMPLER* sampler, unsigned n_frames, float volume);
 
 public:
 
@@ -101,18 +153,31 @@ public:
 	void SetRandomizeSpeaking(bool enable);
 	void SetReleaseLength(unsigned reverb);
 	const std::vector<double>& GetMeterInfo();
+	unsigned GetStreamUnderruns() const;
+	unsigned GetStolenSamplers() const;
+	unsigned GetDroppedSamplers() const;
+	unsigned GetTransactionSize() const;
+	unsigned GetTransactionTime() const;
 	void SetAudioRecorder(GOSoundRecorder* recorder, bool downmix);
 
-	GO_SAMPLER* StartSample(const GOSoundProvider *pipe, int sampler_group_id, unsigned audio_group, unsigned velocity, unsigned delay, uint64_t last_stop);
-	uint64_t StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle);
-	void SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle);
+	GO_SAMPLER* StartSample(const GOSoundProvider *pipe, int sampler_group_id, unsigned audio_group, unsigned velocity, unsigned delay, uint64_t last_stop, unsigned offset = 0);
+	uint64_t StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle, unsigned offset = 0);
+	void SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle, unsigned offset = 0);
 	void UpdateVelocity(GO_SAMPLER* handle, unsigned velocity);
+	/* Starts and stops between these calls take effect together at the
+	 * next period boundary. Transactions belong to the calling thread and
+	 * may be nested, use GOSoundTransaction to open one. */
+	void BeginTransaction();
+	void CommitTransaction();
 
 	void GetAudioOutput(float *output_buffer, unsigned n_frames, unsigned audio_output, bool last);
 	void NextPeriod();
+	void SetTimeReference(int64_t time, uint64_t position);
+	unsigned GetEventOffset(int64_t time);
 	GOSoundScheduler& GetScheduler();
 
 	bool ProcessSampler(float *buffer, GO_SAMPLER* sampler, unsigned n_frames, float volume);
+	unsigned ProcessSamplers(float *buffer, GO_SAMPLER** samplers, unsigned count, unsigned n_frames);
 	void ProcessRelease(GO_SAMPLER* sampler);
 	void PassSampler(GO_SAMPLER* sampler);
 	void ReturnSampler(GO_SAMPLER* sampler);
@@ -123,4 +188,29 @@ public:
 	}
 };
 
+/* Keeps a transaction of the calling thread open for its lifetime, so it
+ * is committed on every path and on the engine it was opened on */
+class GOSoundTransaction
+{
+private:
+	GOSoundEngine* m_Engine;
+
+public:
+	GOSoundTransaction(GOSoundEngine* engine) :
+		m_Engine(engine)
+	{
+		if (m_Engine)
+			m_Engine->BeginTransaction();
+	}
+
+	~GOSoundTransaction()
+	{
+		if (m_Engine)
+			m_Engine->CommitTransaction();
+	}
+
+	GOSoundTransaction(const GOSoundTransaction&) = delete;
+	GOSoundTransaction& operator=(const GOSoundTransaction&) = delete;
+};
+
 #endif /* GOSOUNDENGINE_H_ */
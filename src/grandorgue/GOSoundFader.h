@@ -33,11 +33,15 @@ public:
 	void StartDecay(unsigned ms, unsigned sample_rate);
 	bool IsSilent();
 	void SetVelocityVolume(float volume);
+	float GetTargetGain();
 
 	FaderState SetupProcess(unsigned n_blocks, float volume);
 	void ProcessData(FaderState& state, unsigned n_blocks, float *buffer);
+	void ProcessDataAdd(FaderState& state, unsigned n_blocks, const float *input, float *output);
 
 	void Process(unsigned n_blocks, float *buffer, float volume);
+	/* Fade input and add it to output in one pass */
+	void ProcessAndAdd(unsigned n_blocks, const float *input, float *output, float volume);
 };
 
 inline
@@ -108,6 +112,28 @@ void GOSoundFader::ProcessData(FaderState& state, unsigned n_blocks, float *buff
 	}
 }
 
+inline
+void GOSoundFader::ProcessDataAdd(FaderState& state, unsigned n_blocks, const float *input, float *output)
+{
+	if (state.gain_delta)
+	{
+		for(unsigned int i = 0; i < n_blocks; i++, input += 2, output += 2)
+		{
+			output[0] += input[0] * state.gain;
+			output[1] += input[1] * state.gain;
+			state.gain += state.gain_delta;
+		}
+	}
+	else if (state.gain)
+	{
+		for(unsigned int i = 0; i < n_blocks; i++, input += 2, output += 2)
+		{
+			output[0] += input[0] * state.gain;
+			output[1] += input[1] * state.gain;
+		}
+	}
+}
+
 inline
 void GOSoundFader::Process(unsigned n_blocks, float *buffer, float volume)
 {
@@ -115,6 +141,13 @@ void GOSoundFader::Process(unsigned n_blocks, float *buffer, float volume)
 	ProcessData(state, n_blocks, buffer);
 }
 
+inline
+void GOSoundFader::ProcessAndAdd(unsigned n_blocks, const float *input, float *output, float volume)
+{
+	FaderState state = SetupProcess(n_blocks, volume);
+	ProcessDataAdd(state, n_blocks, input, output);
+}
+
 inline
 void GOSoundFader::StartDecay(unsigned n_frames)
 {
@@ -156,6 +189,12 @@ void GOSoundFader::SetVelocityVolume(float volume)
 	m_VelocityVolume = volume;
 }
 
+inline
+float GOSoundFader::GetTargetGain()
+{
+	return m_target * m_VelocityVolume;
+}
+
 inline
 void GOSoundFader::NewAttacking(float target_gain, unsigned ms, unsigned sample_rate)
 {
@@ -6,25 +6,32 @@
 
 #include "GOSoundGroupWorkItem.h"
 
+#include "GOSoundDefs.h"
 #include "GOSoundEngine.h"
 #include "GOSoundWindchestWorkItem.h"
 #include "threading/GOMutexLocker.h"
+#include <thread>
+
+/* How often a thread retries before it stops waiting for the first thread
+ * to set up the item, for the merge lock or for the last mixing thread */
+#define GROUP_INIT_SPIN 64
+#define GROUP_MERGE_SPIN 64
+#define GROUP_FINISH_SPIN 256
 
 GOSoundGroupWorkItem::GOSoundGroupWorkItem(GOSoundEngine& sound_engine, unsigned samples_per_buffer) :
 	GOSoundBufferItem(samples_per_buffer, 2),
 	m_engine(sound_engine),
-	m_Condition(m_Mutex),
-	m_ActiveCount(0),
-	m_Done(0),
+	m_State(0),
+	m_MergeMutex(),
+	m_DoneMutex(),
+	m_DoneCondition(m_DoneMutex),
 	m_Stop(false)
 {
 }
 
 void GOSoundGroupWorkItem::Reset()
 {
-	GOMutexLocker locker(m_Mutex);
-	m_Done = 0;
-	m_ActiveCount = 0;
+	m_State = 0;
 	m_Stop = false;
 }
 
@@ -44,28 +51,38 @@ void GOSoundGroupWorkItem::Add(GO_SAMPLER* sampler)
 
 void GOSoundGroupWorkItem::ProcessList(GOSoundSamplerList& list, float* output_buffer)
 {
-	for (GO_SAMPLER* sampler = list.Get(); sampler; sampler = list.Get())
+	GO_SAMPLER* samplers[SAMPLER_CHUNK_SIZE];
+	for (unsigned n = list.GetChunk(samplers, SAMPLER_CHUNK_SIZE); n; n = list.GetChunk(samplers, SAMPLER_CHUNK_SIZE))
 	{
-		if (m_engine.ProcessSampler(output_buffer, sampler, m_SamplesPerBuffer, sampler->windchest->GetVolume()))
-			Add(sampler);
+		n = m_engine.ProcessSamplers(output_buffer, samplers, n, m_SamplesPerBuffer);
+		for (unsigned i = 0; i < n; i++)
+			Add(samplers[i]);
 	}
 }
 
 void GOSoundGroupWorkItem::ProcessReleaseList(GOSoundSamplerList& list, float* output_buffer)
 {
-	for (GO_SAMPLER* sampler = list.Get(); sampler; sampler = list.Get())
+	GO_SAMPLER* samplers[SAMPLER_CHUNK_SIZE];
+	for (unsigned n = list.GetChunk(samplers, SAMPLER_CHUNK_SIZE); n; n = list.GetChunk(samplers, SAMPLER_CHUNK_SIZE))
 	{
-		if (m_Stop && sampler->time + 2000 < m_engine.GetTime())
+		unsigned count = 0;
+		for (unsigned i = 0; i < n; i++)
 		{
-			if (sampler->drop_counter++ > 3)
+			GO_SAMPLER* sampler = samplers[i];
+			if (m_Stop && sampler->time + 2000 < m_engine.GetTime())
 			{
-				m_engine.ReturnSampler(sampler);
-				continue;
+				if (sampler->drop_counter++ > 3)
+				{
+					m_engine.ReturnSampler(sampler);
+					continue;
+				}
 			}
+			sampler->drop_counter = 0;
+			samplers[count++] = sampler;
 		}
-		sampler->drop_counter = 0;
-		if (m_engine.ProcessSampler(output_buffer, sampler, m_SamplesPerBuffer, sampler->windchest->GetVolume()))
-			Add(sampler);
+		count = m_engine.ProcessSamplers(output_buffer, samplers, count, m_SamplesPerBuffer);
+		for (unsigned i = 0; i < count; i++)
+			Add(samplers[i]);
 	}
 }
 
@@ -86,54 +103,73 @@ bool GOSoundGroupWorkItem::GetRepeat()
 
 void GOSoundGroupWorkItem::Run(GOSoundThread *pThread)
 {
-	if (m_Done == 3)
-		return;
+	/* Join the item. The first thread clears the buffer and moves the
+	 * pending samplers into the active lists, later threads only join after
+	 * that and while there is still something left to process. A thread
+	 * which gives up waiting for the first one leaves the work to it. */
+	unsigned state = m_State;
+	unsigned spin = 0;
+	do
 	{
-		GOMutexLocker locker(m_Mutex, false, "GOSoundGroupWorkItem::Run.beforeProcess", pThread);
-		
-		if (! locker.IsLocked())
-		  return;
-		
-		if (m_Done == 0)
+		if (state & STATE_DONE)
+			return;
+		if (state & STATE_INIT)
 		{
-			m_Active.Move();
-			m_Release.Move();
-			m_Done = 1;
-		}
-		else
-		{ 
-			if (!m_Active.Peek() && !m_Release.Peek())
+			if (spin++ >= GROUP_INIT_SPIN)
 				return;
+			std::this_thread::yield();
+			state = m_State;
+			continue;
 		}
-		m_ActiveCount++;
+		if ((state & STATE_STARTED) && !m_Active.Peek() && !m_Release.Peek())
+			return;
+		if (m_State.compare_exchange(state, ((state & STATE_STARTED) ? state : state | STATE_INIT) + 1))
+			break;
 	}
+	while(true);
+
+	if (!(state & STATE_STARTED))
+	{
+		memset(m_Buffer, 0, m_SamplesPerBuffer * 2 * sizeof(float));
+		m_Active.Move();
+		m_Release.Move();
+		state = m_State;
+		while(!m_State.compare_exchange(state, (state & ~STATE_INIT) | STATE_STARTED));
+	}
+
 	float buffer[m_SamplesPerBuffer * 2];
 	memset(buffer, 0, m_SamplesPerBuffer * 2 * sizeof(float));
 	ProcessList(m_Active, buffer);
 	ProcessReleaseList(m_Release, buffer);
+
+	/* Only the merge of the partial mixes is exclusive. It is short, so
+	 * retry a few times before sleeping on the mutex. */
+	bool locked = false;
+	for(unsigned i = 0; !locked && i < GROUP_MERGE_SPIN; i++)
+		locked = m_MergeMutex.TryLock("GOSoundGroupWorkItem::Run");
+	if (!locked)
+		m_MergeMutex.Lock("GOSoundGroupWorkItem::Run");
+	for(unsigned i = 0; i < m_SamplesPerBuffer * 2; i++)
+		m_Buffer[i] += buffer[i];
+	m_MergeMutex.Unlock();
+
+	state = m_State;
+	do
 	{
-		GOMutexLocker locker(m_Mutex, false, "GOSoundGroupWorkItem::Run.afterProcess", pThread);
-		
-		if (! locker.IsLocked())
-		  return;
-		
-		if (m_Done == 1)
-		{
-			memcpy(m_Buffer, buffer, m_SamplesPerBuffer * 2 * sizeof(float));
-			m_Done = 2;
-		}
-		else
-		{
-			for(unsigned i = 0; i < m_SamplesPerBuffer * 2; i++)
-				m_Buffer[i] += buffer[i];
-		}
-		m_ActiveCount--;
-		if (!m_ActiveCount)
+		unsigned next = state - 1;
+		if (!(next & STATE_COUNT))
+			next |= STATE_DONE;
+		if (m_State.compare_exchange(state, next))
 		{
-			m_Done = 3;
-			m_Condition.Broadcast();
+			if (next & STATE_DONE)
+			{
+				GOMutexLocker lock(m_DoneMutex);
+				m_DoneCondition.Broadcast();
+			}
+			break;
 		}
 	}
+	while(true);
 }
 
 void GOSoundGroupWorkItem::Exec()
@@ -147,13 +183,24 @@ void GOSoundGroupWorkItem::Finish(bool stop, GOSoundThread *pThread)
 	if (stop)
 		m_Stop = true;
 	Run(pThread);
-	if (m_Done == 3)
-		return;
 
+	/* The lists are drained, wait for the threads still mixing their
+	 * last samplers */
+	for(unsigned i = 0; !(m_State & STATE_DONE) && i < GROUP_FINISH_SPIN; i++)
 	{
-		GOMutexLocker locker(m_Mutex, false, "GOSoundGroupWorkItem::Finish", pThread);
+		if (pThread && pThread->ShouldStop())
+			return;
+		std::this_thread::yield();
+	}
+	if (m_State & STATE_DONE)
+		return;
 
-		if (locker .IsLocked() && m_Done != 3)
-			m_Condition.WaitOrStop("GOSoundGroupWorkItem::Finish", pThread);
+	GOMutexLocker lock(m_DoneMutex, false, "GOSoundGroupWorkItem::Finish", pThread);
+	while(lock.IsLocked() && !(m_State & STATE_DONE))
+	{
+		if (pThread && pThread->ShouldStop())
+			return;
+		if (!m_DoneCondition.WaitOrStop("GOSoundGroupWorkItem::Finish", pThread))
+			return;
 	}
 }
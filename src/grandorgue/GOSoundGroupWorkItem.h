@@ -10,6 +10,7 @@
 #include "GOSoundBufferItem.h"
 #include "GOSoundSamplerList.h"
 #include "GOSoundWorkItem.h"
+#include "threading/atomic.h"
 #include "threading/GOCondition.h"
 #include "threading/GOMutex.h"
 #include "GOSoundThread.h"
@@ -22,12 +23,22 @@ private:
 	GOSoundEngine& m_engine;
 	GOSoundSamplerList m_Active;
 	GOSoundSamplerList m_Release;
-	GOMutex m_Mutex;
-	GOCondition m_Condition;
-	unsigned m_ActiveCount;
-	unsigned m_Done;
+	/* Bit field of STATE_* flags and the number of threads working on
+	 * the lists, updated with compare_exchange only */
+	atomic_uint m_State;
+	GOMutex m_MergeMutex;
+	/* Signalled when STATE_DONE is set */
+	GOMutex m_DoneMutex;
+	GOCondition m_DoneCondition;
 	volatile bool m_Stop;
 
+	enum {
+		STATE_INIT = 0x20000000,
+		STATE_STARTED = 0x40000000,
+		STATE_DONE = 0x80000000,
+		STATE_COUNT = 0x1FFFFFFF,
+	};
+
 	void ProcessList(GOSoundSamplerList& list, float* output_buffer);
 	void ProcessReleaseList(GOSoundSamplerList& list, float* output_buffer);
 
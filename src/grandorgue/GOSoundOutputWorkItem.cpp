@@ -137,6 +137,11 @@ void GOSoundOutputWorkItem::SetupReverb(GOrgueSettings& settings)
 	m_Reverb->Setup(settings);
 }
 
+GOSoundReverb* GOSoundOutputWorkItem::GetReverb()
+{
+	return m_Reverb;
+}
+
 const std::vector<float>& GOSoundOutputWorkItem::GetMeterInfo()
 {
 	return m_MeterInfo;
@@ -44,6 +44,7 @@ public:
 	void Reset();
 
 	void SetupReverb(GOrgueSettings& settings);
+	GOSoundReverb* GetReverb();
 
 	const std::vector<float>& GetMeterInfo();
 	void ResetMeterInfo();
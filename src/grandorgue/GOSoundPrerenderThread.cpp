@@ -0,0 +1,55 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundPrerenderThread.h"
+
+#include "GOrgueSound.h"
+
+GOSoundPrerenderThread::GOSoundPrerenderThread(GOrgueSound& sound) :
+	GOrgueThread(),
+	m_Sound(sound),
+	m_Wait(),
+	m_Sleeping(0)
+{
+}
+
+void GOSoundPrerenderThread::Entry()
+{
+	while(!ShouldStop())
+	{
+		if (m_Sound.RenderPeriod())
+			continue;
+		/* Announce the sleep before looking again, so a period consumed in
+		 * between always sets the event */
+		m_Sleeping = 1;
+		if (m_Sound.RenderPeriod())
+		{
+			m_Sleeping = 0;
+			continue;
+		}
+		m_Wait.Wait();
+		m_Sleeping = 0;
+	}
+}
+
+void GOSoundPrerenderThread::Run()
+{
+	Start();
+}
+
+void GOSoundPrerenderThread::Delete()
+{
+	MarkForStop();
+	m_Wait.Set();
+	Wait();
+}
+
+/* Called from the audio callbacks */
+void GOSoundPrerenderThread::Wakeup()
+{
+	if (m_Sleeping.exchange(0))
+		m_Wait.Set();
+}
@@ -0,0 +1,36 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDPRERENDERTHREAD_H
+#define GOSOUNDPRERENDERTHREAD_H
+
+#include "threading/atomic.h"
+#include "threading/GOWakeEvent.h"
+#include "threading/GOrgueThread.h"
+
+class GOrgueSound;
+
+/* Renders the periods ahead of the audio callbacks. The callbacks only
+ * consume finished periods and wake this thread through a lock free
+ * GOWakeEvent, if it announced to sleep. */
+class GOSoundPrerenderThread : public GOrgueThread
+{
+private:
+	GOrgueSound& m_Sound;
+	GOWakeEvent m_Wait;
+	atomic_uint m_Sleeping;
+
+	void Entry();
+
+public:
+	GOSoundPrerenderThread(GOrgueSound& sound);
+
+	void Run();
+	void Delete();
+	void Wakeup();
+};
+
+#endif
@@ -111,7 +111,7 @@ void GOSoundProviderSynthedTrem::Create
 	attack_info.max_released_time = -1;
 	m_AttackInfo.push_back(attack_info);
 	m_Attack.push_back(new GOAudioSection(m_pool));
-	m_Attack[0]->Setup(data.get(), GOrgueWave::SF_SIGNEDSHORT_16, 1, sample_freq, trem_loop.end_sample, &trem_loops, false, 0);
+	m_Attack[0]->Setup(data.get(), GOrgueWave::SF_SIGNEDSHORT_16, 1, sample_freq, trem_loop.end_sample, &trem_loops, GO_COMPRESSION_NONE, 0);
 
 	/* Release section */
 	release_section_info release_info;
@@ -119,7 +119,7 @@ void GOSoundProviderSynthedTrem::Create
 	release_info.max_playback_time = -1;
 	m_ReleaseInfo.push_back(release_info);
 	m_Release.push_back(new GOAudioSection(m_pool));
-	m_Release[0]->Setup(data.get() + attack_samples + loop_samples, GOrgueWave::SF_SIGNEDSHORT_16, 1, sample_freq, release_samples, NULL, false, 0);
+	m_Release[0]->Setup(data.get() + attack_samples + loop_samples, GOrgueWave::SF_SIGNEDSHORT_16, 1, sample_freq, release_samples, NULL, GO_COMPRESSION_NONE, 0);
 
 	ComputeReleaseAlignmentInfo();
 
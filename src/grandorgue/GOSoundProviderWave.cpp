@@ -37,20 +37,19 @@ unsigned GOSoundProviderWave::GetBytesPerSample(unsigned bits_per_sample)
 		return 3;
 }
 
-void GOSoundProviderWave::CreateAttack(const char* data, GOrgueWave& wave, int attack_start, std::vector<GO_WAVE_LOOP> loop_list, int sample_group, unsigned bits_per_sample, unsigned channels, 
-				       bool compress, loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, unsigned loop_crossfade_length, unsigned max_released_time)
+void GOSoundProviderWave::CreateAttack(const decoded_file_info& file, int attack_start, std::vector<GO_WAVE_LOOP> loop_list, int sample_group, compression_type compress,
+				       loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, unsigned loop_crossfade_length, unsigned max_released_time)
 {
 	std::vector<GO_WAVE_LOOP> loops;
 	unsigned attack_pos = attack_start;
 	if (loop_list.size() == 0)
-		for(unsigned i = 0; i < wave.GetNbLoops(); i++)
-			loop_list.push_back(wave.GetLoop(i));
+		loop_list = file.loops;
 
 	for(unsigned i = 0; i < loop_list.size(); i++)
 	{
-		if (loop_list[i].start_sample >= wave.GetLength() ||
+		if (loop_list[i].start_sample >= file.length ||
 		    loop_list[i].start_sample >= loop_list[i].end_sample ||
-		    loop_list[i].end_sample >= wave.GetLength())
+		    loop_list[i].end_sample >= file.length)
 			throw (wxString)_("Invalid loop defintion");
 		if(loop_crossfade_length && loop_list[i].start_sample + REMAINING_AFTER_CROSSFADE + loop_crossfade_length >= loop_list[i].end_sample)
 			throw (wxString)_("Loop too short for a cross fade");
@@ -107,19 +106,19 @@ void GOSoundProviderWave::CreateAttack(const char* data, GOrgueWave& wave, int a
 	m_AttackInfo.push_back(attack_info);
 	GOAudioSection* section = new GOAudioSection(m_pool);
 	m_Attack.push_back(section);
-	section->Setup(data + attack_pos * GetBytesPerSample(bits_per_sample) * channels, (GOrgueWave::SAMPLE_FORMAT)bits_per_sample, 
-		       channels, wave.GetSampleRate(), wave.GetLength(), &loops, compress, loop_crossfade_length);
+	section->Setup(file.data.get() + attack_pos * GetBytesPerSample(file.bits_per_sample) * file.channels, (GOrgueWave::SAMPLE_FORMAT)file.bits_per_sample, 
+		       file.channels, file.sample_rate, file.length, &loops, compress, loop_crossfade_length);
 }
 
-void GOSoundProviderWave::CreateRelease(const char* data, GOrgueWave& wave, int sample_group, unsigned max_playback_time, int cue_point, int release_end, unsigned bits_per_sample, unsigned channels, bool compress)
+void GOSoundProviderWave::CreateRelease(const decoded_file_info& file, int sample_group, unsigned max_playback_time, int cue_point, int release_end, compression_type compress)
 {
-	unsigned release_offset = wave.HasReleaseMarker() ? wave.GetReleaseMarkerPosition() : 0;
+	unsigned release_offset = file.has_release_marker ? file.release_marker_position : 0;
 	if (cue_point != -1)
 		release_offset = cue_point;
-	unsigned release_end_marker = wave.GetLength();
+	unsigned release_end_marker = file.length;
 	if (release_end != -1)
 		release_end_marker = release_end;
-	if (release_end_marker > wave.GetLength())
+	if (release_end_marker > file.length)
 		throw (wxString)_("Invalid release end position");
 
 	unsigned release_samples = release_end_marker - release_offset;
@@ -133,7 +132,8 @@ void GOSoundProviderWave::CreateRelease(const char* data, GOrgueWave& wave, int
 	m_ReleaseInfo.push_back(release_info);
 	GOAudioSection* section = new GOAudioSection(m_pool);
 	m_Release.push_back(section);
-	section->Setup(data + release_offset * GetBytesPerSample(bits_per_sample) * channels, (GOrgueWave::SAMPLE_FORMAT)bits_per_sample, channels, wave.GetSampleRate(), release_samples, NULL, compress, 0);
+	section->Setup(file.data.get() + release_offset * GetBytesPerSample(file.bits_per_sample) * file.channels, (GOrgueWave::SAMPLE_FORMAT)file.bits_per_sample, file.channels,
+		       file.sample_rate, release_samples, NULL, compress, 0);
 }
 
 void GOSoundProviderWave::LoadPitch(const GOrgueFilename& filename)
@@ -148,25 +148,39 @@ void GOSoundProviderWave::LoadPitch(const GOrgueFilename& filename)
 }
 
 
-void GOSoundProviderWave::ProcessFile(const GOrgueFilename& filename, std::vector<GO_WAVE_LOOP> loops, bool is_attack, bool is_release, int sample_group, 
-				      unsigned max_playback_time, int attack_start, int cue_point, int release_end, unsigned bits_per_sample, int load_channels, bool compress, loop_load_type loop_mode, 
-				      bool percussive, unsigned min_attack_velocity, bool use_pitch, unsigned loop_crossfade_length, unsigned max_released_time)
+/* Counts the uses of each file before anything is decoded */
+void GOSoundProviderWave::AddFileUse(ptr_vector<decoded_file_info>& files, const GOrgueFilename& filename)
+{
+	for(unsigned i = 0; i < files.size(); i++)
+		if (files[i]->filename == filename)
+		{
+			files[i]->uses++;
+			return;
+		}
+
+	decoded_file_info* file = new decoded_file_info;
+	files.push_back(file);
+	file->filename = filename;
+	file->uses = 1;
+}
+
+/* Each file is read, unpacked and converted only once per load. The raw
+ * wave is dropped right after the conversion. */
+decoded_file_info& GOSoundProviderWave::DecodeFile(ptr_vector<decoded_file_info>& files, const GOrgueFilename& filename, unsigned bits_per_sample, int load_channels)
 {
+	decoded_file_info* file = NULL;
+	for(unsigned i = 0; i < files.size(); i++)
+		if (files[i]->filename == filename)
+			file = files[i];
+	assert(file && file->uses);
+	if (file->data.GetSize())
+		return *file;
+
 	wxLogDebug(_("Loading file %s"), filename.GetTitle().c_str());
 
 	GOrgueWave wave;
 	wave.Open(filename.Open().get());
 
-	/* allocate data to work with */
-	unsigned totalDataSize = wave.GetLength() * GetBytesPerSample(bits_per_sample) * wave.GetChannels();
-	GOrgueBuffer<char> data(totalDataSize);
-
-	if (use_pitch)
-	{
-		m_MidiKeyNumber = wave.GetMidiNote();
-		m_MidiPitchFract = wave.GetPitchFract();
-	}
-
 	unsigned channels = wave.GetChannels();
 	if (load_channels == 1)
 		channels = 1;
@@ -179,13 +193,45 @@ void GOSoundProviderWave::ProcessFile(const GOrgueFilename& filename, std::vecto
 	if (bits_per_sample > wave.GetBitsPerSample())
 		bits_per_sample = wave.GetBitsPerSample();
 
-	wave.ReadSamples(data.get(), (GOrgueWave::SAMPLE_FORMAT)bits_per_sample, wave.GetSampleRate(), wave_channels);
+	/* allocate data to work with */
+	file->data.resize(wave.GetLength() * GetBytesPerSample(bits_per_sample) * wave.GetChannels());
+	wave.ReadSamples(file->data.get(), (GOrgueWave::SAMPLE_FORMAT)bits_per_sample, wave.GetSampleRate(), wave_channels);
+	file->bits_per_sample = bits_per_sample;
+	file->channels = channels;
+	file->length = wave.GetLength();
+	file->sample_rate = wave.GetSampleRate();
+	file->midi_note = wave.GetMidiNote();
+	file->pitch_fract = wave.GetPitchFract();
+	file->has_release_marker = wave.HasReleaseMarker();
+	file->release_marker_position = file->has_release_marker ? wave.GetReleaseMarkerPosition() : 0;
+	file->loops.clear();
+	for(unsigned i = 0; i < wave.GetNbLoops(); i++)
+		file->loops.push_back(wave.GetLoop(i));
+	return *file;
+}
+
+/* Frees the samples after the last use of the file */
+void GOSoundProviderWave::ReleaseFile(decoded_file_info& file)
+{
+	if (!--file.uses)
+		file.data.free();
+}
+
+void GOSoundProviderWave::ProcessFile(const decoded_file_info& file, std::vector<GO_WAVE_LOOP> loops, bool is_attack, bool is_release, int sample_group, 
+				      unsigned max_playback_time, int attack_start, int cue_point, int release_end, compression_type compress, loop_load_type loop_mode, 
+				      bool percussive, unsigned min_attack_velocity, bool use_pitch, unsigned loop_crossfade_length, unsigned max_released_time)
+{
+	if (use_pitch)
+	{
+		m_MidiKeyNumber = file.midi_note;
+		m_MidiPitchFract = file.pitch_fract;
+	}
 
 	if (is_attack)
-		CreateAttack(data.get(), wave, attack_start, loops, sample_group, bits_per_sample, channels, compress, loop_mode, percussive, min_attack_velocity, loop_crossfade_length, max_released_time);
+		CreateAttack(file, attack_start, loops, sample_group, compress, loop_mode, percussive, min_attack_velocity, loop_crossfade_length, max_released_time);
 
-	if (is_release && (!is_attack || (wave.GetNbLoops() > 0 && wave.HasReleaseMarker() && !percussive)))
-		CreateRelease(data.get(), wave, sample_group, max_playback_time, cue_point, release_end, bits_per_sample, channels, compress);
+	if (is_release && (!is_attack || (file.loops.size() > 0 && file.has_release_marker && !percussive)))
+		CreateRelease(file, sample_group, max_playback_time, cue_point, release_end, compress);
 }
 
 unsigned GOSoundProviderWave::GetFaderLength(unsigned MidiKeyNumber)
@@ -202,7 +248,7 @@ unsigned GOSoundProviderWave::GetFaderLength(unsigned MidiKeyNumber)
 	return fade_length;
 }
 
-void GOSoundProviderWave::LoadFromFile(std::vector<attack_load_info> attacks, std::vector<release_load_info> releases, unsigned bits_per_sample, int load_channels, bool compress, 
+void GOSoundProviderWave::LoadFromFile(std::vector<attack_load_info> attacks, std::vector<release_load_info> releases, unsigned bits_per_sample, int load_channels, compression_type compress, 
 				       loop_load_type loop_mode, unsigned attack_load, unsigned release_load, int midi_key_number, unsigned loop_crossfade_length, unsigned release_crossfase_length)
 {
 
@@ -299,6 +345,12 @@ void GOSoundProviderWave::LoadFromFile(std::vector<attack_load_info> attacks, st
 
 	try
 	{
+		ptr_vector<decoded_file_info> files;
+		for(unsigned i = 0; i < attacks.size(); i++)
+			AddFileUse(files, attacks[i].filename);
+		for(unsigned i = 0; i < releases.size(); i++)
+			AddFileUse(files, releases[i].filename);
+
 		for(unsigned i = 0; i < attacks.size(); i++)
 		{
 			std::vector<GO_WAVE_LOOP> loops;
@@ -309,17 +361,21 @@ void GOSoundProviderWave::LoadFromFile(std::vector<attack_load_info> attacks, st
 				loop.end_sample = attacks[i].loops[j].loop_end;
 				loops.push_back(loop);
 			}
-			ProcessFile(attacks[i].filename, loops, true, attacks[i].load_release, attacks[i].sample_group, attacks[i].max_playback_time, attacks[i].attack_start, attacks[i].cue_point,
-				    attacks[i].release_end, bits_per_sample, load_channels, compress, loop_mode, attacks[i].percussive, attacks[i].min_attack_velocity, load_first_attack, loop_crossfade_length,
+			decoded_file_info& file = DecodeFile(files, attacks[i].filename, bits_per_sample, load_channels);
+			ProcessFile(file, loops, true, attacks[i].load_release, attacks[i].sample_group, attacks[i].max_playback_time, attacks[i].attack_start, attacks[i].cue_point,
+				    attacks[i].release_end, compress, loop_mode, attacks[i].percussive, attacks[i].min_attack_velocity, load_first_attack, loop_crossfade_length,
 				    attacks[i].max_released_time);
+			ReleaseFile(file);
 			load_first_attack = false;
 		}
 
 		for(unsigned i = 0; i < releases.size(); i++)
 		{
 			std::vector<GO_WAVE_LOOP> loops;
-			ProcessFile(releases[i].filename, loops, false, true, releases[i].sample_group, releases[i].max_playback_time, 0, releases[i].cue_point, releases[i].release_end, 
-				    bits_per_sample, load_channels, compress, loop_mode, true, 0, false, loop_crossfade_length, 0);
+			decoded_file_info& file = DecodeFile(files, releases[i].filename, bits_per_sample, load_channels);
+			ProcessFile(file, loops, false, true, releases[i].sample_group, releases[i].max_playback_time, 0, releases[i].cue_point, releases[i].release_end, 
+				    compress, loop_mode, true, 0, false, loop_crossfade_length, 0);
+			ReleaseFile(file);
 		}
 
 		ComputeReleaseAlignmentInfo();
@@ -7,14 +7,15 @@
 #ifndef GOSOUNDPROVIDERWAVE_H_
 #define GOSOUNDPROVIDERWAVE_H_
 
+#include "GOSoundCompress.h"
 #include "GOSoundProvider.h"
+#include "GOrgueBuffer.h"
 #include "GOrgueFilename.h"
+#include "GOrgueWave.h"
+#include "ptrvector.h"
 #include <wx/string.h>
 #include <vector>
 
-class GOrgueWave;
-typedef struct GO_WAVE_LOOP GO_WAVE_LOOP;
-
 typedef enum
 {
 	/* Only the first loop with the earliest endpoint is loaded. This will
@@ -63,15 +64,38 @@ typedef struct
 	int release_end;
 } release_load_info;
 
+/* A sample file, which has been read and converted during one load. The
+ * same file may be used by several attacks and releases of a pipe, the
+ * samples are freed after the last of them. Only the properties of the
+ * wave which are needed later are kept. */
+typedef struct
+{
+	GOrgueFilename filename;
+	unsigned uses;
+	GOrgueBuffer<char> data;
+	unsigned bits_per_sample;
+	unsigned channels;
+	unsigned length;
+	unsigned sample_rate;
+	unsigned midi_note;
+	float pitch_fract;
+	bool has_release_marker;
+	unsigned release_marker_position;
+	std::vector<GO_WAVE_LOOP> loops;
+} decoded_file_info;
+
 class GOSoundProviderWave : public GOSoundProvider
 {
 	unsigned GetBytesPerSample(unsigned bits_per_sample);
        
-	void CreateAttack(const char* data, GOrgueWave& wave, int attack_start, std::vector<GO_WAVE_LOOP> loop_list, int sample_group, unsigned bits_per_sample, 
-			  unsigned channels, bool compress, loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, unsigned loop_crossfade_length, unsigned max_released_time);
-	void CreateRelease(const char* data, GOrgueWave& wave, int sample_group, unsigned max_playback_time, int cue_point, int release_end, unsigned bits_per_sample, unsigned channels, bool compress);
-	void ProcessFile(const GOrgueFilename& filename, std::vector<GO_WAVE_LOOP> loops, bool is_attack, bool is_release, int sample_group, unsigned max_playback_time, 
-			 int attack_start, int cue_point, int release_end, unsigned bits_per_sample, int load_channels, bool compress, loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, 
+	void CreateAttack(const decoded_file_info& file, int attack_start, std::vector<GO_WAVE_LOOP> loop_list, int sample_group, compression_type compress,
+			  loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, unsigned loop_crossfade_length, unsigned max_released_time);
+	void CreateRelease(const decoded_file_info& file, int sample_group, unsigned max_playback_time, int cue_point, int release_end, compression_type compress);
+	void AddFileUse(ptr_vector<decoded_file_info>& files, const GOrgueFilename& filename);
+	decoded_file_info& DecodeFile(ptr_vector<decoded_file_info>& files, const GOrgueFilename& filename, unsigned bits_per_sample, int load_channels);
+	void ReleaseFile(decoded_file_info& file);
+	void ProcessFile(const decoded_file_info& file, std::vector<GO_WAVE_LOOP> loops, bool is_attack, bool is_release, int sample_group, unsigned max_playback_time, 
+			 int attack_start, int cue_point, int release_end, compression_type compress, loop_load_type loop_mode, bool percussive, unsigned min_attack_velocity, 
 			 bool use_pitch, unsigned loop_crossfade_length, unsigned max_released_time);
 	void LoadPitch(const GOrgueFilename& filename);
 	unsigned GetFaderLength(unsigned MidiKeyNumber);
@@ -79,7 +103,7 @@ class GOSoundProviderWave : public GOSoundProvider
 public:
 	GOSoundProviderWave(GOrgueMemoryPool& pool);
 
-	void LoadFromFile(std::vector<attack_load_info> attacks, std::vector<release_load_info> releases, unsigned bits_per_sample, int channels, bool compress, loop_load_type loop_mode,
+	void LoadFromFile(std::vector<attack_load_info> attacks, std::vector<release_load_info> releases, unsigned bits_per_sample, int channels, compression_type compress, loop_load_type loop_mode,
 			  unsigned attack_load, unsigned release_load, int midi_key_number, unsigned loop_crossfade_length, unsigned release_crossfase_length);
 	void SetAmplitude(float fixed_amplitude, float gain);
 };
@@ -7,6 +7,7 @@
 #include "GOSoundReverb.h"
 
 #include "GOSoundResample.h"
+#include "GOSoundReverbWorkItem.h"
 #include "GOrgueStandardFile.h"
 #include "GOrgueSettings.h"
 #include "GOrgueWave.h"
@@ -17,7 +18,8 @@
 
 GOSoundReverb::GOSoundReverb(unsigned channels) :
 	m_channels(channels),
-	m_engine()
+	m_engine(),
+	m_Partitions()
 {
 }
 
@@ -28,23 +30,23 @@ GOSoundReverb::~GOSoundReverb()
 
 void GOSoundReverb::Cleanup()
 {
-	for(unsigned i = 0; i < m_engine.size(); i++)
+	if (m_engine)
 	{
-		m_engine[i]->stop_process();
-		m_engine[i]->cleanup();
+		m_engine->stop_process();
+		m_engine->cleanup();
 	}
 }
 
 void GOSoundReverb::Setup(GOrgueSettings& settings)
 {
 	Cleanup();
+	m_engine.reset();
+	m_Partitions.clear();
 
 	if (!settings.ReverbEnabled())
 		return;
 
-	m_engine.clear();
-	for(unsigned i = 0; i < m_channels; i++)
-		m_engine.push_back(new Convproc());
+	m_engine.reset(new Convproc());
 	unsigned val = settings.SamplesPerBuffer();
 	if (val < Convproc::MINPART)
 		val = Convproc::MINPART;
@@ -54,9 +56,8 @@ void GOSoundReverb::Setup(GOrgueSettings& settings)
 	unsigned len = 0;
 	try
 	{
-		for(unsigned i = 0; i < m_engine.size(); i++)
-			if (m_engine[i]->configure(1, 1, 1000000, settings.SamplesPerBuffer(), val, Convproc::MAXPART))
-				throw (wxString)_("Invalid reverb configuration (samples per buffer)");
+		if (m_engine->configure(m_channels, m_channels, 1000000, settings.SamplesPerBuffer(), val, Convproc::MAXPART))
+			throw (wxString)_("Invalid reverb configuration (samples per buffer)");
 
 		GOrgueWave wav;
 		unsigned block = 0x4000;
@@ -86,26 +87,31 @@ void GOSoundReverb::Setup(GOrgueSettings& settings)
 			offset = (offset * settings.SampleRate()) / (float)wav.GetSampleRate();
 		}
 		unsigned delay = (settings.SampleRate() * settings.ReverbDelay()) / 1000;
-		for(unsigned i = 0; i < m_channels; i++)
+		float* d = data + offset;
+		unsigned l = len - offset;
+		float g = 1;
+		if  (settings.ReverbDirect())
+			m_engine->impdata_create(0, 0, 0, &g, 0, 1);
+		for(unsigned j = 0; j < l; j+= block)
 		{
-			float* d = data + offset;
-			unsigned l = len - offset;
-			float g = 1;
-			if  (settings.ReverbDirect())
-				m_engine[i]->impdata_create(0, 0, 0, &g, 0, 1);
-			for(unsigned j = 0; j < l; j+= block)
-			{
-				m_engine[i]->impdata_create(0, 0, 1, d + j, delay + j, delay + j + std::min(l - j, block));
-			}
+			m_engine->impdata_create(0, 0, 1, d + j, delay + j, delay + j + std::min(l - j, block));
 		}
+		/* The other channels use the transformed response of the first one */
+		for(unsigned i = 1; i < m_channels; i++)
+			m_engine->impdata_copy(0, 0, i, i);
 		wav.Close();
-		for(unsigned i = 0; i < m_engine.size(); i++)
-			m_engine[i]->start_process(0, 0);
+		for(unsigned i = m_engine->first_sched_level(); i < m_engine->levels(); i++)
+		{
+			m_Partitions.push_back(new GOSoundReverbWorkItem(*m_engine, i));
+			m_engine->set_sched(i, m_Partitions[m_Partitions.size() - 1]);
+		}
+		m_engine->start_process();
 	}
 	catch(wxString error)
 	{
 		wxLogError(_("Reverb load error: %s"), error.c_str());
-		m_engine.clear();
+		m_engine.reset();
+		m_Partitions.clear();
 	}
 	if (data)
 		free(data);
@@ -113,29 +119,24 @@ void GOSoundReverb::Setup(GOrgueSettings& settings)
 
 void GOSoundReverb::Reset()
 {
-	for(unsigned i = 0; i < m_engine.size(); i++)
-		m_engine[i]->reset();
+	if (m_engine)
+		m_engine->reset();
 }
 
 void GOSoundReverb::Process(float *output_buffer, unsigned n_frames)
 {
-	if (!m_engine.size())
+	if (!m_engine)
 		return;
 
-	for(unsigned i = 0; i < m_channels; i++)
-	{
-		float* ptr = m_engine[i]->inpdata(0);
-		for(unsigned j = 0; j < n_frames; j++)
-			ptr[j] = output_buffer[i + m_channels * j];
-	}
+	m_engine->process(output_buffer, m_channels);
+}
 
-	for(unsigned i = 0; i < m_engine.size(); i++)
-		m_engine[i]->process();
+unsigned GOSoundReverb::GetPartitionCount()
+{
+	return m_Partitions.size();
+}
 
-	for(unsigned i = 0; i < m_channels; i++)
-	{
-		float* ptr = m_engine[i]->outdata(0);
-		for(unsigned j = 0; j < n_frames; j++)
-			output_buffer[i + m_channels * j] = ptr[j];
-	}
+GOSoundWorkItem* GOSoundReverb::GetPartition(unsigned index)
+{
+	return m_Partitions[index];
 }
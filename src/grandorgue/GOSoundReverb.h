@@ -8,14 +8,22 @@
 #define GOSOUNDREVERB_H
 
 #include "ptrvector.h"
+#include <memory>
+
 class Convproc;
 class GOrgueSettings;
+class GOSoundReverbWorkItem;
+class GOSoundWorkItem;
 
+/* All channels share one convolver, so they share its partition levels and
+ * the transformed impulse response. The first level runs inline in Process,
+ * the later ones are work items of the sound scheduler. */
 class GOSoundReverb
 {
 private:
 	unsigned m_channels;
-	ptr_vector<Convproc> m_engine;
+	std::unique_ptr<Convproc> m_engine;
+	ptr_vector<GOSoundReverbWorkItem> m_Partitions;
 
 	void Cleanup();
 
@@ -27,6 +35,9 @@ public:
 	void Setup(GOrgueSettings& settings);
 
 	void Process(float *output_buffer, unsigned n_frames);
+
+	unsigned GetPartitionCount();
+	GOSoundWorkItem* GetPartition(unsigned index);
 };
 
 #endif
@@ -0,0 +1,69 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundReverbWorkItem.h"
+
+#include "GOSoundThread.h"
+#include "threading/GOMutexLocker.h"
+
+GOSoundReverbWorkItem::GOSoundReverbWorkItem(Convproc& engine, unsigned level) :
+	m_Engine(engine),
+	m_Level(level),
+	m_Mutex(),
+	m_Pending(0)
+{
+}
+
+unsigned GOSoundReverbWorkItem::GetGroup()
+{
+	return REVERB;
+}
+
+unsigned GOSoundReverbWorkItem::GetCost()
+{
+	/* Later levels have larger partitions */
+	return m_Level;
+}
+
+bool GOSoundReverbWorkItem::GetRepeat()
+{
+	return false;
+}
+
+void GOSoundReverbWorkItem::Run(GOSoundThread *thread)
+{
+	if (!m_Pending)
+		return;
+	GOMutexLocker locker(m_Mutex, false, "GOSoundReverbWorkItem::Run", thread);
+	if (!locker.IsLocked() || !m_Pending)
+		return;
+	m_Engine.process_level(m_Level);
+	m_Pending = 0;
+}
+
+/* A pending cycle is not forced at the end of the period, its output is
+ * only needed some periods later */
+void GOSoundReverbWorkItem::Exec()
+{
+}
+
+void GOSoundReverbWorkItem::Clear()
+{
+}
+
+void GOSoundReverbWorkItem::Reset()
+{
+}
+
+void GOSoundReverbWorkItem::trigger()
+{
+	m_Pending = 1;
+}
+
+void GOSoundReverbWorkItem::finish()
+{
+	Run();
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDREVERBWORKITEM_H
+#define GOSOUNDREVERBWORKITEM_H
+
+#include "GOSoundWorkItem.h"
+#include "contrib/zita-convolver.h"
+#include "threading/atomic.h"
+#include "threading/GOMutex.h"
+
+/* Runs the cycles of one partition level of a reverb convolver.
+ *
+ * The output work item triggers a cycle once the input of a partition is
+ * complete. It is then picked up by an idle sound thread in the current or
+ * one of the following periods. When the output of the cycle is needed, the
+ * output work item finishes it, so a cycle which has not been started yet is
+ * run inline. */
+class GOSoundReverbWorkItem : public GOSoundWorkItem, public Convsched
+{
+private:
+	Convproc& m_Engine;
+	unsigned m_Level;
+	GOMutex m_Mutex;
+	atomic_uint m_Pending;
+
+public:
+	GOSoundReverbWorkItem(Convproc& engine, unsigned level);
+
+	unsigned GetGroup();
+	unsigned GetCost();
+	bool GetRepeat();
+	void Run(GOSoundThread *thread = nullptr);
+	void Exec();
+
+	void Clear();
+	void Reset();
+
+	void trigger();
+	void finish();
+};
+
+#endif
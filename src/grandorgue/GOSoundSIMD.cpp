@@ -0,0 +1,65 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundSIMD.h"
+
+simd_type GOSoundSIMD::Detect()
+{
+#if defined(GO_SIMD_HAVE_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return GO_SIMD_AVX2;
+#endif
+#if defined(GO_SIMD_HAVE_SSE2)
+	return GO_SIMD_SSE2;
+#elif defined(GO_SIMD_HAVE_NEON)
+	return GO_SIMD_NEON;
+#else
+	return GO_SIMD_NONE;
+#endif
+}
+
+simd_type GOSoundSIMD::GetType()
+{
+	static const simd_type type = Detect();
+	return type;
+}
+
+bool GOSoundSIMD::IsSupported(simd_type type)
+{
+	switch (type)
+	{
+	case GO_SIMD_NONE:
+		return true;
+	case GO_SIMD_SSE2:
+#if defined(GO_SIMD_HAVE_SSE2)
+		return true;
+#else
+		return false;
+#endif
+	case GO_SIMD_AVX2:
+		return GetType() == GO_SIMD_AVX2;
+	case GO_SIMD_NEON:
+		return GetType() == GO_SIMD_NEON;
+	}
+	return false;
+}
+
+const char* GOSoundSIMD::GetName(simd_type type)
+{
+	switch (type)
+	{
+	case GO_SIMD_NONE:
+		return "scalar";
+	case GO_SIMD_SSE2:
+		return "SSE2";
+	case GO_SIMD_AVX2:
+		return "AVX2";
+	case GO_SIMD_NEON:
+		return "NEON";
+	}
+	return "unknown";
+}
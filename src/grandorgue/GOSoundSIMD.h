@@ -0,0 +1,54 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDSIMD_H_
+#define GOSOUNDSIMD_H_
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GO_SIMD_HAVE_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GO_SIMD_HAVE_AVX2
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GO_SIMD_HAVE_NEON
+#endif
+
+#if defined(__GNUC__)
+#define GO_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define GO_PREFETCH(addr) do {} while(0)
+#endif
+
+/* Maximum difference between the output of a vectorized decode kernel and
+ * the scalar reference, relative to the full scale of the sample format.
+ * Vector kernels sum the FIR taps in a different order, so results are not
+ * bit identical. */
+#define GO_SIMD_TOLERANCE      (1.0e-5f)
+
+typedef enum
+{
+	GO_SIMD_NONE = 0,
+	GO_SIMD_SSE2 = 1,
+	GO_SIMD_AVX2 = 2,
+	GO_SIMD_NEON = 3,
+} simd_type;
+
+class GOSoundSIMD
+{
+private:
+	static simd_type Detect();
+
+public:
+	/* Best instruction set supported by the running CPU */
+	static simd_type GetType();
+	static bool IsSupported(simd_type type);
+	static const char* GetName(simd_type type);
+};
+
+#endif /* GOSOUNDSIMD_H_ */
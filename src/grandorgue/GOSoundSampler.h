@@ -9,6 +9,7 @@
 
 #include "GOSoundAudioSection.h"
 #include "GOSoundFader.h"
+#include "threading/atomic.h"
 
 class GOSoundProvider;
 class GOSoundWindchestWorkItem;
@@ -31,6 +32,17 @@ public:
 	volatile unsigned long     new_attack;
 	bool                       is_release;
 	unsigned                   drop_counter;
+	/* start of a pending crossfade decay, 0 if none */
+	uint64_t                   decay_time;
+	/* the stream is aligned to the start of the period containing time */
+	bool                       align_start;
+	/* ticket in the heap of the releases, 0 if not in it. Holds the
+	 * fade instead once the sampler was stolen, see GOSoundSamplerHeap */
+	atomic_uint                heap_ticket;
+	/* releases only: higher values are louder at any given time */
+	float                      audibility;
+	/* incremented each time the sampler is taken from the pool */
+	unsigned                   generation;
 };
 
 #endif /* GOSOUNDSAMPLER_H_ */
@@ -0,0 +1,167 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundSamplerHeap.h"
+
+#include "GOSoundSampler.h"
+#include <algorithm>
+
+/* heap_ticket of a stolen sampler, the fade is stored in the lower bits */
+#define HEAP_STOLEN 0x80000000
+
+GOSoundSamplerHeap::GOSoundSamplerHeap() :
+	m_Capacity(0),
+	m_RequestedCapacity(0),
+	m_NextTicket(0),
+	m_Queue(),
+	m_QueueRead(0),
+	m_QueueWrite(0),
+	m_Sorted(),
+	m_New(),
+	m_Merged(),
+	m_Candidates(),
+	m_CandidateCount(0),
+	m_StealPos(0)
+{
+}
+
+void GOSoundSamplerHeap::Reserve(unsigned count)
+{
+	m_RequestedCapacity = count;
+}
+
+void GOSoundSamplerHeap::Clear()
+{
+	m_CandidateCount = 0;
+	m_StealPos = 0;
+	m_QueueRead = 0;
+	m_QueueWrite = 0;
+	m_Sorted.clear();
+	m_New.clear();
+	m_Merged.clear();
+	if (m_Capacity != m_RequestedCapacity)
+	{
+		m_Capacity = m_RequestedCapacity;
+		m_Queue = std::unique_ptr<GOSoundSamplerHeapSlot[]>(new GOSoundSamplerHeapSlot[m_Capacity]);
+		m_Candidates = std::unique_ptr<GOSoundSamplerHeapSlot[]>(new GOSoundSamplerHeapSlot[m_Capacity]);
+		/* m_Sorted and m_Merged are swapped */
+		m_Sorted.reserve(2 * m_Capacity);
+		m_New.reserve(m_Capacity);
+		m_Merged.reserve(2 * m_Capacity);
+	}
+	for(unsigned i = 0; i < m_Capacity; i++)
+	{
+		m_Queue[i].sampler = NULL;
+		m_Candidates[i].sampler = NULL;
+	}
+}
+
+bool GOSoundSamplerHeap::Compare(const GOSoundSamplerHeapEntry& a, const GOSoundSamplerHeapEntry& b)
+{
+	return a.audibility < b.audibility;
+}
+
+bool GOSoundSamplerHeap::IsLive(const GOSoundSamplerHeapEntry& entry)
+{
+	return entry.sampler->heap_ticket == entry.ticket;
+}
+
+/* A sampler, which does not fit into the queue, just can't be stolen */
+void GOSoundSamplerHeap::Add(GO_SAMPLER* sampler)
+{
+	if (sampler->heap_ticket)
+		return;
+
+	unsigned ticket;
+	do
+		ticket = m_NextTicket.fetch_add(1) & ~HEAP_STOLEN;
+	while (!ticket);
+	sampler->heap_ticket = ticket;
+
+	unsigned pos = m_QueueWrite;
+	do
+		if (pos - m_QueueRead >= m_Capacity)
+			return;
+	while (!m_QueueWrite.compare_exchange(pos, pos + 1));
+
+	/* The slot is free, as Update clears it before it advances m_QueueRead.
+	 * Storing the sampler last publishes the slot. */
+	GOSoundSamplerHeapSlot& slot = m_Queue[pos % m_Capacity];
+	slot.ticket = ticket;
+	slot.audibility = sampler->audibility;
+	slot.sampler = sampler;
+}
+
+bool GOSoundSamplerHeap::Remove(GO_SAMPLER* sampler)
+{
+	return (sampler->heap_ticket.exchange(0) & HEAP_STOLEN) != 0;
+}
+
+/* A candidate may be replaced by Update while it is read here. The compare
+ * and swap only succeeds with the current ticket of the sampler, which it
+ * only has while it may be stolen. */
+bool GOSoundSamplerHeap::Steal(unsigned fade)
+{
+	while (m_StealPos < m_CandidateCount)
+	{
+		unsigned pos = m_StealPos.fetch_add(1);
+		if (pos >= m_CandidateCount)
+			break;
+		GO_SAMPLER* sampler = m_Candidates[pos].sampler;
+		unsigned expected = m_Candidates[pos].ticket;
+		if (sampler && expected && sampler->heap_ticket.compare_exchange(expected, HEAP_STOLEN | fade))
+			return true;
+	}
+	return false;
+}
+
+void GOSoundSamplerHeap::Update()
+{
+	/* A producer, which has claimed a slot but not yet filled it, is picked
+	 * up in the next period */
+	unsigned read = m_QueueRead;
+	m_New.clear();
+	while (read != m_QueueWrite)
+	{
+		GOSoundSamplerHeapSlot& slot = m_Queue[read % m_Capacity];
+		GO_SAMPLER* sampler = slot.sampler;
+		if (!sampler)
+			break;
+		GOSoundSamplerHeapEntry entry = { sampler, slot.ticket, slot.audibility };
+		if (IsLive(entry))
+			m_New.push_back(entry);
+		slot.sampler = NULL;
+		read++;
+	}
+	m_QueueRead = read;
+
+	m_Sorted.erase(std::remove_if(m_Sorted.begin(), m_Sorted.end(), [](const GOSoundSamplerHeapEntry& e) { return !IsLive(e); }), m_Sorted.end());
+	if (m_New.size())
+	{
+		std::sort(m_New.begin(), m_New.end(), Compare);
+		m_Merged.clear();
+		std::merge(m_Sorted.begin(), m_Sorted.end(), m_New.begin(), m_New.end(), std::back_inserter(m_Merged), Compare);
+		/* Only the most audible ones are dropped, if it overflows */
+		if (m_Merged.size() > m_Capacity)
+			m_Merged.resize(m_Capacity);
+		m_Sorted.swap(m_Merged);
+	}
+
+	m_CandidateCount = 0;
+	for(unsigned i = 0; i < m_Sorted.size(); i++)
+	{
+		m_Candidates[i].sampler = m_Sorted[i].sampler;
+		m_Candidates[i].ticket = m_Sorted[i].ticket;
+	}
+	m_StealPos = 0;
+	m_CandidateCount = m_Sorted.size();
+}
+
+unsigned GOSoundSamplerHeap::GetStealFade(const GO_SAMPLER* sampler)
+{
+	unsigned ticket = sampler->heap_ticket;
+	return (ticket & HEAP_STOLEN) ? ticket & ~HEAP_STOLEN : 0;
+}
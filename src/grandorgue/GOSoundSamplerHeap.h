@@ -0,0 +1,88 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDSAMPLERHEAP_H
+#define GOSOUNDSAMPLERHEAP_H
+
+#include "threading/atomic.h"
+#include <memory>
+#include <vector>
+
+class GO_SAMPLER;
+
+/* The samplers which may be stolen, ordered by their audibility. No
+ * operation takes a lock.
+ *
+ * Every sampler gets a ticket when it is added, which it keeps while it
+ * may be stolen. A sampler which ends clears its ticket, Steal replaces it
+ * with the fade, so the sampler is either stolen or ended, never both.
+ *
+ * New samplers are passed through a bounded queue to Update, which runs
+ * once per period on the thread calling NextPeriod. It owns the sorted
+ * list, drops the samplers which have ended or been stolen, merges the new
+ * ones and publishes the result for Steal. A sampler added during a period
+ * can be stolen from the next one on. */
+class GOSoundSamplerHeap
+{
+private:
+	typedef struct
+	{
+		GO_SAMPLER* sampler;
+		unsigned ticket;
+		float audibility;
+	} GOSoundSamplerHeapEntry;
+
+	/* Shared between threads, the ticket tells whether it is still valid */
+	typedef struct
+	{
+		atomic<GO_SAMPLER*> sampler;
+		atomic_uint ticket;
+		float audibility;
+	} GOSoundSamplerHeapSlot;
+
+	unsigned m_Capacity;
+	unsigned m_RequestedCapacity;
+	atomic_uint m_NextTicket;
+
+	std::unique_ptr<GOSoundSamplerHeapSlot[]> m_Queue;
+	atomic_uint m_QueueRead;
+	atomic_uint m_QueueWrite;
+
+	/* Only used by Update */
+	std::vector<GOSoundSamplerHeapEntry> m_Sorted;
+	std::vector<GOSoundSamplerHeapEntry> m_New;
+	std::vector<GOSoundSamplerHeapEntry> m_Merged;
+
+	/* Published for Steal, least audible first */
+	std::unique_ptr<GOSoundSamplerHeapSlot[]> m_Candidates;
+	atomic_uint m_CandidateCount;
+	atomic_uint m_StealPos;
+
+	static bool Compare(const GOSoundSamplerHeapEntry& a, const GOSoundSamplerHeapEntry& b);
+	static bool IsLive(const GOSoundSamplerHeapEntry& entry);
+
+public:
+	GOSoundSamplerHeap();
+
+	/* Takes effect at the next Clear, as the buffers may be in use */
+	void Reserve(unsigned count);
+	/* Only called when no sampler is playing */
+	void Clear();
+	void Add(GO_SAMPLER* sampler);
+	/* Called when the sampler ends. Returns true if the sampler had been
+	 * stolen. */
+	bool Remove(GO_SAMPLER* sampler);
+	/* Marks the least audible sampler as stolen with the fade length.
+	 * Returns false if no sampler may be stolen. */
+	bool Steal(unsigned fade);
+	/* Called once per period by the thread which calls NextPeriod */
+	void Update();
+
+	/* Fade length in ms if the sampler was stolen, 0 otherwise */
+	static unsigned GetStealFade(const GO_SAMPLER* sampler);
+};
+
+#endif
@@ -49,6 +49,26 @@ public:
 		while(true);
 	}
 
+	/* Detaches up to count samplers with a single compare_exchange. Only
+	 * safe while nothing is pushed onto the get list, which holds while a
+	 * work item processes the list. */
+	unsigned GetChunk(GO_SAMPLER** samplers, unsigned count)
+	{
+		do
+		{
+			GO_SAMPLER* sampler = m_GetList;
+			unsigned n = 0;
+			for(; sampler && n < count; sampler = sampler->next)
+				samplers[n++] = sampler;
+			if (!n)
+				return 0;
+			GO_SAMPLER* first = samplers[0];
+			if (m_GetList.compare_exchange(first, sampler))
+				return n;
+		}
+		while(true);
+	}
+
 	void Put(GO_SAMPLER* sampler)
 	{
 		do
@@ -9,7 +9,6 @@
 #include "GOSoundSampler.h"
 #include "threading/GOMutexLocker.h"
 #include <assert.h>
-#include <string.h>
 
 GOSoundSamplerPool::GOSoundSamplerPool() :
 	m_SamplerCount(0),
@@ -26,8 +25,8 @@ void GOSoundSamplerPool::ReturnAll()
 
 	m_SamplerCount = 0;
 
-	if (m_Samplers.size() > m_UsageLimit)
-		m_Samplers.resize(m_UsageLimit);
+	if (m_Samplers.size() > m_UsageLimit + SAMPLER_STEAL_RESERVE)
+		m_Samplers.resize(m_UsageLimit + SAMPLER_STEAL_RESERVE);
 
 	m_AvailableSamplers.Clear();
 
@@ -40,27 +39,32 @@ void GOSoundSamplerPool::SetUsageLimit(unsigned count)
 	m_UsageLimit = count;
 
 	GOMutexLocker locker(m_Lock);
-	while(m_Samplers.size() < m_UsageLimit)
+	while(m_Samplers.size() < m_UsageLimit + SAMPLER_STEAL_RESERVE)
 	{
-		GO_SAMPLER* sampler = new GO_SAMPLER;
+		GO_SAMPLER* sampler = new GO_SAMPLER();
 		m_SamplerCount.fetch_add(1);
 		m_Samplers.push_back(sampler);
 		ReturnSampler(sampler);
 	}
 }
 
-GO_SAMPLER* GOSoundSamplerPool::GetSampler()
+GO_SAMPLER* GOSoundSamplerPool::GetSampler(bool reserve)
 {
 	GO_SAMPLER* sampler = NULL;
 
-	if (m_SamplerCount < m_UsageLimit)
+	if (m_SamplerCount < m_UsageLimit + (reserve ? SAMPLER_STEAL_RESERVE : 0))
 	{
 		sampler = m_AvailableSamplers.Get();
 		if (sampler)
 			m_SamplerCount.fetch_add(1);
 	}
+	/* Value initialised, so the atomic members are reset as well */
 	if (sampler)
-		memset(sampler, 0, sizeof(GO_SAMPLER));
+	{
+		unsigned generation = sampler->generation + 1;
+		*sampler = GO_SAMPLER();
+		sampler->generation = generation;
+	}
 	return sampler;
 }
 
@@ -14,6 +14,10 @@
 
 class GO_SAMPLER;
 
+/* Samplers beyond the usage limit, which are only handed out after a
+ * playing sampler has been stolen and until it has faded out */
+#define SAMPLER_STEAL_RESERVE 32
+
 class GOSoundSamplerPool
 {
 
@@ -26,7 +30,7 @@ private:
 
 public:
 	GOSoundSamplerPool();
-	GO_SAMPLER* GetSampler();
+	GO_SAMPLER* GetSampler(bool reserve = false);
 	void ReturnSampler(GO_SAMPLER* sampler);
 	void ReturnAll();
 	unsigned GetUsageLimit() const;
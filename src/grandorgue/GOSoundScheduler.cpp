@@ -8,11 +8,15 @@
 
 #include "GOSoundWorkItem.h"
 #include "threading/GOMutexLocker.h"
+#include <algorithm>
+#include <thread>
 
 GOSoundScheduler::GOSoundScheduler() :
 	m_Work(),
-	m_WorkItems(),
-	m_ItemCount(0),
+	m_State(new GOSoundSchedulerState()),
+	m_Readers(0),
+	m_QueueCount(1),
+	m_Period(0),
 	m_RepeatCount(0)
 {
 }
@@ -20,59 +24,82 @@ GOSoundScheduler::GOSoundScheduler() :
 GOSoundScheduler::~GOSoundScheduler()
 {
 	GOMutexLocker lock(m_Mutex);
-	Lock();
+	GOSoundSchedulerState* state = m_State.exchange(NULL);
+	while(m_Readers)
+		std::this_thread::yield();
+	delete state;
+}
+
+GOSoundScheduler::GOSoundSchedulerState* GOSoundScheduler::AcquireState()
+{
+	m_Readers.fetch_add(1);
+	return m_State;
+}
+
+void GOSoundScheduler::ReleaseState()
+{
+	m_Readers.fetch_add(-1);
 }
 
 void GOSoundScheduler::SetRepeatCount(unsigned count)
 {
-	m_RepeatCount = count;
 	GOMutexLocker lock(m_Mutex);
-	Lock();
+	m_RepeatCount = count;
 	Update();
-	Unlock();
 }
 
-void GOSoundScheduler::Clear()
+void GOSoundScheduler::SetThreadCount(unsigned count)
 {
+	if (count < 1)
+		count = 1;
+	if (count > MAX_CPU)
+		count = MAX_CPU;
 	GOMutexLocker lock(m_Mutex);
-	Lock();
-	m_Work.clear();
+	m_QueueCount = count;
 	Update();
-	Unlock();
 }
 
-void GOSoundScheduler::Lock()
+unsigned GOSoundScheduler::GetThreadCount()
 {
-	m_ItemCount = 0;
-	__sync_synchronize();
+	return m_QueueCount;
 }
 
-void GOSoundScheduler::Unlock()
+void GOSoundScheduler::Clear()
 {
-	m_ItemCount = m_WorkItems.size();
-	__sync_synchronize();
+	GOMutexLocker lock(m_Mutex);
+	m_Work.clear();
+	Update();
 }
 
+/* Builds a new snapshot and retires the old one once no reader uses it.
+ * A reader registers before it loads m_State, so after the exchange every
+ * registered reader either still holds the old snapshot or will see the new
+ * one. */
 void GOSoundScheduler::Update()
 {
-	m_WorkItems.clear();
-	SortList(m_Work);
-	for(unsigned i = 0; i < m_Work.size();)
+	GOSoundSchedulerState* state = new GOSoundSchedulerState();
+	for(unsigned i = 0; i < m_Work.size(); i++)
+		if (m_Work[i])
+			state->items.push_back(m_Work[i]);
+	SortList(state->items);
+
+	std::vector<GOSoundWorkItem*>& items = state->items;
+	for(unsigned i = 0; i < items.size();)
 	{
 		unsigned cnt = 1;
-		while(i + cnt < m_Work.size() && m_Work[i]->GetGroup() == m_Work[i + cnt]->GetGroup())
+		while(i + cnt < items.size() && items[i]->GetGroup() == items[i + cnt]->GetGroup())
 			cnt++;
-		unsigned rcnt = m_Work[i]->GetRepeat() ? m_RepeatCount : 1;
+		unsigned rcnt = items[i]->GetRepeat() ? std::max(m_RepeatCount, m_QueueCount) : 1;
 		for(unsigned j = 0; j < rcnt; j++)
 			for(unsigned k = 0; k < cnt; k++)
-				m_WorkItems.push_back(&m_Work[i + k]);
+				state->slots.push_back(&items[i + k]);
 		i += cnt;
 	}
-}
 
-void GOSoundScheduler::AddList(GOSoundWorkItem* item, std::vector<GOSoundWorkItem*>& list)
-{
-	list.push_back(item);
+	GOSoundSchedulerState* old = m_State.exchange(state);
+	while(m_Readers)
+		std::this_thread::yield();
+	delete old;
 }
 
 void GOSoundScheduler::Add(GOSoundWorkItem* item)
@@ -81,91 +108,90 @@ void GOSoundScheduler::Add(GOSoundWorkItem* item)
 		return;
 	item->Clear();
 	GOMutexLocker lock(m_Mutex);
-	Lock();
-	AddList(item, m_Work);
+	m_Work.push_back(item);
 	Update();
-	Unlock();
-}
-
-void GOSoundScheduler::RemoveList(GOSoundWorkItem* item, std::vector<GOSoundWorkItem*>& list)
-{
-	for(unsigned i = 0; i < list.size(); i++)
-		if (list[i] == item)
-			list[i] = nullptr;
 }
 
 void GOSoundScheduler::Remove(GOSoundWorkItem* item)
 {
 	GOMutexLocker lock(m_Mutex);
-	RemoveList(item, m_Work);
+	for(unsigned i = 0; i < m_Work.size(); i++)
+		if (m_Work[i] == item)
+			m_Work[i] = nullptr;
+	Update();
 }
 
+/* Earlier stages first, more expensive items first inside a stage */
 bool GOSoundScheduler::CompareItem(GOSoundWorkItem* a, GOSoundWorkItem* b)
 {
-	if (a && b)
-	{
- 		if (a->GetGroup() > b->GetGroup())
-			return true;
- 		if (a->GetCost() < b->GetCost())
-			return true;
-		return false;
-	}
-	if (!a && b)
-		return true;
-	return false;
+	if (a->GetGroup() != b->GetGroup())
+		return a->GetGroup() > b->GetGroup();
+	return a->GetCost() < b->GetCost();
 }
 
 void GOSoundScheduler::SortList(std::vector<GOSoundWorkItem*>& list)
 {
-	for(unsigned i = 0; i + 1 < list.size(); i++)
+	for(unsigned i = 1; i < list.size(); i++)
 	{
-		for(unsigned j = i; j > 0 && CompareItem(list[j], list[j + 1]); j--)
+		for(unsigned j = i; j > 0 && CompareItem(list[j - 1], list[j]); j--)
 		{
 			GOSoundWorkItem* tmp = list[j];
-			list[j] = list[j + 1];
-			list[j + 1] = tmp;
+			list[j] = list[j - 1];
+			list[j - 1] = tmp;
 		}
 	}
 }
 
-void GOSoundScheduler::ResetList(std::vector<GOSoundWorkItem*>& list)
-{
-	SortList(list);
-	for(unsigned i = 0; i < list.size(); i++)
-		if (list[i])
-			list[i]->Reset();
-}
-
 void GOSoundScheduler::Reset()
 {
-	GOMutexLocker lock(m_Mutex);
-	ResetList(m_Work);
-	m_NextItem.exchange(0);
+	GOSoundSchedulerState* state = AcquireState();
+	if (state)
+	{
+		SortList(state->items);
+		for(unsigned i = 0; i < state->items.size(); i++)
+			state->items[i]->Reset();
+	}
+	ReleaseState();
+	for(unsigned i = 0; i < m_QueueCount; i++)
+		m_Queues[i] = 0;
+	m_Period.fetch_add(1);
 }
 
-void GOSoundScheduler::ExecList(std::vector<GOSoundWorkItem*>& list)
+void GOSoundScheduler::Exec()
 {
-	for(unsigned i = 0; i < list.size(); i++)
-		if (list[i])
-			list[i]->Exec();
+	GOSoundSchedulerState* state = AcquireState();
+	if (state)
+		for(unsigned i = 0; i < state->items.size(); i++)
+			state->items[i]->Exec();
+	ReleaseState();
 }
 
-void GOSoundScheduler::Exec()
+unsigned GOSoundScheduler::GetPeriod()
 {
-	GOMutexLocker lock(m_Mutex);
-	ExecList(m_Work);
+	return m_Period;
 }
 
-GOSoundWorkItem* GOSoundScheduler::GetNextGroup()
+GOSoundWorkItem* GOSoundScheduler::GetNextGroup(unsigned thread_index)
 {
-	do
+	GOSoundWorkItem* item = nullptr;
+	GOSoundSchedulerState* state = AcquireState();
+	if (state)
 	{
-		unsigned next = m_NextItem.fetch_add(1);
-		if (next >= m_ItemCount)
-			return nullptr;
-		GOSoundWorkItem* item = *m_WorkItems[next];
-		if (item)
-			return item;
-	} while(true);
+		unsigned count = m_QueueCount;
+		unsigned slots = state->slots.size();
+		for(unsigned i = 0; i < count && !item; i++)
+		{
+			unsigned queue = (thread_index + i) % count;
+			do
+			{
+				unsigned slot = queue + m_Queues[queue].fetch_add(1) * count;
+				if (slot >= slots)
+					break;
+				item = *state->slots[slot];
+			}
+			while(!item);
+		}
+	}
+	ReleaseState();
+	return item;
 }
-
@@ -9,36 +9,63 @@
 
 #include "threading/atomic.h"
 #include "threading/GOMutex.h"
+#include "GOrgueLimits.h"
 #include <vector>
 
 class GOSoundWorkItem;
 
+/* Distributes the work items of a period over the sound threads.
+ *
+ * The configured items are published as a snapshot, so the audio callback
+ * (Reset/Exec) and the sound threads (GetNextGroup) never take a lock. Only
+ * Add/Remove/Clear, which run while the organ is set up, serialize on
+ * m_Mutex. Reset reorders the items of the snapshot by their current cost,
+ * the work slots themselves never change.
+ *
+ * Every thread owns a queue holding every n-th work slot of the snapshot.
+ * The slots are ordered by stage (tremulants, windchests, audio groups,
+ * outputs, ...) and by cost inside a stage, so each queue starts with the
+ * items the later stages depend on. A thread whose queue is drained steals
+ * from the queues of the other threads. Consumers still pull their inputs
+ * through Finish(), which runs or joins the producer, so the ordering is
+ * only a hint and never a correctness requirement.
+ *
+ * Items with GetRepeat() get a slot per thread (at least the repeat count),
+ * so every thread can join a busy audio group. A thread that finds the
+ * group already drained leaves it at once.
+ */
 class GOSoundScheduler
 {
 private:
+	typedef struct
+	{
+		std::vector<GOSoundWorkItem*> items;
+		std::vector<GOSoundWorkItem**> slots;
+	} GOSoundSchedulerState;
+
 	std::vector<GOSoundWorkItem*> m_Work;
-	std::vector<GOSoundWorkItem**> m_WorkItems;
-	atomic_uint m_NextItem;
-	unsigned m_ItemCount;
+	atomic<GOSoundSchedulerState*> m_State;
+	atomic_int m_Readers;
+	atomic_uint m_Queues[MAX_CPU];
+	unsigned m_QueueCount;
+	atomic_uint m_Period;
 	unsigned m_RepeatCount;
 	GOMutex m_Mutex;
 
-	void Lock();
-	void Unlock();
+	GOSoundSchedulerState* AcquireState();
+	void ReleaseState();
 	void Update();
 
-	bool CompareItem(GOSoundWorkItem* a, GOSoundWorkItem* b);
-	void SortList(std::vector<GOSoundWorkItem*>& list);
-	void ResetList(std::vector<GOSoundWorkItem*>& list);
-	void AddList(GOSoundWorkItem* item, std::vector<GOSoundWorkItem*>& list);
-	void RemoveList(GOSoundWorkItem* item, std::vector<GOSoundWorkItem*>& list);
-	void ExecList(std::vector<GOSoundWorkItem*>& list);
+	static bool CompareItem(GOSoundWorkItem* a, GOSoundWorkItem* b);
+	static void SortList(std::vector<GOSoundWorkItem*>& list);
 
 public:
 	GOSoundScheduler();
 	~GOSoundScheduler();
 
 	void SetRepeatCount(unsigned count);
+	void SetThreadCount(unsigned count);
+	unsigned GetThreadCount();
 
 	void Clear();
 	void Reset();
@@ -46,7 +73,8 @@ public:
 	void Add(GOSoundWorkItem* item);
 	void Remove(GOSoundWorkItem* item);
 
-	GOSoundWorkItem* GetNextGroup();
+	unsigned GetPeriod();
+	GOSoundWorkItem* GetNextGroup(unsigned thread_index = 0);
 };
 
 #endif
@@ -0,0 +1,70 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundStreamThread.h"
+
+#include "GOSoundAudioSection.h"
+
+GOSoundStreamThread::GOSoundStreamThread() :
+	GOrgueThread(),
+	m_Queue(),
+	m_Wait(),
+	m_Sleeping(0)
+{
+}
+
+bool GOSoundStreamThread::Process()
+{
+	GOSoundStreamRequest request;
+	if (!m_Queue.Pop(request))
+		return false;
+	GOSoundStreamBuffer* buffer = request.buffer;
+	if (buffer->generation != request.generation)
+		return true;
+	unsigned slot = request.chunk % STREAM_CHUNKS;
+	buffer->loaded[slot] = 0;
+	request.section->ReadStreamChunk(request.chunk, buffer->data + slot * STREAM_SLOT_SIZE);
+	buffer->loaded[slot] = GOSoundStreamer::GetChunkTag(request.generation, request.chunk);
+	return true;
+}
+
+void GOSoundStreamThread::Entry()
+{
+	while(!ShouldStop())
+	{
+		if (Process())
+			continue;
+		m_Sleeping = 1;
+		if (Process())
+		{
+			m_Sleeping = 0;
+			continue;
+		}
+		m_Wait.Wait(true);
+		m_Sleeping = 0;
+	}
+}
+
+void GOSoundStreamThread::Run()
+{
+	Start();
+}
+
+void GOSoundStreamThread::Delete()
+{
+	MarkForStop();
+	m_Wait.Wakeup();
+	Wait();
+}
+
+bool GOSoundStreamThread::Add(const GOSoundStreamRequest& request)
+{
+	if (!m_Queue.Push(request))
+		return false;
+	if (m_Sleeping.exchange(0))
+		m_Wait.Wakeup();
+	return true;
+}
@@ -0,0 +1,39 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDSTREAMTHREAD_H
+#define GOSOUNDSTREAMTHREAD_H
+
+#include "GOSoundStreamer.h"
+#include "threading/atomic.h"
+#include "threading/GOMpscQueue.h"
+#include "threading/GOWaitQueue.h"
+#include "threading/GOrgueThread.h"
+
+/* Loads the requested chunks of the streamed sections into the stream
+ * buffers. The page faults of the mapped cache happen here instead of in
+ * the sound threads. */
+class GOSoundStreamThread : public GOrgueThread
+{
+private:
+	GOMpscQueue<GOSoundStreamRequest, 1024> m_Queue;
+	GOWaitQueue m_Wait;
+	atomic_uint m_Sleeping;
+
+	bool Process();
+	void Entry();
+
+public:
+	GOSoundStreamThread();
+
+	void Run();
+	void Delete();
+
+	/* Returns false if the queue is full */
+	bool Add(const GOSoundStreamRequest& request);
+};
+
+#endif
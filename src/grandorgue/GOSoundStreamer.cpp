@@ -0,0 +1,113 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOSoundStreamer.h"
+
+#include "GOSoundStreamThread.h"
+
+GOSoundStreamer::GOSoundStreamer() :
+	m_Buffers(STREAM_BUFFERS),
+	m_Data(),
+	m_Silence(STREAM_SLOT_SIZE),
+	m_Threads(),
+	m_Next(0),
+	m_Underruns(0)
+{
+	for(unsigned i = 0; i < m_Buffers.size(); i++)
+		m_Buffers[i].index = i;
+}
+
+GOSoundStreamer::~GOSoundStreamer()
+{
+	Stop();
+}
+
+void GOSoundStreamer::Start()
+{
+	if (m_Threads.size())
+		return;
+	if (!m_Data.size())
+	{
+		m_Data.resize(m_Buffers.size() * STREAM_CHUNKS * STREAM_SLOT_SIZE);
+		for(unsigned i = 0; i < m_Buffers.size(); i++)
+			m_Buffers[i].data = &m_Data[i * STREAM_CHUNKS * STREAM_SLOT_SIZE];
+	}
+	Reset();
+	m_Underruns = 0;
+	for(unsigned i = 0; i < STREAM_THREADS; i++)
+		m_Threads.push_back(new GOSoundStreamThread());
+	for(unsigned i = 0; i < m_Threads.size(); i++)
+		m_Threads[i]->Run();
+}
+
+void GOSoundStreamer::Stop()
+{
+	for(unsigned i = 0; i < m_Threads.size(); i++)
+		m_Threads[i]->Delete();
+	m_Threads.clear();
+	Reset();
+}
+
+/* Frees all buffers, only called when no sampler is playing */
+void GOSoundStreamer::Reset()
+{
+	for(unsigned i = 0; i < m_Buffers.size(); i++)
+	{
+		GOSoundStreamBuffer& buffer = m_Buffers[i];
+		buffer.generation.fetch_add(1);
+		buffer.used = 0;
+		for(unsigned j = 0; j < STREAM_CHUNKS; j++)
+			buffer.loaded[j] = 0;
+	}
+}
+
+bool GOSoundStreamer::IsActive() const
+{
+	return m_Threads.size() > 0;
+}
+
+/* Returns NULL if all buffers are in use */
+GOSoundStreamBuffer* GOSoundStreamer::Acquire()
+{
+	if (!IsActive())
+		return NULL;
+	unsigned start = m_Next.fetch_add(1);
+	for(unsigned i = 0; i < m_Buffers.size(); i++)
+	{
+		GOSoundStreamBuffer& buffer = m_Buffers[(start + i) % m_Buffers.size()];
+		unsigned expected = 0;
+		if (buffer.used.compare_exchange(expected, 1))
+		{
+			buffer.generation.fetch_add(1);
+			return &buffer;
+		}
+	}
+	return NULL;
+}
+
+void GOSoundStreamer::Release(GOSoundStreamBuffer* buffer)
+{
+	buffer->generation.fetch_add(1);
+	buffer->used = 0;
+}
+
+bool GOSoundStreamer::Request(GOSoundStreamBuffer* buffer, unsigned generation, const GOAudioSection* section, unsigned chunk)
+{
+	if (!m_Threads.size())
+		return false;
+	GOSoundStreamRequest request = { buffer, generation, section, chunk };
+	return m_Threads[buffer->index % m_Threads.size()]->Add(request);
+}
+
+void GOSoundStreamer::AddUnderrun()
+{
+	m_Underruns.fetch_add(1);
+}
+
+unsigned GOSoundStreamer::GetUnderruns() const
+{
+	return m_Underruns;
+}
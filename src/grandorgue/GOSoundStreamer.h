@@ -0,0 +1,103 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GOSOUNDSTREAMER_H
+#define GOSOUNDSTREAMER_H
+
+#include "ptrvector.h"
+#include "threading/atomic.h"
+#include <stdint.h>
+#include <vector>
+
+class GOAudioSection;
+class GOSoundStreamThread;
+
+/* Frames per chunk of a stream buffer */
+#define STREAM_CHUNK_SIZE 4096
+/* Chunks per stream buffer: the playing one and the prefetched ones */
+#define STREAM_CHUNKS 4
+/* Frames stored after the end of a chunk for the decoder readahead */
+#define STREAM_MARGIN 64
+/* Largest frame (all channels) of a streamed section in bytes */
+#define STREAM_MAX_FRAME_SIZE 8
+/* Frames of a streamed section, which always stay in memory */
+#define STREAM_HEAD_LENGTH (8 * STREAM_CHUNK_SIZE)
+#define STREAM_BUFFERS 256
+#define STREAM_THREADS 2
+
+#define STREAM_SLOT_SIZE ((STREAM_CHUNK_SIZE + STREAM_MARGIN) * STREAM_MAX_FRAME_SIZE)
+
+typedef struct
+{
+	unsigned index;
+	atomic_uint used;
+	/* Changes on every acquire and release, so stale requests are dropped */
+	atomic_uint generation;
+	/* Chunk held by each slot: (generation << 32) | (chunk + 1), 0 if none */
+	atomic<uint64_t> loaded[STREAM_CHUNKS];
+	unsigned char* data;
+} GOSoundStreamBuffer;
+
+typedef struct
+{
+	GOSoundStreamBuffer* buffer;
+	unsigned generation;
+	const GOAudioSection* section;
+	unsigned chunk;
+} GOSoundStreamRequest;
+
+/* Pool of the per sampler ring buffers of streamed audio sections.
+ *
+ * A stream owns a buffer while it plays the streamed part of its section.
+ * The slot of chunk k is k % STREAM_CHUNKS; once the stream moves to the next
+ * chunk, the slot it left is requested for the chunk STREAM_CHUNKS ahead.
+ * The requests of a buffer are always handled by the same prefetch thread,
+ * so they are processed in order. A chunk which is not loaded when it is
+ * needed is played as silence and counted as underrun. A stream, which got
+ * no buffer, reads the mapped cache directly, as if it was not streamed. */
+class GOSoundStreamer
+{
+private:
+	std::vector<GOSoundStreamBuffer> m_Buffers;
+	std::vector<unsigned char> m_Data;
+	std::vector<unsigned char> m_Silence;
+	ptr_vector<GOSoundStreamThread> m_Threads;
+	atomic_uint m_Next;
+	atomic_uint m_Underruns;
+
+	GOSoundStreamer(const GOSoundStreamer&) = delete;
+	const GOSoundStreamer& operator=(const GOSoundStreamer&) = delete;
+
+public:
+	GOSoundStreamer();
+	~GOSoundStreamer();
+
+	void Start();
+	void Stop();
+	void Reset();
+	bool IsActive() const;
+
+	GOSoundStreamBuffer* Acquire();
+	void Release(GOSoundStreamBuffer* buffer);
+	/* Returns false if the request could not be queued */
+	bool Request(GOSoundStreamBuffer* buffer, unsigned generation, const GOAudioSection* section, unsigned chunk);
+
+	/* Zeroed memory of a slot */
+	const unsigned char* GetSilence() const
+	{
+		return &m_Silence[0];
+	}
+
+	void AddUnderrun();
+	unsigned GetUnderruns() const;
+
+	static uint64_t GetChunkTag(unsigned generation, unsigned chunk)
+	{
+		return ((uint64_t)generation << 32) | (chunk + 1);
+	}
+};
+
+#endif
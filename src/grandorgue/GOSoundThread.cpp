@@ -10,10 +10,18 @@
 #include "GOSoundWorkItem.h"
 #include "threading/GOMutexLocker.h"
 #include <wx/log.h>
+#include <chrono>
+#include <thread>
 
-GOSoundThread::GOSoundThread(GOSoundScheduler* scheduler):
+/* How long an idle thread keeps polling for the next period before it
+ * sleeps on its condition. Only done if there is a spare core, otherwise
+ * the polling takes the time of the threads still working. */
+#define SOUND_THREAD_SPIN_US 200
+
+GOSoundThread::GOSoundThread(GOSoundScheduler* scheduler, unsigned index):
 	GOrgueThread(),
 	m_Scheduler(scheduler),
+	m_Index(index),
 	m_Condition(m_Mutex)
 {
 	wxLogDebug(wxT("Create Thread"));
@@ -21,13 +29,16 @@ GOSoundThread::GOSoundThread(GOSoundScheduler* scheduler):
 
 void GOSoundThread::Entry()
 {
+	const bool spin = m_Scheduler->GetThreadCount() < std::thread::hardware_concurrency();
+
 	while (! ShouldStop())
 	{
 		bool shouldStop = false;
+		unsigned period = m_Scheduler->GetPeriod();
 
 		do
 		{
-			GOSoundWorkItem *next = m_Scheduler->GetNextGroup();
+			GOSoundWorkItem *next = m_Scheduler->GetNextGroup(m_Index);
 
 			if (next == NULL)
 			  break;
@@ -39,6 +50,14 @@ void GOSoundThread::Entry()
 		if (shouldStop)
 			break;
 
+		/* With small buffers the next period starts soon, so poll for it
+		 * for a moment instead of paying for a wakeup */
+		std::chrono::steady_clock::time_point spin_end = std::chrono::steady_clock::now() + std::chrono::microseconds(SOUND_THREAD_SPIN_US);
+		while (spin && period == m_Scheduler->GetPeriod() && !ShouldStop() && std::chrono::steady_clock::now() < spin_end)
+			std::this_thread::yield();
+		if (period != m_Scheduler->GetPeriod())
+			continue;
+
 		GOMutexLocker lock(m_Mutex, false, "GOSoundThread::Entry", this);
 
 		if (! lock.IsLocked() || ShouldStop())
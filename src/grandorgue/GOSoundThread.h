@@ -17,6 +17,7 @@ class GOSoundThread : public GOrgueThread
 {
 private:
 	GOSoundScheduler* m_Scheduler;
+	unsigned m_Index;
 
 	GOMutex m_Mutex;
 	GOCondition m_Condition;
@@ -24,7 +25,7 @@ private:
 	void Entry();
 
 public:
-	GOSoundThread(GOSoundScheduler* scheduler);
+	GOSoundThread(GOSoundScheduler* scheduler, unsigned index = 0);
 
 	void Run();
 	void Delete();
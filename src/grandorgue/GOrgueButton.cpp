@@ -103,6 +103,13 @@ void GOrgueButton::HandleKey(int key)
 	}
 }
 
+bool GOrgueButton::GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys)
+{
+	if (m_ReadOnly)
+		return true;
+	return m_midi.GetMidiKeys(keys);
+}
+
 void GOrgueButton::Push()
 {
 	if (m_ReadOnly)
@@ -38,6 +38,7 @@ protected:
 
 	void ProcessMidi(const GOrgueMidiEvent& event);
 	void HandleKey(int key);
+	bool GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys);
 
 	void Save(GOrgueConfigWriter& cfg);
 
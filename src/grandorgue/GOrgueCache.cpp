@@ -9,16 +9,36 @@
 #include "GOrgueAlloc.h"
 #include "GOrgueMemoryPool.h"
 #include "GrandOrgueDef.h"
+#include <wx/file.h>
 #include <wx/wfstream.h>
 #include <wx/zstream.h>
+#include <algorithm>
+#include <string.h>
+#include <zlib.h>
+#ifdef __WIN32__
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 GOrgueCache::GOrgueCache(wxFile& cache_file, GOrgueMemoryPool& pool) :
 	m_stream(0),
 	m_fstream(0),
 	m_zstream(0),
+	m_File(&cache_file),
 	m_pool(pool),
 	m_Mapable(false),
-	m_OK(false)
+	m_OK(false),
+	m_Version(0),
+	m_Data(0),
+	m_Size(0),
+	m_Position(0),
+	m_Objects(),
+	m_Blocks(),
+	m_Block(),
+	m_Compressed(),
+	m_BlockIndex(-1)
 {
 	int magic;
 
@@ -26,11 +46,19 @@ GOrgueCache::GOrgueCache(wxFile& cache_file, GOrgueMemoryPool& pool) :
 
 	m_fstream->Read(&magic, sizeof(magic));
 	if (m_fstream->LastRead() == sizeof(magic) &&
-	    magic == GRANDORGUE_CACHE_MAGIC)
+	    (magic == GRANDORGUE_CACHE_MAGIC || magic == GRANDORGUE_CACHE_MAGIC_V2))
 	{
+		m_Version = magic == GRANDORGUE_CACHE_MAGIC_V2 ? 2 : 1;
+		m_Position = sizeof(magic);
 		m_Mapable = true;
 		m_OK = true;
 	}
+	else if (m_fstream->LastRead() == sizeof(magic) && magic == GRANDORGUE_CACHE_MAGIC_COMPRESSED)
+	{
+		m_Version = 3;
+		m_OK = ReadBlockIndex(cache_file) && ReadAt(&magic, sizeof(magic), 0) && magic == GRANDORGUE_CACHE_MAGIC_V2;
+		m_Position = sizeof(magic);
+	}
 	else
 	{
 		m_fstream->SeekI(0, wxFromStart);
@@ -41,6 +69,7 @@ GOrgueCache::GOrgueCache(wxFile& cache_file, GOrgueMemoryPool& pool) :
 			if (m_zstream->LastRead() == sizeof(magic) &&
 			    magic == GRANDORGUE_CACHE_MAGIC)
 			{
+				m_Version = 1;
 				m_Mapable = false;
 				m_OK = true;
 			}
@@ -51,6 +80,35 @@ GOrgueCache::GOrgueCache(wxFile& cache_file, GOrgueMemoryPool& pool) :
 		m_Mapable = false;
 	if (m_Mapable)
 		m_Mapable = m_pool.SetCacheFile(cache_file);
+	if (m_Mapable && m_Version == 2)
+	{
+		m_Data = m_pool.GetCacheStart();
+		m_Size = m_pool.GetMappedSize();
+	}
+	else if (m_Version == 2)
+		m_Size = cache_file.Length();
+	if (m_OK && m_Version >= 2 && !ReadObjectTable())
+		m_OK = false;
+}
+
+GOrgueCache::GOrgueCache(GOrgueCache& cache) :
+	m_stream(0),
+	m_fstream(0),
+	m_zstream(0),
+	m_File(cache.m_File),
+	m_pool(cache.m_pool),
+	m_Mapable(cache.m_Mapable),
+	m_OK(cache.m_OK),
+	m_Version(cache.m_Version),
+	m_Data(cache.m_Data),
+	m_Size(cache.m_Size),
+	m_Position(cache.m_Position),
+	m_Objects(cache.m_Objects),
+	m_Blocks(cache.m_Blocks),
+	m_Block(),
+	m_Compressed(),
+	m_BlockIndex(-1)
+{
 }
 
 GOrgueCache::~GOrgueCache()
@@ -58,6 +116,174 @@ GOrgueCache::~GOrgueCache()
 	Close();
 }
 
+bool GOrgueCache::ReadBlockIndex(wxFile& cache_file)
+{
+	GOrgueCacheBlockTrailer trailer;
+	uint64_t size = cache_file.Length();
+
+	if (size < sizeof(int) + sizeof(trailer))
+		return false;
+	if (!ReadFileAt(&trailer, sizeof(trailer), size - sizeof(trailer)))
+		return false;
+	if (trailer.magic != GRANDORGUE_CACHE_MAGIC_COMPRESSED ||
+	    trailer.index_offset + (trailer.block_count + 1) * sizeof(uint64_t) + sizeof(trailer) != size ||
+	    trailer.size > (uint64_t)trailer.block_count * GO_CACHE_BLOCK_SIZE)
+		return false;
+
+	m_Blocks.resize(trailer.block_count + 1);
+	if (!ReadFileAt(&m_Blocks[0], m_Blocks.size() * sizeof(uint64_t), trailer.index_offset))
+		return false;
+	for(unsigned i = 0; i < trailer.block_count; i++)
+		if (m_Blocks[i] > m_Blocks[i + 1] || m_Blocks[i + 1] > trailer.index_offset)
+			return false;
+	m_Size = trailer.size;
+	return true;
+}
+
+bool GOrgueCache::LoadBlock(unsigned index)
+{
+	if (index == m_BlockIndex)
+		return true;
+	if (index + 1 >= m_Blocks.size())
+		return false;
+	m_BlockIndex = -1;
+	unsigned length = m_Blocks[index + 1] - m_Blocks[index];
+	m_Compressed.resize(length);
+	m_Block.resize(GO_CACHE_BLOCK_SIZE);
+	if (length && !ReadFileAt(&m_Compressed[0], length, m_Blocks[index]))
+		return false;
+	uLongf block_length = GO_CACHE_BLOCK_SIZE;
+	if (uncompress(&m_Block[0], &block_length, length ? &m_Compressed[0] : NULL, length) != Z_OK)
+		return false;
+	m_Block.resize(block_length);
+	m_BlockIndex = index;
+	return true;
+}
+
+bool GOrgueCache::ReadObjectTable()
+{
+	GOrgueCacheTrailer trailer;
+	uint64_t size = m_Size;
+
+	if (size < sizeof(int) + sizeof(trailer))
+		return false;
+	if (!ReadAt(&trailer, sizeof(trailer), size - sizeof(trailer)))
+		return false;
+	if (trailer.magic != GRANDORGUE_CACHE_MAGIC_V2 ||
+	    trailer.table_offset + trailer.object_count * sizeof(GOrgueCacheObjectEntry) + sizeof(trailer) != size)
+		return false;
+
+	m_Objects.resize(trailer.object_count);
+	if (!trailer.object_count)
+		return true;
+	if (!ReadAt(&m_Objects[0], trailer.object_count * sizeof(GOrgueCacheObjectEntry), trailer.table_offset))
+		return false;
+	for(unsigned i = 0; i < m_Objects.size(); i++)
+		if (m_Objects[i].offset > trailer.table_offset)
+			return false;
+	std::sort(m_Objects.begin(), m_Objects.end(), CompareEntry);
+	return true;
+}
+
+/* Read from the V2 layout, which is either mapped, stored in the file
+ * or split into compressed blocks */
+bool GOrgueCache::ReadAt(void* data, unsigned length, uint64_t offset)
+{
+	if (offset + length > m_Size)
+		return false;
+	if (m_Data)
+	{
+		memcpy(data, m_Data + offset, length);
+		return true;
+	}
+	if (m_Version != 3)
+		return ReadFileAt(data, length, offset);
+
+	char* buf = (char*)data;
+	while (length)
+	{
+		if (!LoadBlock(offset / GO_CACHE_BLOCK_SIZE))
+			return false;
+		unsigned start = offset % GO_CACHE_BLOCK_SIZE;
+		if (start >= m_Block.size())
+			return false;
+		unsigned len = std::min(length, (unsigned)(m_Block.size() - start));
+		memcpy(buf, &m_Block[start], len);
+		buf += len;
+		offset += len;
+		length -= len;
+	}
+	return true;
+}
+
+/* Positional read, which does not move the file pointer. This allows
+ * several readers to share the file. */
+bool GOrgueCache::ReadFileAt(void* data, unsigned length, uint64_t offset)
+{
+#ifdef __WIN32__
+	HANDLE handle = (HANDLE)_get_osfhandle(m_File->fd());
+	OVERLAPPED ov;
+	DWORD read;
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = (DWORD)offset;
+	ov.OffsetHigh = (DWORD)(offset >> 32);
+	if (!ReadFile(handle, data, length, &read, &ov))
+		return false;
+	return read == length;
+#else
+	char* buf = (char*)data;
+	while (length)
+	{
+		ssize_t len = pread(m_File->fd(), buf, length, offset);
+		if (len <= 0)
+			return false;
+		buf += len;
+		offset += len;
+		length -= len;
+	}
+	return true;
+#endif
+}
+
+bool GOrgueCache::CanLoadParallel()
+{
+	return m_OK && m_Version >= 2 && m_Objects.size();
+}
+
+bool GOrgueCache::CanAppend()
+{
+	return m_OK && m_Version == 2;
+}
+
+const std::vector<GOrgueCacheObjectEntry>& GOrgueCache::GetObjects()
+{
+	return m_Objects;
+}
+
+uint64_t GOrgueCache::GetUsedSize(std::vector<GOrgueHashType> hashes)
+{
+	/* A record ends where the next one or the object table starts */
+	std::vector<uint64_t> offsets;
+	for(unsigned i = 0; i < m_Objects.size(); i++)
+		offsets.push_back(m_Objects[i].offset);
+	offsets.push_back(m_Size - sizeof(GOrgueCacheTrailer) - m_Objects.size() * sizeof(GOrgueCacheObjectEntry));
+	std::sort(offsets.begin(), offsets.end());
+
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+	uint64_t used = sizeof(int) + sizeof(GOrgueHashType);
+	for(unsigned i = 0; i < hashes.size(); i++)
+	{
+		GOrgueCacheObjectEntry entry;
+		entry.hash = hashes[i];
+		std::vector<GOrgueCacheObjectEntry>::iterator it = std::lower_bound(m_Objects.begin(), m_Objects.end(), entry, CompareEntry);
+		if (it == m_Objects.end() || !(it->hash == hashes[i]))
+			continue;
+		used += *std::upper_bound(offsets.begin(), offsets.end(), it->offset) - it->offset;
+	}
+	return used;
+}
+
 bool GOrgueCache::ReadHeader()
 {
 	return m_OK;
@@ -74,28 +300,79 @@ void GOrgueCache::Close()
 	m_fstream = 0;
 }
 
+bool GOrgueCache::CompareEntry(const GOrgueCacheObjectEntry& a, const GOrgueCacheObjectEntry& b)
+{
+	return a.hash < b.hash;
+}
+
+bool GOrgueCache::SeekObject(const GOrgueHashType& hash)
+{
+	GOrgueCacheObjectEntry entry;
+	entry.hash = hash;
+	std::vector<GOrgueCacheObjectEntry>::iterator it = std::lower_bound(m_Objects.begin(), m_Objects.end(), entry, CompareEntry);
+	if (it == m_Objects.end() || !(it->hash == hash))
+		return false;
+	m_Position = it->offset;
+	return true;
+}
+
+bool GOrgueCache::Align()
+{
+	if (m_Version < 2)
+		return true;
+	uint64_t pos = (m_Position + GO_CACHE_ALIGN - 1) & ~(uint64_t)(GO_CACHE_ALIGN - 1);
+	if (pos == m_Position)
+		return true;
+	m_Position = pos;
+	return true;
+}
+
 bool GOrgueCache::Read(void* data, unsigned length)
 {
+	if (m_Version >= 2)
+	{
+		if (!ReadAt(data, length, m_Position))
+			return false;
+		m_Position += length;
+		return true;
+	}
 	m_stream->Read(data, length);
 	if (m_stream->LastRead() != length)
 		return false;
+	m_Position += length;
 	return true;
 }
 
 void GOrgueCache::FreeCacheFile()
 {
 	m_Mapable = false;
+	m_Data = 0;
 	m_pool.FreeCacheFile();
 }
 
 void* GOrgueCache::ReadBlock(unsigned length)
 {
-	if (m_Mapable)
+	if (!Align())
+		return NULL;
+	if (m_Data)
+	{
+		if (m_Position + length > m_Size)
+			return NULL;
+		/* Pages are faulted in on first use or by the touch thread */
+		void *data = m_pool.GetCacheData(m_Position, length, false);
+		if (data)
+		{
+			m_Position += length;
+			return data;
+		}
+	}
+	else if (m_Mapable)
 	{
 		void *data = m_pool.GetCacheData(m_stream->TellI(), length);
 		if (data)
 		{
 			m_stream->SeekI(length, wxFromCurrent);
+			m_Position += length;
 			return data;
 		}
 	}
@@ -103,11 +380,22 @@ void* GOrgueCache::ReadBlock(unsigned length)
 	if (data == NULL)
 		throw GOrgueOutOfMemory();
 
+	if (m_Version >= 2)
+	{
+		if (!ReadAt(data, length, m_Position))
+		{
+			m_pool.Free(data);
+			return NULL;
+		}
+		m_Position += length;
+		return data;
+	}
 	m_stream->Read(data, length);
 	if (m_stream->LastRead() != length)
 	{
 		m_pool.Free(data);
 		return NULL;
 	}
+	m_Position += length;
 	return data;
 }
@@ -7,25 +7,127 @@
 #ifndef GORGUECACHE_H_
 #define GORGUECACHE_H_
 
+#include "GOrgueHash.h"
+#include <stdint.h>
+#include <vector>
+
 class GOrgueMemoryPool;
 class wxFile;
 class wxInputStream;
 
+/* Uncompressed caches (GRANDORGUE_CACHE_MAGIC_V2) are laid out to be
+ * mapped into memory as a whole:
+ *
+ *   int magic
+ *   data written by the caller (organ hash)
+ *   one record per distinct cache object, starting at a GO_CACHE_ALIGN
+ *   boundary
+ *   GOrgueCacheObjectEntry of every object record
+ *   GOrgueCacheTrailer
+ *
+ * Blocks written with WriteBlock start at a GO_CACHE_ALIGN boundary too,
+ * so the sample data can be used directly from the mapping. A cache, which
+ * was appended to, keeps its replaced records and old object tables in
+ * front of the new ones, only the last trailer is used.
+ *
+ * Compressed caches (GRANDORGUE_CACHE_MAGIC_COMPRESSED) store the same
+ * layout split into GO_CACHE_BLOCK_SIZE blocks, each compressed on its own:
+ *
+ *   int magic
+ *   zlib compressed blocks
+ *   uint64_t file offset of every block and of the end of the last block
+ *   GOrgueCacheBlockTrailer
+ *
+ * Any object can be decompressed without reading the blocks before it.
+ * They are never mapped or appended to, but always rewritten as a whole.
+ *
+ * Object records are keyed by the hash of their cache object, so objects
+ * whose settings did not change are found even if other objects were
+ * changed, added or removed.
+ *
+ * V2 and block compressed caches are read with positional reads (or from
+ * the mapping), so several readers can load disjoint objects of the same
+ * file at once. Older caches with GRANDORGUE_CACHE_MAGIC are still read
+ * as a plain or zlib compressed stream.
+ */
+#define GO_CACHE_ALIGN 64
+#define GO_CACHE_BLOCK_SIZE (1024 * 1024)
+
+typedef struct
+{
+	uint64_t table_offset;
+	uint32_t object_count;
+	int32_t magic;
+} GOrgueCacheTrailer;
+
+typedef struct
+{
+	uint64_t offset;
+	GOrgueHashType hash;
+	uint32_t reserved;
+} GOrgueCacheObjectEntry;
+
+typedef struct
+{
+	uint64_t index_offset;
+	/* Size of the uncompressed layout */
+	uint64_t size;
+	uint32_t block_count;
+	int32_t magic;
+} GOrgueCacheBlockTrailer;
+
 class GOrgueCache {
 	wxInputStream* m_stream;
 	wxInputStream* m_fstream;
 	wxInputStream* m_zstream;
+	wxFile* m_File;
 	GOrgueMemoryPool& m_pool;
 	bool m_Mapable;
 	bool m_OK;
+	unsigned m_Version;
+	/* Start of the mapped cache file, if the whole file could be mapped */
+	const char* m_Data;
+	uint64_t m_Size;
+	uint64_t m_Position;
+	/* Object table, sorted by hash */
+	std::vector<GOrgueCacheObjectEntry> m_Objects;
+	/* Block compressed caches: block offsets and the current block */
+	std::vector<uint64_t> m_Blocks;
+	std::vector<unsigned char> m_Block;
+	std::vector<unsigned char> m_Compressed;
+	unsigned m_BlockIndex;
+
+	bool ReadBlockIndex(wxFile& cache_file);
+	bool ReadObjectTable();
+	bool LoadBlock(unsigned index);
+	bool Align();
+	bool ReadAt(void* data, unsigned length, uint64_t offset);
+	bool ReadFileAt(void* data, unsigned length, uint64_t offset);
+
+	static bool CompareEntry(const GOrgueCacheObjectEntry& a, const GOrgueCacheObjectEntry& b);
 
 public:
 	GOrgueCache(wxFile& cache_file, GOrgueMemoryPool& pool);
+	/* Additional reader for the same file, see CanLoadParallel */
+	GOrgueCache(GOrgueCache& cache);
 	virtual ~GOrgueCache();
 
 	bool ReadHeader();
 	void FreeCacheFile();
 
+	/* Objects can be loaded by several readers at once */
+	bool CanLoadParallel();
+	/* Uncompressed caches can be continued in place, see
+	 * GOrgueCacheWriter::Append */
+	bool CanAppend();
+	const std::vector<GOrgueCacheObjectEntry>& GetObjects();
+	/* Bytes of an uncompressed cache taken by the records of the object
+	 * hashes, the rest belongs to replaced records and old tables */
+	uint64_t GetUsedSize(std::vector<GOrgueHashType> hashes);
+	/* Position the reader at the start of the record of an object hash.
+	 * Returns false if the cache has no such record. */
+	bool SeekObject(const GOrgueHashType& hash);
+
 	bool Read(void* data, unsigned length);
 	/* Allocate and read a block written by WriteBlock */
 	void* ReadBlock(unsigned length);
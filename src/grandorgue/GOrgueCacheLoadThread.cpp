@@ -0,0 +1,88 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOrgueCacheLoadThread.h"
+
+#include "GOrgueAlloc.h"
+#include "GOrgueCacheObject.h"
+#include "GOrgueEventDistributor.h"
+#include <wx/intl.h>
+
+#define CACHE_LOAD_CHUNK (16)
+
+GOrgueCacheLoadThread::GOrgueCacheLoadThread(GOrgueEventDistributor& objs, GOrgueCache& cache, const std::vector<GOrgueHashType>& hashes, atomic_uint& pos, atomic_uint& done, atomic_uint& missed) :
+	GOrgueThread(),
+	m_Objects(objs),
+	m_Reader(cache),
+	m_Hashes(hashes),
+	m_Pos(pos),
+	m_Done(done),
+	m_Missed(missed),
+	m_Error(),
+	m_OutOfMemory(false)
+{
+}
+
+GOrgueCacheLoadThread::~GOrgueCacheLoadThread()
+{
+	Stop();
+}
+
+void GOrgueCacheLoadThread::checkResult()
+{
+	Wait();
+	if (m_Error != wxEmptyString)
+		throw m_Error;
+	if (m_OutOfMemory)
+		throw GOrgueOutOfMemory();
+}
+
+void GOrgueCacheLoadThread::Run()
+{
+	Start();
+}
+
+void GOrgueCacheLoadThread::Entry()
+{
+	try
+	{
+		while (!ShouldStop())
+			if (!LoadChunk(m_Objects, m_Reader, m_Hashes, m_Pos, m_Done, m_Missed))
+				return;
+	}
+	catch (GOrgueOutOfMemory e)
+	{
+		m_OutOfMemory = true;
+	}
+	catch (wxString error)
+	{
+		m_Error = error;
+	}
+}
+
+/* Claims and loads the next run of objects. Returns the last object
+ * loaded, NULL if all objects have been claimed. */
+GOrgueCacheObject* GOrgueCacheLoadThread::LoadChunk(GOrgueEventDistributor& objs, GOrgueCache& reader, const std::vector<GOrgueHashType>& hashes, atomic_uint& pos, atomic_uint& done, atomic_uint& missed)
+{
+	GOrgueCacheObject* last = NULL;
+	unsigned start = pos.fetch_add(CACHE_LOAD_CHUNK);
+	for(unsigned i = start; i < start + CACHE_LOAD_CHUNK; i++)
+	{
+		GOrgueCacheObject* obj = objs.GetCacheObject(i);
+		if (!obj)
+			break;
+		if (reader.CanLoadParallel() && !reader.SeekObject(hashes[i]))
+		{
+			obj->LoadData();
+			missed.fetch_add(1);
+		}
+		else if (!obj->LoadCache(reader))
+			throw wxString::Format(_("Failed to read %s from cache."), obj->GetLoadTitle().c_str());
+		done.fetch_add(1);
+		last = obj;
+	}
+	return last;
+}
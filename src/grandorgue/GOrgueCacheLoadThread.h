@@ -0,0 +1,48 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GORGUECACHELOADTHREAD_H
+#define GORGUECACHELOADTHREAD_H
+
+#include "GOrgueCache.h"
+#include "threading/atomic.h"
+#include "threading/GOrgueThread.h"
+#include <wx/string.h>
+#include <vector>
+
+class GOrgueCacheObject;
+class GOrgueEventDistributor;
+
+/* Restores cache objects with its own reader of a shared cache file.
+ * Objects are claimed in runs of CACHE_LOAD_CHUNK consecutive objects, so
+ * every thread reads disjoint, mostly sequential parts of the file.
+ * Objects without a record for their hash are loaded from the sample files
+ * and counted in missed. */
+class GOrgueCacheLoadThread : private GOrgueThread
+{
+private:
+	GOrgueEventDistributor& m_Objects;
+	GOrgueCache m_Reader;
+	const std::vector<GOrgueHashType>& m_Hashes;
+	atomic_uint& m_Pos;
+	atomic_uint& m_Done;
+	atomic_uint& m_Missed;
+	wxString m_Error;
+	bool m_OutOfMemory;
+
+	void Entry();
+
+public:
+	GOrgueCacheLoadThread(GOrgueEventDistributor& objs, GOrgueCache& cache, const std::vector<GOrgueHashType>& hashes, atomic_uint& pos, atomic_uint& done, atomic_uint& missed);
+	~GOrgueCacheLoadThread();
+
+	void Run();
+	void checkResult();
+
+	static GOrgueCacheObject* LoadChunk(GOrgueEventDistributor& objs, GOrgueCache& reader, const std::vector<GOrgueHashType>& hashes, atomic_uint& pos, atomic_uint& done, atomic_uint& missed);
+};
+
+#endif
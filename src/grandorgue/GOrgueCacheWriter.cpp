@@ -6,18 +6,33 @@
 
 #include "GOrgueCacheWriter.h"
 
+#include "GOrgueCache.h"
 #include "GrandOrgueDef.h"
-#include <wx/zstream.h>
+#include <wx/stream.h>
+#include <algorithm>
+#include <string.h>
+#include <thread>
+#include <zlib.h>
 
-GOrgueCacheWriter::GOrgueCacheWriter(wxOutputStream& stream, bool compressed) :
-	m_zstream(0),
-	m_stream(&stream)
+/* Blocks collected per thread before they are compressed */
+#define CACHE_BLOCKS_PER_THREAD 4
+
+GOrgueCacheWriter::GOrgueCacheWriter(wxOutputStream& stream, bool compressed, unsigned threads) :
+	m_stream(&stream),
+	m_Compressed(compressed),
+	m_Threads(std::max(threads, 1u)),
+	m_Position(0),
+	m_FilePosition(0),
+	m_Objects(),
+	m_Hashes(),
+	m_Written(),
+	m_Existing(),
+	m_Blocks(),
+	m_Pending(),
+	m_PendingCount(0)
 {
-	if (compressed)
-	{
-		m_zstream = new wxZlibOutputStream(stream);
-		m_stream = m_zstream;
-	}
+	if (m_Compressed)
+		m_Pending.resize(m_Threads * CACHE_BLOCKS_PER_THREAD);
 }
 
 GOrgueCacheWriter::~GOrgueCacheWriter()
@@ -27,34 +42,193 @@ GOrgueCacheWriter::~GOrgueCacheWriter()
 
 bool GOrgueCacheWriter::WriteHeader()
 {
-	int magic = GRANDORGUE_CACHE_MAGIC;
+	int magic = GRANDORGUE_CACHE_MAGIC_COMPRESSED;
+	if (m_Compressed && !WriteFile(&magic, sizeof(magic)))
+		return false;
+	magic = GRANDORGUE_CACHE_MAGIC_V2;
 	if (!Write(&magic, sizeof(magic)))
 		return false;
 	return true;
 }
 
-bool GOrgueCacheWriter::Write(const void* data, unsigned length)
+void GOrgueCacheWriter::Append(const std::vector<GOrgueCacheObjectEntry>& objects, uint64_t size)
+{
+	m_Position = size;
+	m_FilePosition = size;
+	for(unsigned i = 0; i < objects.size(); i++)
+		m_Existing[objects[i].hash] = objects[i].offset;
+}
+
+bool GOrgueCacheWriter::WriteFile(const void* data, unsigned length)
 {
 	m_stream->Write(data, length);
 	if (m_stream->LastWrite() != length)
 		return false;
+	m_FilePosition += length;
 	return true;
 }
 
-bool GOrgueCacheWriter::WriteBlock(const void* data, unsigned length)
+/* Add data to the uncompressed layout */
+bool GOrgueCacheWriter::Output(const void* data, unsigned length)
 {
-	m_stream->Write(data, length);
-	if (m_stream->LastWrite() != length)
+	if (!m_Compressed)
+	{
+		if (!WriteFile(data, length))
+			return false;
+		m_Position += length;
+		return true;
+	}
+
+	const unsigned char* buf = (const unsigned char*)data;
+	while (length)
+	{
+		if (m_PendingCount == m_Pending.size() && !FlushBlocks())
+			return false;
+		if (!m_PendingCount || m_Pending[m_PendingCount - 1].data.size() == GO_CACHE_BLOCK_SIZE)
+		{
+			m_Pending[m_PendingCount].data.clear();
+			m_Pending[m_PendingCount].data.reserve(GO_CACHE_BLOCK_SIZE);
+			m_PendingCount++;
+			continue;
+		}
+		std::vector<unsigned char>& block = m_Pending[m_PendingCount - 1].data;
+		unsigned len = std::min(length, (unsigned)(GO_CACHE_BLOCK_SIZE - block.size()));
+		block.insert(block.end(), buf, buf + len);
+		buf += len;
+		length -= len;
+		m_Position += len;
+	}
+	return true;
+}
+
+void GOrgueCacheWriter::CompressBlocks(std::vector<GOrgueCacheWriterBlock>* blocks, unsigned count, atomic_uint* pos)
+{
+	for(unsigned i = pos->fetch_add(1); i < count; i = pos->fetch_add(1))
+	{
+		GOrgueCacheWriterBlock& block = (*blocks)[i];
+		uLongf length = compressBound(block.data.size());
+		block.compressed.resize(length);
+		block.ok = compress2(&block.compressed[0], &length, &block.data[0], block.data.size(), Z_BEST_SPEED) == Z_OK;
+		block.compressed.resize(length);
+	}
+}
+
+/* Compress the pending blocks in parallel and write them in order */
+bool GOrgueCacheWriter::FlushBlocks()
+{
+	atomic_uint pos(0);
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < std::min(m_Threads, m_PendingCount); i++)
+		threads.push_back(std::thread(CompressBlocks, &m_Pending, m_PendingCount, &pos));
+	CompressBlocks(&m_Pending, m_PendingCount, &pos);
+	for(unsigned i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	for(unsigned i = 0; i < m_PendingCount; i++)
+	{
+		if (!m_Pending[i].ok)
+			return false;
+		m_Blocks.push_back(m_FilePosition);
+		if (!WriteFile(&m_Pending[i].compressed[0], m_Pending[i].compressed.size()))
+			return false;
+	}
+	m_PendingCount = 0;
+	return true;
+}
+
+bool GOrgueCacheWriter::Align()
+{
+	static const char padding[GO_CACHE_ALIGN] = { 0 };
+	unsigned length = (GO_CACHE_ALIGN - m_Position % GO_CACHE_ALIGN) % GO_CACHE_ALIGN;
+	return Output(padding, length);
+}
+
+bool GOrgueCacheWriter::HasObject(const GOrgueHashType& hash)
+{
+	return m_Written.count(hash) > 0;
+}
+
+bool GOrgueCacheWriter::KeepObject(const GOrgueHashType& hash)
+{
+	std::map<GOrgueHashType, uint64_t>::iterator it = m_Existing.find(hash);
+	if (it == m_Existing.end())
+		return false;
+	m_Objects.push_back(it->second);
+	m_Hashes.push_back(hash);
+	m_Written.insert(hash);
+	return true;
+}
+
+bool GOrgueCacheWriter::BeginObject(const GOrgueHashType& hash)
+{
+	if (!Align())
 		return false;
+	m_Objects.push_back(m_Position);
+	m_Hashes.push_back(hash);
+	m_Written.insert(hash);
 	return true;
 }
 
+bool GOrgueCacheWriter::Write(const void* data, unsigned length)
+{
+	return Output(data, length);
+}
+
+bool GOrgueCacheWriter::WriteBlock(const void* data, unsigned length)
+{
+	if (!Align())
+		return false;
+	return Output(data, length);
+}
+
+bool GOrgueCacheWriter::WriteIndex()
+{
+	GOrgueCacheTrailer trailer;
+	trailer.table_offset = m_Position;
+	trailer.object_count = m_Objects.size();
+	trailer.magic = GRANDORGUE_CACHE_MAGIC_V2;
+	for(unsigned i = 0; i < m_Objects.size(); i++)
+	{
+		GOrgueCacheObjectEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.offset = m_Objects[i];
+		entry.hash = m_Hashes[i];
+		if (!Write(&entry, sizeof(entry)))
+			return false;
+	}
+	if (!Write(&trailer, sizeof(trailer)))
+		return false;
+	if (!m_Compressed)
+		return true;
+
+	if (m_PendingCount && !FlushBlocks())
+		return false;
+	GOrgueCacheBlockTrailer block_trailer;
+	block_trailer.index_offset = m_FilePosition;
+	block_trailer.size = m_Position;
+	block_trailer.block_count = m_Blocks.size();
+	block_trailer.magic = GRANDORGUE_CACHE_MAGIC_COMPRESSED;
+	m_Blocks.push_back(m_FilePosition);
+	if (!WriteFile(&m_Blocks[0], m_Blocks.size() * sizeof(uint64_t)))
+		return false;
+	return WriteFile(&block_trailer, sizeof(block_trailer));
+}
+
+uint64_t GOrgueCacheWriter::GetSize()
+{
+	return m_Position;
+}
+
+uint64_t GOrgueCacheWriter::GetFileSize()
+{
+	return m_FilePosition;
+}
+
 void GOrgueCacheWriter::Close()
 {
 	if (m_stream)
 		m_stream->Close();
-	if (m_zstream)
-		delete m_zstream;
-	m_zstream = 0;
 	m_stream = 0;
+	m_Pending.clear();
+	m_PendingCount = 0;
 }
@@ -7,20 +7,76 @@
 #ifndef GORGUECACHEWRITER_H_
 #define GORGUECACHEWRITER_H_
 
+#include "GOrgueCache.h"
+#include "GOrgueHash.h"
+#include "threading/atomic.h"
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
 class wxOutputStream;
 
 class GOrgueCacheWriter {
-	wxOutputStream* m_zstream;
+	typedef struct
+	{
+		std::vector<unsigned char> data;
+		std::vector<unsigned char> compressed;
+		bool ok;
+	} GOrgueCacheWriterBlock;
+
 	wxOutputStream* m_stream;
+	bool m_Compressed;
+	unsigned m_Threads;
+	/* Position inside the uncompressed layout */
+	uint64_t m_Position;
+	/* Position inside the written file */
+	uint64_t m_FilePosition;
+	std::vector<uint64_t> m_Objects;
+	std::vector<GOrgueHashType> m_Hashes;
+	std::set<GOrgueHashType> m_Written;
+	/* Records of the continued cache */
+	std::map<GOrgueHashType, uint64_t> m_Existing;
+	/* Block compressed caches: file offsets of the written blocks and the
+	 * blocks waiting for compression */
+	std::vector<uint64_t> m_Blocks;
+	std::vector<GOrgueCacheWriterBlock> m_Pending;
+	unsigned m_PendingCount;
+
+	bool Align();
+	bool Output(const void* data, unsigned length);
+	bool WriteFile(const void* data, unsigned length);
+	bool FlushBlocks();
+
+	static void CompressBlocks(std::vector<GOrgueCacheWriterBlock>* blocks, unsigned count, atomic_uint* pos);
 
 public:
-	GOrgueCacheWriter(wxOutputStream& stream, bool compressed);
+	/* Blocks of compressed caches are compressed by up to threads threads */
+	GOrgueCacheWriter(wxOutputStream& stream, bool compressed, unsigned threads = 1);
 	virtual ~GOrgueCacheWriter();
 
 	bool WriteHeader();
+	/* Continue an uncompressed cache of size bytes, the stream must be
+	 * positioned at its end. The records of objects are reused by
+	 * KeepObject, the old object table stays unused in the file. */
+	void Append(const std::vector<GOrgueCacheObjectEntry>& objects, uint64_t size);
+	/* True if a record for the object hash has already been written */
+	bool HasObject(const GOrgueHashType& hash);
+	/* Reference the record of the object in the continued cache. Returns
+	 * false if there is none. */
+	bool KeepObject(const GOrgueHashType& hash);
+	/* Start the record of the next cache object */
+	bool BeginObject(const GOrgueHashType& hash);
 	bool Write(const void* data, unsigned length);
 	/* Write an bigger malloced block */
 	bool WriteBlock(const void* data, unsigned length);
+	/* Write the object table after the last object */
+	bool WriteIndex();
+
+	/* Uncompressed size of the data written so far */
+	uint64_t GetSize();
+	/* Size of the file written so far */
+	uint64_t GetFileSize();
 
 	void Close();
 };
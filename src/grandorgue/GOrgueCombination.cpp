@@ -6,6 +6,7 @@
 
 #include "GOrgueCombination.h"
 
+#include "GOSoundEngine.h"
 #include "GOrgueCombinationDefinition.h"
 #include "GOrgueCombinationElement.h"
 #include "GOrgueDrawStop.h"
@@ -131,6 +132,8 @@ bool GOrgueCombination::PushLocal()
 	}
 	else
 	{
+		/* All pipes of the combination change in the same period */
+		GOSoundTransaction transaction(m_OrganFile->GetSoundEngine());
 		for(unsigned i = 0; i < elements.size(); i++)
 		{
 			if (m_State[i] != -1)
@@ -6,6 +6,7 @@
 
 #include "GOrgueDivisional.h"
 
+#include "GOSoundEngine.h"
 #include "GOrgueConfigReader.h"
 #include "GOrgueConfigWriter.h"
 #include "GOrgueDivisionalCoupler.h"
@@ -309,6 +310,8 @@ bool GOrgueDivisional::PushLocal()
 
 void GOrgueDivisional::Push()
 {
+	/* The coupled divisionals are changed in the same period */
+	GOSoundTransaction transaction(m_organfile->GetSoundEngine());
 	PushLocal();
 
 	/* only use divisional couples, if not in setter mode */
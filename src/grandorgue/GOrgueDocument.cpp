@@ -115,6 +115,7 @@ bool GOrgueDocument::ImportCombination(const wxString& cmb)
 {
 	if (!m_organfile)
 		return false;
+	GOMutexLocker locker(m_organfile->GetModelLock());
 	m_organfile->LoadCombination(cmb);
 	m_organfile->Modified();
 	return true;
@@ -201,7 +202,10 @@ void GOrgueDocument::OnMidiEvent(const GOrgueMidiEvent& event)
 		return;
 
 	if (m_organfile)
-		m_organfile->ProcessMidi(event);
+	{
+		GOMutexLocker organ_locker(m_organfile->GetModelLock());
+		m_organfile->ProcessMidiInput(event);
+	}
 }
 
 void GOrgueDocument::ShowOrganDialog()
@@ -121,6 +121,11 @@ void GOrgueEnclosure::HandleKey(int key)
 	}
 }
 
+bool GOrgueEnclosure::GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys)
+{
+	return m_midi.GetMidiKeys(keys);
+}
+
 const wxString& GOrgueEnclosure::GetName()
 {
 	return m_Name;
@@ -0,0 +1,258 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOrgueFileInfoCache.h"
+
+#include "threading/GOMutexLocker.h"
+#include <wx/dir.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/intl.h>
+#include <wx/log.h>
+#include <thread>
+
+GOrgueFileInfoCache::GOrgueFileInfoCache() :
+	m_Lock(),
+	m_Active(false),
+	m_Index(),
+	m_Directories(),
+	m_Pending(),
+	m_Checks(),
+	m_Concurrency(1)
+{
+}
+
+/* Returns false if the snapshot is already active */
+bool GOrgueFileInfoCache::Start(unsigned threads)
+{
+	GOMutexLocker locker(m_Lock);
+	if (m_Active)
+		return false;
+	m_Active = true;
+	m_Concurrency = threads ? threads : 1;
+	return true;
+}
+
+void GOrgueFileInfoCache::Finish()
+{
+	GOMutexLocker locker(m_Lock);
+	m_Active = false;
+	m_Index.clear();
+	m_Directories.clear();
+	m_Pending.clear();
+	m_Checks.clear();
+}
+
+GOrgueFileInfoCache::GOrgueDirectoryInfo* GOrgueFileInfoCache::ListDirectory(const wxString& path)
+{
+	GOrgueDirectoryInfo* dir = new GOrgueDirectoryInfo;
+	dir->path = path;
+	dir->exact = false;
+
+	wxLogNull nolog;
+	wxDir list;
+	if (!wxDir::Exists(path) || !list.Open(path))
+		return dir;
+	wxFileName dir_name(path);
+	dir->exact = dir_name.GetLongPath() == dir_name.GetFullPath();
+	wxString name;
+	for(bool cont = list.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN); cont; cont = list.GetNext(&name))
+	{
+		dir->index[name] = dir->names.size();
+		dir->names.push_back(name);
+	}
+	GOrgueFileEntry entry = { { 0, 0 }, FILE_UNUSED };
+	dir->files.resize(dir->names.size(), entry);
+	return dir;
+}
+
+/* Lists the directory on the first call without holding m_Lock, so
+ * several loader threads may list directories at the same time. Returns
+ * NULL outside of a scope. */
+GOrgueFileInfoCache::GOrgueDirectoryInfo* GOrgueFileInfoCache::GetDirectory(const wxString& path)
+{
+	{
+		GOMutexLocker locker(m_Lock);
+		if (!m_Active)
+			return NULL;
+		GOStringUnsignedMap::iterator it = m_Index.find(path);
+		if (it != m_Index.end())
+			return m_Directories[it->second];
+	}
+
+	GOrgueDirectoryInfo* dir = ListDirectory(path);
+
+	GOMutexLocker locker(m_Lock);
+	GOStringUnsignedMap::iterator it = m_Index.find(path);
+	if (!m_Active || it != m_Index.end())
+	{
+		delete dir;
+		return m_Active ? m_Directories[it->second] : NULL;
+	}
+	m_Index[path] = m_Directories.size();
+	m_Directories.push_back(dir);
+	return dir;
+}
+
+/* Returns the index of the file in the directory or -1, the metadata of a
+ * file is queued for reading on its first use. Only called with m_Lock
+ * held. */
+int GOrgueFileInfoCache::Use(GOrgueDirectoryInfo* dir, const wxString& name)
+{
+	GOStringUnsignedMap::iterator it = dir->index.find(name);
+	if (it == dir->index.end())
+		return -1;
+	GOrgueFileEntry& file = dir->files[it->second];
+	if (file.state == FILE_UNUSED)
+	{
+		GOrguePendingFile pending = { dir, it->second };
+		file.state = FILE_PENDING;
+		m_Pending.push_back(pending);
+	}
+	return it->second;
+}
+
+void GOrgueFileInfoCache::ScanThread(std::vector<GOrguePendingFile>* files, atomic_uint* pos)
+{
+	for(unsigned i = pos->fetch_add(1); i < files->size(); i = pos->fetch_add(1))
+	{
+		GOrgueDirectoryInfo* dir = (*files)[i].dir;
+		GOrgueFileEntry& file = dir->files[(*files)[i].index];
+		wxStructStat st;
+		if (wxStat(dir->path + wxFileName::GetPathSeparator() + dir->names[(*files)[i].index], &st))
+		{
+			file.state = FILE_FAILED;
+			continue;
+		}
+		file.info.size = st.st_size;
+		file.info.time = st.st_mtime;
+		file.state = FILE_READ;
+	}
+}
+
+/* Reads the metadata of all files used so far, only called with m_Lock
+ * held */
+void GOrgueFileInfoCache::Scan()
+{
+	atomic_uint pos(0);
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < m_Concurrency && i < m_Pending.size(); i++)
+		threads.push_back(std::thread(ScanThread, &m_Pending, &pos));
+	ScanThread(&m_Pending, &pos);
+	for(unsigned i = 0; i < threads.size(); i++)
+		threads[i].join();
+	m_Pending.clear();
+}
+
+bool GOrgueFileInfoCache::Exists(const wxFileName& name)
+{
+	GOrgueDirectoryInfo* dir = GetDirectory(name.GetPath());
+	if (!dir)
+		return false;
+	GOMutexLocker locker(m_Lock);
+	return dir->exact && Use(dir, name.GetFullName()) >= 0;
+}
+
+bool GOrgueFileInfoCache::GetInfo(const wxFileName& name, GOrgueFileInfo& info)
+{
+	GOrgueDirectoryInfo* dir = GetDirectory(name.GetPath());
+	if (!dir)
+		return false;
+	GOMutexLocker locker(m_Lock);
+	int index = Use(dir, name.GetFullName());
+	if (index < 0)
+		return false;
+	if (dir->files[index].state == FILE_PENDING)
+		Scan();
+	if (dir->files[index].state != FILE_READ)
+		return false;
+	info = dir->files[index].info;
+	return true;
+}
+
+void GOrgueFileInfoCache::Check(const wxFileName& name, const wxString& file)
+{
+	GOrgueFileCheck check = { name.GetFullPath(), file };
+	{
+		GOMutexLocker locker(m_Lock);
+		if (m_Active)
+		{
+			m_Checks.push_back(check);
+			return;
+		}
+	}
+	DoCheck(check);
+}
+
+void GOrgueFileInfoCache::DoCheck(const GOrgueFileCheck& check)
+{
+	wxFileName path_name(check.path);
+	/* A name, which matches the directory listing exactly, is neither
+	 * missing nor differs in case */
+	if (Exists(path_name))
+		return;
+	if (path_name.GetLongPath() != path_name.GetFullPath())
+	{
+		wxLogWarning(_("Filename '%s' not compatible with case sensitive systems"), check.file.c_str());
+	}
+	if (!wxFileExists(check.path))
+	{
+		wxLogError(_("File '%s' does not exists"), check.file.c_str());
+	}
+}
+
+void GOrgueFileInfoCache::ListThread(std::vector<wxString>* paths, std::vector<GOrgueDirectoryInfo*>* dirs, atomic_uint* pos)
+{
+	for(unsigned i = pos->fetch_add(1); i < paths->size(); i = pos->fetch_add(1))
+		(*dirs)[i] = ListDirectory((*paths)[i]);
+}
+
+/* Lists the directories, which are not known yet, in parallel and runs
+ * the delayed checks. The warnings are reported by the calling thread. */
+void GOrgueFileInfoCache::CheckFiles()
+{
+	std::vector<GOrgueFileCheck> checks;
+	std::vector<wxString> paths;
+	{
+		GOMutexLocker locker(m_Lock);
+		checks.swap(m_Checks);
+		GOStringUnsignedMap seen;
+		for(unsigned i = 0; i < checks.size(); i++)
+		{
+			wxString path = wxFileName(checks[i].path).GetPath();
+			if (m_Index.find(path) != m_Index.end() || seen.find(path) != seen.end())
+				continue;
+			seen[path] = paths.size();
+			paths.push_back(path);
+		}
+	}
+
+	std::vector<GOrgueDirectoryInfo*> dirs(paths.size());
+	atomic_uint pos(0);
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < m_Concurrency && i < paths.size(); i++)
+		threads.push_back(std::thread(ListThread, &paths, &dirs, &pos));
+	ListThread(&paths, &dirs, &pos);
+	for(unsigned i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	{
+		GOMutexLocker locker(m_Lock);
+		for(unsigned i = 0; i < dirs.size(); i++)
+		{
+			if (!m_Active || m_Index.find(paths[i]) != m_Index.end())
+			{
+				delete dirs[i];
+				continue;
+			}
+			m_Index[paths[i]] = m_Directories.size();
+			m_Directories.push_back(dirs[i]);
+		}
+	}
+
+	for(unsigned i = 0; i < checks.size(); i++)
+		DoCheck(checks[i]);
+}
@@ -0,0 +1,135 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GORGUEFILEINFOCACHE_H
+#define GORGUEFILEINFOCACHE_H
+
+#include "ptrvector.h"
+#include "threading/GOMutex.h"
+#include "threading/atomic.h"
+#include <wx/hashmap.h>
+#include <wx/string.h>
+#include <stdint.h>
+#include <vector>
+
+class wxFileName;
+
+typedef struct
+{
+	uint64_t size;
+	uint64_t time;
+} GOrgueFileInfo;
+
+/* Snapshot of the metadata of the sample files during one load or cache
+ * update. It is only filled while a GOrgueFileInfoScope is active and
+ * dropped at its end, so later requests always read the file system.
+ *
+ * A directory is listed once, when the first file in it is looked up, so
+ * resolving the sample names does not need a stat per file. The checks of
+ * the names found while parsing are collected by Check, CheckFiles lists
+ * their directories on several threads in parallel. The size and
+ * modification time for the cache hash are read only for the files which
+ * have been looked up, once each, by several threads in parallel. */
+class GOrgueFileInfoCache
+{
+	WX_DECLARE_STRING_HASH_MAP(unsigned, GOStringUnsignedMap);
+
+	typedef enum
+	{
+		FILE_UNUSED,
+		FILE_PENDING,
+		FILE_READ,
+		FILE_FAILED
+	} GOrgueFileState;
+
+	typedef struct
+	{
+		GOrgueFileInfo info;
+		GOrgueFileState state;
+	} GOrgueFileEntry;
+
+	typedef struct
+	{
+		wxString path;
+		GOStringUnsignedMap index;
+		std::vector<wxString> names;
+		std::vector<GOrgueFileEntry> files;
+		/* The path matches the case of the file system */
+		bool exact;
+	} GOrgueDirectoryInfo;
+
+	typedef struct
+	{
+		GOrgueDirectoryInfo* dir;
+		unsigned index;
+	} GOrguePendingFile;
+
+	typedef struct
+	{
+		wxString path;
+		wxString file;
+	} GOrgueFileCheck;
+
+private:
+	GOMutex m_Lock;
+	bool m_Active;
+	GOStringUnsignedMap m_Index;
+	ptr_vector<GOrgueDirectoryInfo> m_Directories;
+	std::vector<GOrguePendingFile> m_Pending;
+	std::vector<GOrgueFileCheck> m_Checks;
+	unsigned m_Concurrency;
+
+	static GOrgueDirectoryInfo* ListDirectory(const wxString& path);
+	static void ListThread(std::vector<wxString>* paths, std::vector<GOrgueDirectoryInfo*>* dirs, atomic_uint* pos);
+	void DoCheck(const GOrgueFileCheck& check);
+	GOrgueDirectoryInfo* GetDirectory(const wxString& path);
+	int Use(GOrgueDirectoryInfo* dir, const wxString& name);
+	void Scan();
+	static void ScanThread(std::vector<GOrguePendingFile>* files, atomic_uint* pos);
+
+public:
+	GOrgueFileInfoCache();
+
+	/* Only called by GOrgueFileInfoScope */
+	bool Start(unsigned threads);
+	void Finish();
+
+	/* Returns false if the directory does not contain a file with exactly
+	 * this name */
+	bool Exists(const wxFileName& name);
+	bool GetInfo(const wxFileName& name, GOrgueFileInfo& info);
+
+	/* Warns if the file of the ODF name file is missing or differs in
+	 * case. Inside a scope, the check is delayed until CheckFiles. */
+	void Check(const wxFileName& name, const wxString& file);
+	void CheckFiles();
+};
+
+/* Keeps the snapshot for its lifetime, unless an outer scope already does */
+class GOrgueFileInfoScope
+{
+private:
+	GOrgueFileInfoCache& m_Cache;
+	bool m_Started;
+
+public:
+	GOrgueFileInfoScope(GOrgueFileInfoCache& cache, unsigned threads) :
+		m_Cache(cache),
+		m_Started(cache.Start(threads))
+	{
+	}
+
+	~GOrgueFileInfoScope()
+	{
+		if (m_Started)
+			m_Cache.Finish();
+	}
+
+	GOrgueFileInfoScope(const GOrgueFileInfoScope&) = delete;
+	GOrgueFileInfoScope& operator=(const GOrgueFileInfoScope&) = delete;
+};
+
+#endif
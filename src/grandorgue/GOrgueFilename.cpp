@@ -7,6 +7,7 @@
 #include "GOrgueFilename.h"
 
 #include "GOrgueArchive.h"
+#include "GOrgueFileInfoCache.h"
 #include "GOrgueHash.h"
 #include "GOrgueInvalidFile.h"
 #include "GOrgueSettings.h"
@@ -19,6 +20,7 @@ GOrgueFilename::GOrgueFilename() :
 	m_Name(),
 	m_Path(),
 	m_Archiv(NULL),
+	m_FileInfo(NULL),
 	m_Hash(true)
 {
 }
@@ -40,6 +42,17 @@ void GOrgueFilename::Hash(GOrgueHash& hash) const
 	wxFileName path_name(m_Path);
 	if (!m_Hash)
 		return;
+	GOrgueFileInfo info;
+	path_name.Normalize(wxPATH_NORM_DOTS);
+	if (m_FileInfo && m_FileInfo->GetInfo(path_name, info))
+	{
+		hash.Update(info.time);
+		hash.Update(info.size);
+		return;
+	}
+	/* A missing file is only hashed by its name */
+	if (!path_name.FileExists())
+		return;
 	uint64_t size = path_name.GetSize().GetValue();
 	uint64_t time = path_name.GetModificationTime().GetTicks();
 	hash.Update(time);
@@ -57,24 +70,22 @@ std::unique_ptr<GOrgueFile> GOrgueFilename::Open() const
 		return (std::unique_ptr<GOrgueFile>)new GOrgueInvalidFile(m_Name);
 }
 
-void GOrgueFilename::SetPath(const wxString& base, const wxString& file)
+bool GOrgueFilename::operator==(const GOrgueFilename& other) const
+{
+	return m_Archiv == other.m_Archiv && m_Name == other.m_Name && m_Path == other.m_Path;
+}
+
+void GOrgueFilename::SetPath(const wxString& base, const wxString& file, GrandOrgueFile* organfile)
 {
 	wxString temp = file;
 	temp.Replace(wxT("\\"), wxString(wxFileName::GetPathSeparator()));
 	temp = base + wxFileName::GetPathSeparator() + temp;
+	m_Path = temp;
+	m_FileInfo = &organfile->GetFileInfo();
 
 	wxFileName path_name(temp);
 	path_name.Normalize(wxPATH_NORM_DOTS);
-	if (path_name.GetLongPath() != path_name.GetFullPath())
-	{
-		wxLogWarning(_("Filename '%s' not compatible with case sensitive systems"), file.c_str());
-	}
-	if (!wxFileExists(temp))
-	{
-		wxLogError(_("File '%s' does not exists"), file.c_str());
-		m_Hash = false;
-	}
-	m_Path = temp;
+	m_FileInfo->Check(path_name, file);
 }
 
 void GOrgueFilename::Assign(const wxString& name, GrandOrgueFile* organfile)
@@ -94,14 +105,14 @@ void GOrgueFilename::Assign(const wxString& name, GrandOrgueFile* organfile)
 		}
 		return;
 	}
-	SetPath(organfile->GetODFPath(), name);
+	SetPath(organfile->GetODFPath(), name, organfile);
 }
 
 void GOrgueFilename::AssignResource(const wxString& name, GrandOrgueFile* organfile)
 {
 	m_Name = name;
 	m_Hash = false;
-	SetPath(organfile->GetSettings().GetResourceDirectory(), name);
+	SetPath(organfile->GetSettings().GetResourceDirectory(), name, organfile);
 }
 
 void GOrgueFilename::AssignAbsolute(const wxString& path)
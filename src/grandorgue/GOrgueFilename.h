@@ -12,6 +12,7 @@
 
 class GOrgueArchive;
 class GOrgueFile;
+class GOrgueFileInfoCache;
 class GOrgueHash;
 class GrandOrgueFile;
 
@@ -21,9 +22,10 @@ private:
 	wxString m_Name;
 	wxString m_Path;
 	GOrgueArchive* m_Archiv;
+	GOrgueFileInfoCache* m_FileInfo;
 	bool m_Hash;
 
-	void SetPath(const wxString& base, const wxString& path);
+	void SetPath(const wxString& base, const wxString& path, GrandOrgueFile* organfile);
 	
 public:
 	GOrgueFilename();
@@ -36,6 +38,8 @@ public:
 	void Hash(GOrgueHash& hash) const;
 
 	std::unique_ptr<GOrgueFile> Open() const;
+
+	bool operator==(const GOrgueFilename& other) const;
 };
 
 #endif
@@ -45,7 +45,7 @@ GOrgueManual::GOrgueManual(GrandOrgueFile* organfile) :
 	m_DivisionalTemplate(organfile)
 {
 	m_InputCouplers.push_back(NULL);
-	m_organfile->RegisterEventHandler(this);
+	m_organfile->RegisterEventHandler(this, true);
 	m_organfile->RegisterMidiConfigurator(this);
 	m_organfile->RegisterPlaybackStateHandler(this);
 }
@@ -478,6 +478,11 @@ void GOrgueManual::HandleKey(int key)
 {
 }
 
+bool GOrgueManual::GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys)
+{
+	return m_midi.GetMidiKeys(keys);
+}
+
 void GOrgueManual::Reset()
 {
 	for (unsigned j = 0; j < GetCouplerCount(); j++)
@@ -71,6 +71,7 @@ private:
 
 	void ProcessMidi(const GOrgueMidiEvent& event);
 	void HandleKey(int key);
+	bool GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys);
 	void SetOutput(unsigned note, unsigned velocity);
 
 	void Save(GOrgueConfigWriter& cfg);
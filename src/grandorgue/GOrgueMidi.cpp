@@ -12,6 +12,8 @@
 #include "GOrgueMidiRtOutPort.h"
 #include "GOrgueMidiWXEvent.h"
 #include "GOrgueSettings.h"
+#include "threading/GOMutexLocker.h"
+#include <wx/log.h>
 
 BEGIN_EVENT_TABLE(GOrgueMidi, wxEvtHandler)
 	EVT_MIDI(GOrgueMidi::OnMidiEvent)
@@ -21,8 +23,13 @@ GOrgueMidi::GOrgueMidi(GOrgueSettings& settings) :
 	m_Settings(settings),
 	m_midi_in_devices(),
 	m_midi_out_devices(),
-	m_Listeners()
+	m_Listeners(),
+	m_DirectListeners(),
+	m_ListenerLock(),
+	m_Queue(),
+	m_Thread(*this)
 {
+	m_Thread.Run();
 }
 
 void GOrgueMidi::UpdateDevices()
@@ -34,6 +41,7 @@ void GOrgueMidi::UpdateDevices()
 
 GOrgueMidi::~GOrgueMidi()
 {
+	m_Thread.Delete();
 	m_midi_in_devices.clear();
 	m_midi_out_devices.clear();
 }
@@ -86,10 +94,34 @@ bool GOrgueMidi::HasActiveDevice()
 	return false;
 }
 
+/* Called by the MIDI drivers. The event is only queued here, so a driver
+ * callback never waits for the organ or the GUI. */
 void GOrgueMidi::Recv(const GOrgueMidiEvent& e)
 {
+	if (!m_Queue.Push(e))
+	{
+		wxLogWarning(_("MIDI input queue overflow, event dropped"));
+		return;
+	}
+	m_Thread.Wakeup();
+}
+
+/* Runs on the MIDI thread: the direct listeners (the organ) see the event
+ * at once, the GUI listeners receive it through the wx event loop */
+bool GOrgueMidi::ProcessEvent()
+{
+	GOrgueMidiEvent e;
+	if (!m_Queue.Pop(e))
+		return false;
+	{
+		GOMutexLocker lock(m_ListenerLock);
+		for(unsigned i = 0; i < m_DirectListeners.size(); i++)
+			if (m_DirectListeners[i])
+				m_DirectListeners[i]->Send(e);
+	}
 	wxMidiEvent event(e);
 	AddPendingEvent(event);
+	return true;
 }
 
 void GOrgueMidi::OnMidiEvent(wxMidiEvent& event)
@@ -106,30 +138,50 @@ void GOrgueMidi::Send(const GOrgueMidiEvent& e)
 		m_midi_out_devices[j]->Send(e);
 }
 
-void GOrgueMidi::Register(GOrgueMidiListener* listener)
+static void AddListener(std::vector<GOrgueMidiListener*>& listeners, GOrgueMidiListener* listener)
 {
-	if (!listener)
-		return;
-	for(unsigned i = 0; i < m_Listeners.size(); i++)
-		if (m_Listeners[i] == listener)
+	for(unsigned i = 0; i < listeners.size(); i++)
+		if (listeners[i] == listener)
 			return;
-	for(unsigned i = 0; i < m_Listeners.size(); i++)
-		if (!m_Listeners[i])
+	for(unsigned i = 0; i < listeners.size(); i++)
+		if (!listeners[i])
 		{
-			m_Listeners[i] = listener;
+			listeners[i] = listener;
 			return;
 		}
-	m_Listeners.push_back(listener);
+	listeners.push_back(listener);
 }
 
-void GOrgueMidi::Unregister(GOrgueMidiListener* listener)
+/* Only the direct listeners are shared with the MIDI thread, so the GUI
+ * listeners never wait for a running dispatch */
+void GOrgueMidi::Register(GOrgueMidiListener* listener, bool direct)
 {
-	for(unsigned i = 0; i < m_Listeners.size(); i++)
-		if (m_Listeners[i] == listener)
-		{
-			m_Listeners[i] = NULL;
-		}
+	if (!listener)
+		return;
+	if (direct)
+	{
+		GOMutexLocker lock(m_ListenerLock);
+		AddListener(m_DirectListeners, listener);
+	}
+	else
+		AddListener(m_Listeners, listener);
+}
 
+/* Removing a direct listener waits for a running dispatch, so it is never
+ * called after it has been removed */
+void GOrgueMidi::Unregister(GOrgueMidiListener* listener, bool direct)
+{
+	if (!direct)
+	{
+		for(unsigned i = 0; i < m_Listeners.size(); i++)
+			if (m_Listeners[i] == listener)
+				m_Listeners[i] = NULL;
+		return;
+	}
+	GOMutexLocker lock(m_ListenerLock);
+	for(unsigned i = 0; i < m_DirectListeners.size(); i++)
+		if (m_DirectListeners[i] == listener)
+			m_DirectListeners[i] = NULL;
 }
 
 GOrgueMidiMap& GOrgueMidi::GetMidiMap()
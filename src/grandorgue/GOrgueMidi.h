@@ -7,11 +7,14 @@
 #ifndef GORGUEMIDI_H
 #define GORGUEMIDI_H
 
+#include "GOrgueMidiEvent.h"
 #include "GOrgueMidiRtFactory.h"
+#include "GOrgueMidiThread.h"
 #include "ptrvector.h"
+#include "threading/GOMpscQueue.h"
+#include "threading/GOMutex.h"
 #include <wx/event.h>
 
-class GOrgueMidiEvent;
 class GOrgueMidiInPort;
 class GOrgueMidiListener;
 class GOrgueMidiMap;
@@ -28,6 +31,10 @@ private:
 	ptr_vector<GOrgueMidiOutPort> m_midi_out_devices;
 	int m_transpose;
 	std::vector<GOrgueMidiListener*> m_Listeners;
+	std::vector<GOrgueMidiListener*> m_DirectListeners;
+	GOMutex m_ListenerLock;
+	GOMpscQueue<GOrgueMidiEvent, 1024> m_Queue;
+	GOrgueMidiThread m_Thread;
 	GOrgueMidiRtFactory m_MidiFactory;
 	void OnMidiEvent(wxMidiEvent& event);
 
@@ -40,6 +47,7 @@ public:
 	void UpdateDevices();
 
 	void Recv(const GOrgueMidiEvent& e);
+	bool ProcessEvent();
 	void Send(const GOrgueMidiEvent& e);
 
 	std::vector<wxString> GetInDevices();
@@ -47,8 +55,8 @@ public:
 	bool HasActiveDevice();
 	int GetTranspose();
 	void SetTranspose(int transpose);
-	void Register(GOrgueMidiListener* listener);
-	void Unregister(GOrgueMidiListener* listener);
+	void Register(GOrgueMidiListener* listener, bool direct = false);
+	void Unregister(GOrgueMidiListener* listener, bool direct = false);
 
 	GOrgueMidiMap& GetMidiMap();
 
@@ -12,7 +12,8 @@
 
 GOrgueMidiListener::GOrgueMidiListener() :
 	m_Callback(NULL),
-	m_midi(NULL)
+	m_midi(NULL),
+	m_Direct(false)
 {
 }
 
@@ -21,25 +22,37 @@ GOrgueMidiListener::~GOrgueMidiListener()
 	Unregister();
 }
 
+/* A direct listener is called from the MIDI thread, so it is detached
+ * while the callback changes */
 void GOrgueMidiListener::SetCallback(GOrgueMidiCallback* callback)
 {
+	if (!m_midi || !m_Direct)
+	{
+		m_Callback = callback;
+		return;
+	}
+	m_midi->Unregister(this, true);
 	m_Callback = callback;
+	m_midi->Register(this, true);
 }
 
-void GOrgueMidiListener::Register(GOrgueMidi* midi)
+/* Direct listeners receive the events on the MIDI thread, the others on
+ * the GUI thread */
+void GOrgueMidiListener::Register(GOrgueMidi* midi, bool direct)
 {
 	Unregister();
 	if (midi)
 	{
 		m_midi = midi;
-		m_midi->Register(this);
+		m_Direct = direct;
+		m_midi->Register(this, direct);
 	}
 }
 
 void GOrgueMidiListener::Unregister()
 {
 	if (m_midi)
-		m_midi->Unregister(this);
+		m_midi->Unregister(this, m_Direct);
 	m_midi = NULL;
 }
 
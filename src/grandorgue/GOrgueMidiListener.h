@@ -15,13 +15,14 @@ class GOrgueMidiListener
 {
 	GOrgueMidiCallback* m_Callback;
 	GOrgueMidi* m_midi;
+	bool m_Direct;
 
 public:
 	GOrgueMidiListener();
 	virtual ~GOrgueMidiListener();
 
 	void SetCallback(GOrgueMidiCallback* callback);
-	void Register(GOrgueMidi* midi);
+	void Register(GOrgueMidi* midi, bool direct = false);
 	void Unregister();
 
 	void Send(const GOrgueMidiEvent& event);
@@ -13,6 +13,7 @@
 #include "GOrgueSetterButton.h"
 #include "GOrgueSettings.h"
 #include "GrandOrgueFile.h"
+#include "threading/GOMutexLocker.h"
 #include <wx/intl.h>
 
 enum {
@@ -87,25 +88,31 @@ void GOrgueMidiPlayer::Clear()
 }
 
 void GOrgueMidiPlayer::LoadFile(const wxString& filename, unsigned manuals, bool pedal)
+{
+	wxString error;
+	{
+		/* The content is played from the organ timer */
+		GOMutexLocker locker(m_organfile->GetModelLock());
+		error = DoLoadFile(filename, manuals, pedal);
+	}
+	if (!error.IsEmpty())
+		GOMessageBox(error, _("MIDI Player"), wxOK | wxICON_ERROR, NULL);
+}
+
+wxString GOrgueMidiPlayer::DoLoadFile(const wxString& filename, unsigned manuals, bool pedal)
 {
 	Clear();
 	GOrgueMidiFileReader reader(m_organfile->GetSettings().GetMidiMap());
 	if (!reader.Open(filename))
-	{
-		GOMessageBox(wxString::Format(_("Failed to load %s"), filename.c_str()), _("MIDI Player"), wxOK | wxICON_ERROR, NULL);
-		return;
-	}
+		return wxString::Format(_("Failed to load %s"), filename.c_str());
 	if (!m_content.Load(reader, m_organfile->GetSettings().GetMidiMap(), manuals, pedal))
 	{
 		m_content.Clear();
-		GOMessageBox(wxString::Format(_("Failed to load %s"), filename.c_str()), _("MIDI Player"), wxOK | wxICON_ERROR, NULL);
-		return;
+		return wxString::Format(_("Failed to load %s"), filename.c_str());
 	}
 	if (!reader.Close())
-	{
-		GOMessageBox(wxString::Format(_("Failed to decode %s"), filename.c_str()), _("MIDI Player"), wxOK | wxICON_ERROR, NULL);
-		return;
-	}
+		return wxString::Format(_("Failed to decode %s"), filename.c_str());
+	return wxEmptyString;
 }
 
 bool GOrgueMidiPlayer::IsLoaded()
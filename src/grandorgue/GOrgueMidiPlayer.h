@@ -40,6 +40,7 @@ private:
 
 	void UpdateDisplay();
 	void HandleTimer();
+	wxString DoLoadFile(const wxString& filename, unsigned manuals, bool pedal);
 
 public:
 	GOrgueMidiPlayer(GrandOrgueFile* organfile);
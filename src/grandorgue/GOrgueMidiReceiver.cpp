@@ -11,6 +11,7 @@
 #include "GOrgueManual.h"
 #include "GOrgueSettings.h"
 #include "GrandOrgueFile.h"
+#include "threading/GOMutexLocker.h"
 
 GOrgueMidiReceiver::GOrgueMidiReceiver(GrandOrgueFile* organfile, MIDI_RECEIVER_TYPE type):
 	GOrgueMidiReceiverBase(type),
@@ -73,9 +74,17 @@ int GOrgueMidiReceiver::GetTranspose()
 	return m_organfile->GetSettings().Transpose();
 }
 
+/* The manual receivers are matched on the MIDI thread, so they change
+ * under the organ model lock, together with the MIDI index */
 void GOrgueMidiReceiver::Assign(const GOrgueMidiReceiverData& data)
 {
+	if (!m_organfile)
+	{
+		GOrgueMidiReceiverBase::Assign(data);
+		return;
+	}
+	GOMutexLocker locker(m_organfile->GetModelLock());
 	GOrgueMidiReceiverBase::Assign(data);
-	if (m_organfile)
-		m_organfile->Modified();
+	m_organfile->UpdateMidiIndex();
+	m_organfile->Modified();
 }
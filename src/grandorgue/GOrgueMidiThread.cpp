@@ -0,0 +1,53 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GOrgueMidiThread.h"
+
+#include "GOrgueMidi.h"
+
+GOrgueMidiThread::GOrgueMidiThread(GOrgueMidi& midi) :
+	GOrgueThread(),
+	m_midi(midi),
+	m_Wait(),
+	m_Sleeping(0)
+{
+}
+
+void GOrgueMidiThread::Entry()
+{
+	while(!ShouldStop())
+	{
+		if (m_midi.ProcessEvent())
+			continue;
+		m_Sleeping = 1;
+		if (m_midi.ProcessEvent())
+		{
+			m_Sleeping = 0;
+			continue;
+		}
+		m_Wait.Wait(true);
+		m_Sleeping = 0;
+	}
+}
+
+void GOrgueMidiThread::Run()
+{
+	Start();
+}
+
+void GOrgueMidiThread::Delete()
+{
+	MarkForStop();
+	m_Wait.Wakeup();
+	Wait();
+}
+
+/* Called by the MIDI drivers after queuing an event */
+void GOrgueMidiThread::Wakeup()
+{
+	if (m_Sleeping.exchange(0))
+		m_Wait.Wakeup();
+}
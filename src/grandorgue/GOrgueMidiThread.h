@@ -0,0 +1,34 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GORGUEMIDITHREAD_H
+#define GORGUEMIDITHREAD_H
+
+#include "threading/atomic.h"
+#include "threading/GOWaitQueue.h"
+#include "threading/GOrgueThread.h"
+
+class GOrgueMidi;
+
+/* Processes the received MIDI events outside of the GUI thread */
+class GOrgueMidiThread : public GOrgueThread
+{
+private:
+	GOrgueMidi& m_midi;
+	GOWaitQueue m_Wait;
+	atomic_uint m_Sleeping;
+
+	void Entry();
+
+public:
+	GOrgueMidiThread(GOrgueMidi& midi);
+
+	void Run();
+	void Delete();
+	void Wakeup();
+};
+
+#endif
@@ -6,6 +6,7 @@
 
 #include "GOrguePipeConfigNode.h"
 
+#include "GOSoundCompress.h"
 #include "GOrgueSampleStatistic.h"
 #include "GOrgueStatisticCallback.h"
 #include "GOrgueSettings.h"
@@ -130,14 +131,14 @@ unsigned GOrguePipeConfigNode::GetEffectiveBitsPerSample()
 		return m_organfile->GetSettings().BitsPerSample();
 }
 
-bool GOrguePipeConfigNode::GetEffectiveCompress()
+unsigned GOrguePipeConfigNode::GetEffectiveCompress()
 {
 	if (m_PipeConfig.GetCompress() != -1)
-		return m_PipeConfig.GetCompress() ? true : false;
+		return m_PipeConfig.GetCompress();
 	if (m_parent)
 		return m_parent->GetEffectiveCompress();
 	else
-		return m_organfile->GetSettings().LosslessCompression();
+		return m_organfile->GetSettings().LosslessCompression() ? GO_COMPRESSION_PREDICTIVE : GO_COMPRESSION_NONE;
 }
 
 unsigned GOrguePipeConfigNode::GetEffectiveLoopLoad()
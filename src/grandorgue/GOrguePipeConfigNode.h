@@ -48,7 +48,7 @@ public:
 	wxString GetEffectiveAudioGroup();
 
 	unsigned GetEffectiveBitsPerSample();
-	bool GetEffectiveCompress();
+	unsigned GetEffectiveCompress();
 	unsigned GetEffectiveLoopLoad();
 	unsigned GetEffectiveAttackLoad();
 	unsigned GetEffectiveReleaseLoad();
@@ -26,8 +26,9 @@
 
 #define DLG_MAX_VALUE 0x10000
 
-GOrgueProgressDialog::GOrgueProgressDialog() :
+GOrgueProgressDialog::GOrgueProgressDialog(bool visible) :
 	m_dlg(NULL),
+	m_Visible(visible),
 	m_last(0),
 	m_const(0),
 	m_value(0),
@@ -45,7 +46,9 @@ void GOrgueProgressDialog::Setup(long max, const wxString& title, const wxString
 {
 	if (m_dlg)
 		m_dlg->Destroy();
-	m_dlg = new wxProgressDialog(title, msg, DLG_MAX_VALUE, NULL, wxPD_CAN_ABORT | wxPD_APP_MODAL | wxPD_ELAPSED_TIME | wxPD_ESTIMATED_TIME | wxPD_REMAINING_TIME);
+	m_dlg = NULL;
+	if (m_Visible)
+		m_dlg = new wxProgressDialog(title, msg, DLG_MAX_VALUE, NULL, wxPD_CAN_ABORT | wxPD_APP_MODAL | wxPD_ELAPSED_TIME | wxPD_ESTIMATED_TIME | wxPD_REMAINING_TIME);
 	m_last = 0;
 	m_const = 0;
 	m_value = 0;
@@ -30,13 +30,14 @@ class GOrgueProgressDialog
 {
 private:
 	wxProgressDialog* m_dlg;
+	bool m_Visible;
 	long m_last;
 	long m_const;
 	long m_value;
 	long m_max;
 
 public:
-	GOrgueProgressDialog();
+	GOrgueProgressDialog(bool visible = true);
 	~GOrgueProgressDialog();
 
 	void Setup(long max, const wxString& title, const wxString& msg = wxEmptyString);
@@ -113,6 +113,22 @@ GOrgueProperties::GOrgueProperties(GrandOrgueFile* organfile, wxWindow* win) :
 	size = m_organfile->GetMemoryPool().GetPoolSize() / (1024.0 * 1024.0);
 	sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("%.3f MB of %.3f MB"), size1, size)), 0, wxTOP, 5);
 
+	sizer->Add(GOrguePropertiesText(this, 0,  _("Load time")), 0, wxTOP, 5);
+	long first_note = m_organfile->GetMemoryPool().GetTimeToFirstNote();
+	long resident = m_organfile->GetMemoryPool().GetTimeToResident();
+	if (first_note >= 0)
+		sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("Playable after %.3f s"), first_note / 1000.0)), 0, wxTOP, 5);
+	if (resident >= 0)
+		sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("Fully in memory after %.3f s"), resident / 1000.0)), 0, wxTOP, 5);
+	else if (first_note >= 0)
+		sizer->Add(GOrguePropertiesText(this, 0,  _("Cache is still being read into memory")), 0, wxTOP, 5);
+	if (!m_organfile->GetMemoryPool().IsCacheResident())
+		sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("Streamed from the cache, %u late chunks"), m_organfile->GetStreamUnderruns())), 0, wxTOP, 5);
+	if (m_organfile->GetStolenSamplers() || m_organfile->GetDroppedSamplers())
+		sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("Polyphony limit: %u releases stolen, %u samplers dropped"), m_organfile->GetStolenSamplers(), m_organfile->GetDroppedSamplers())), 0, wxTOP, 5);
+	if (m_organfile->GetTransactionSize())
+		sizer->Add(GOrguePropertiesText(this, 0,  wxString::Format(_("Last registration change: %u pipe changes applied in %u us"), m_organfile->GetTransactionSize(), m_organfile->GetTransactionTime())), 0, wxTOP, 5);
+
 	sizer->Add(GOrguePropertiesText(this, 0,  _("ODF Path")), 0, wxTOP, 5);
 	sizer->Add(GOrguePropertiesText(this, 300, m_organfile->GetOrganPathInfo()), 0, wxLEFT, 10);
 
@@ -68,6 +68,10 @@ void GOrgueReferencePipe::LoadData()
 {
 }
 
+void GOrgueReferencePipe::FreeData()
+{
+}
+
 const wxString& GOrgueReferencePipe::GetLoadTitle()
 {
 	return m_Filename;
@@ -413,7 +413,8 @@ void GOrgueSetter::ButtonChanged(int id)
 		Next();
 		break;
 	case ID_SETTER_SET:
-		wxTheApp->GetTopWindow()->UpdateWindowUI();
+		if (wxTheApp->GetTopWindow())
+			wxTheApp->GetTopWindow()->UpdateWindowUI();
 		break;
 	case ID_SETTER_M1:
 		SetPosition(m_pos - 1, false);
@@ -618,7 +619,8 @@ void GOrgueSetter::PreparePlayback()
 
 	wxCommandEvent event(wxEVT_SETVALUE, ID_METER_FRAME_SPIN);
 	event.SetInt(m_pos);
-	wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
+	if (wxTheApp->GetTopWindow())
+		wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
 
 	buffer.Printf(wxT("%d"), m_crescendopos + 1);
 	m_CrescendoDisplay.SetContent(buffer);
@@ -744,7 +746,8 @@ void GOrgueSetter::SetPosition(int pos, bool push)
 	{
 		wxCommandEvent event(wxEVT_SETVALUE, ID_METER_FRAME_SPIN);
 		event.SetInt(m_pos);
-		wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
+		if (wxTheApp->GetTopWindow())
+			wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
 	}
 
 }
@@ -793,7 +796,8 @@ void GOrgueSetter::SetTranspose(int value)
 	{
 		wxCommandEvent event(wxEVT_SETVALUE, ID_METER_TRANSPOSE_SPIN);
 		event.SetInt(value);
-		wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
+		if (wxTheApp->GetTopWindow())
+			wxTheApp->GetTopWindow()->GetEventHandler()->AddPendingEvent(event);
 	}
 	m_organfile->GetSettings().Transpose(value);
 	m_organfile->AllNotesOff();
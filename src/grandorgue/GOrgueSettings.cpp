@@ -100,6 +100,7 @@ GOrgueSettings::GOrgueSettings(wxString instance) :
 	ReleaseLoad(this, wxT("General"), wxT("ReleaseLoad"), 0, 1, 1),
 	ManageCache(this, wxT("General"), wxT("ManageCache"), true),
 	CompressCache(this, wxT("General"), wxT("CompressCache"), false),
+	DiskStreaming(this, wxT("General"), wxT("DiskStreaming"), false),
 	LoadLastFile(this, wxT("General"), wxT("LoadLastFile"), m_InitialLoadTypes, sizeof(m_InitialLoadTypes) / sizeof(m_InitialLoadTypes[0]), GOInitialLoadType::LOAD_LAST_USED),
 	ODFCheck(this, wxT("General"), wxT("StrictODFCheck"), false),
 	LoadChannels(this, wxT("General"), wxT("Channels"), 0, 2, 2),
@@ -117,6 +118,7 @@ GOrgueSettings::GOrgueSettings(wxString instance) :
 	ReverbFile(this, wxT("Reverb"), wxT("ReverbFile"), wxEmptyString),
 	MemoryLimit(this, wxT("General"), wxT("MemoryLimit"), 0, 1024 * 1024, GOrgueMemoryPool::GetSystemMemoryLimit()),
 	SamplesPerBuffer(this, wxT("General"), wxT("SamplesPerBuffer"), 1, MAX_FRAME_SIZE, 1024),
+	PrerenderPeriods(this, wxT("General"), wxT("PrerenderPeriods"), 0, MAX_PRERENDER_PERIODS, 0),
 	SampleRate(this, wxT("General"), wxT("SampleRate"), 1000, 100000, 44100),
 	Volume(this, wxT("General"), wxT("Volume"), -120, 20, -15),
 	PolyphonyLimit(this, wxT("General"), wxT("PolyphonyLimit"), 0, MAX_POLYPHONY, 2048),
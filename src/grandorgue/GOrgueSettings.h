@@ -102,6 +102,7 @@ public:
 
 	GOrgueSettingBool ManageCache;
 	GOrgueSettingBool CompressCache;
+	GOrgueSettingBool DiskStreaming;
 	GOrgueSettingEnum<GOInitialLoadType> LoadLastFile;
 	GOrgueSettingBool ODFCheck;
 
@@ -121,6 +122,7 @@ public:
 
 	GOrgueSettingFloat MemoryLimit;
 	GOrgueSettingUnsigned SamplesPerBuffer;
+	GOrgueSettingUnsigned PrerenderPeriods;
 	GOrgueSettingUnsigned SampleRate;
 	GOrgueSettingInteger Volume;
 	GOrgueSettingUnsigned PolyphonyLimit;
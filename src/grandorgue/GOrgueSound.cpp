@@ -7,6 +7,7 @@
 #include "GOrgueSound.h"
 
 #include "GOSoundDefs.h"
+#include "GOSoundPrerenderThread.h"
 #include "GOSoundThread.h"
 #include "GOrgueEvent.h"
 #include "GOrgueMidi.h"
@@ -17,7 +18,10 @@
 #include "threading/GOMutexLocker.h"
 #include <wx/app.h>
 #include <wx/intl.h>
+#include <wx/stopwatch.h>
 #include <wx/window.h>
+#include <algorithm>
+#include <string.h>
 
 GOrgueSound::GOrgueSound(GOrgueSettings& settings) :
 	logSoundErrors(true),
@@ -25,6 +29,9 @@ GOrgueSound::GOrgueSound(GOrgueSettings& settings) :
 	m_WaitCount(),
 	m_CalcCount(),
 	m_SamplesPerBuffer(0),
+	m_PrerenderPeriods(0),
+	m_RenderedPeriods(0),
+	m_PrerenderThread(NULL),
 	meter_counter(0),
 	m_defaultAudioDevice(),
 	m_organfile(0),
@@ -47,9 +54,9 @@ void GOrgueSound::StartThreads()
 
 	unsigned n_cpus = m_Settings.Concurrency();
 
-	GOMutexLocker thread_locker(m_thread_lock);
+	GetEngine().GetScheduler().SetThreadCount(n_cpus);
 	for(unsigned i = 0; i < n_cpus; i++)
-		m_Threads.push_back(new GOSoundThread(&GetEngine().GetScheduler()));
+		m_Threads.push_back(new GOSoundThread(&GetEngine().GetScheduler(), i));
 
 	for(unsigned i = 0; i < m_Threads.size(); i++)
 		m_Threads[i]->Run();
@@ -60,7 +67,6 @@ void GOrgueSound::StopThreads()
 	for(unsigned i = 0; i < m_Threads.size(); i++)
 		m_Threads[i]->Delete();
 
-	GOMutexLocker thread_locker(m_thread_lock);
 	m_Threads.resize(0);
 }
 
@@ -108,6 +114,9 @@ bool GOrgueSound::OpenSound()
 		}
 	}
 	m_SamplesPerBuffer = m_Settings.SamplesPerBuffer();
+	m_PrerenderPeriods = m_Settings.PrerenderPeriods();
+	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
+		m_AudioOutputs[i].ring.resize(m_PrerenderPeriods * m_SamplesPerBuffer * audio_config[i].channels);
 	m_SoundEngine.SetSamplesPerBuffer(m_SamplesPerBuffer);
 	m_SoundEngine.SetPolyphonyLimiting(m_Settings.ManagePolyphony());
 	m_SoundEngine.SetHardPolyphony(m_Settings.PolyphonyLimit());
@@ -147,8 +156,12 @@ bool GOrgueSound::OpenSound()
 		}
 
 		OpenMidi();
-		StartStreams();
 		StartThreads();
+		if (m_PrerenderPeriods)
+			m_PrerenderThread = new GOSoundPrerenderThread(*this);
+		StartStreams();
+		if (m_PrerenderThread)
+			m_PrerenderThread->Run();
 		opened_ok = true;
 
 		if (m_organfile)
@@ -179,11 +192,13 @@ void GOrgueSound::StartStreams()
 
 	m_WaitCount.exchange(0);
 	m_CalcCount.exchange(0);
+	m_RenderedPeriods.exchange(0);
 	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
 	{
 		GOMutexLocker dev_lock(m_AudioOutputs[i].mutex);
 		m_AudioOutputs[i].wait = false;
 		m_AudioOutputs[i].waiting = true;
+		m_AudioOutputs[i].read.exchange(0);
 	}
 
 	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
@@ -192,7 +207,10 @@ void GOrgueSound::StartStreams()
 
 void GOrgueSound::CloseSound()
 {
-	StopThreads();
+	/* The callbacks may still wake the stopped prerender thread, so it is
+	 * only deleted after the ports are closed */
+	if (m_PrerenderThread)
+		m_PrerenderThread->Delete();
 
 	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
 	{
@@ -219,6 +237,13 @@ void GOrgueSound::CloseSound()
 		}
 	}
 
+	StopThreads();
+	if (m_PrerenderThread)
+	{
+		delete m_PrerenderThread;
+		m_PrerenderThread = NULL;
+	}
+
 	if (m_organfile)
 		m_organfile->Abort();
 	ResetMeters();
@@ -335,6 +360,23 @@ bool GOrgueSound::AudioCallback(unsigned dev_index, float* output_buffer, unsign
 		return 1;
 	}
 	GO_SOUND_OUTPUT* device = &m_AudioOutputs[dev_index];
+	if (m_PrerenderPeriods)
+	{
+		unsigned read = device->read;
+		if (read == m_RenderedPeriods)
+			/* Underrun, the period is played later */
+			std::fill(output_buffer, output_buffer + device->ring.size() / m_PrerenderPeriods, 0.0f);
+		else
+		{
+			unsigned size = device->ring.size() / m_PrerenderPeriods;
+			memcpy(output_buffer, &device->ring[(read % m_PrerenderPeriods) * size], size * sizeof(float));
+			device->read = read + 1;
+		}
+		if (m_PrerenderThread)
+			m_PrerenderThread->Wakeup();
+		return true;
+	}
+
 	GOMutexLocker locker(device->mutex);
 
 	if (device->wait && device->waiting)
@@ -348,13 +390,11 @@ bool GOrgueSound::AudioCallback(unsigned dev_index, float* output_buffer, unsign
 	if (count + 1 == m_AudioOutputs.size())
 	{
 		m_SoundEngine.NextPeriod();
+		m_SoundEngine.SetTimeReference(wxGetLocalTimeMillis().GetValue(), m_SoundEngine.GetTime() + m_SamplesPerBuffer);
 		UpdateMeter();
 
-		{
-			GOMutexLocker thread_locker(m_thread_lock);
-			for(unsigned i = 0; i < m_Threads.size(); i++)
-				m_Threads[i]->Wakeup();
-		}
+		for(unsigned i = 0; i < m_Threads.size(); i++)
+			m_Threads[i]->Wakeup();
 		m_CalcCount.exchange(0);
 		m_WaitCount.exchange(0);
 
@@ -369,6 +409,34 @@ bool GOrgueSound::AudioCallback(unsigned dev_index, float* output_buffer, unsign
 	return true;
 }
 
+/* Renders the next period into the ring of every device, once every device
+ * has consumed the period that used the slot before. Runs on the prerender
+ * thread, which takes the device locks the organ setup waits for. */
+bool GOrgueSound::RenderPeriod()
+{
+	unsigned period = m_RenderedPeriods;
+	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
+		if (period - m_AudioOutputs[i].read >= m_PrerenderPeriods)
+			return false;
+
+	GOMultiMutexLocker multi;
+	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
+		multi.Add(m_AudioOutputs[i].mutex);
+	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
+	{
+		unsigned size = m_AudioOutputs[i].ring.size() / m_PrerenderPeriods;
+		m_SoundEngine.GetAudioOutput(&m_AudioOutputs[i].ring[(period % m_PrerenderPeriods) * size], m_SamplesPerBuffer, i, i + 1 >= m_AudioOutputs.size());
+	}
+	m_SoundEngine.NextPeriod();
+	m_SoundEngine.SetTimeReference(wxGetLocalTimeMillis().GetValue(), m_SoundEngine.GetTime() + m_SamplesPerBuffer);
+	UpdateMeter();
+
+	for(unsigned i = 0; i < m_Threads.size(); i++)
+		m_Threads[i]->Wakeup();
+	m_RenderedPeriods = period + 1;
+	return true;
+}
+
 GOSoundEngine& GOrgueSound::GetEngine()
 {
 	return m_SoundEngine;
@@ -379,6 +447,8 @@ wxString GOrgueSound::getState()
 	if (!m_AudioOutputs.size())
 		return _("No sound output occurring");
 	wxString result = wxString::Format(_("%d samples per buffer, %d Hz\n"), m_SamplesPerBuffer, m_SoundEngine.GetSampleRate());
+	if (m_PrerenderPeriods)
+		result += wxString::Format(_("%d periods rendered ahead\n"), m_PrerenderPeriods);
 	for(unsigned i = 0; i < m_AudioOutputs.size(); i++)
 		result = result + _("\n") + m_AudioOutputs[i].port->getPortState();
 	return result;
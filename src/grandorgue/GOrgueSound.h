@@ -23,6 +23,7 @@
 
 class GrandOrgueFile;
 class GOrgueMidi;
+class GOSoundPrerenderThread;
 class GOSoundThread;
 class GOrgueSoundPort;
 class GOrgueSoundRtPort;
@@ -39,9 +40,14 @@ class GOrgueSound
 		GOCondition condition;
 		bool wait;
 		bool waiting;
+		/* Periods rendered ahead and the number consumed by the callback */
+		std::vector<float> ring;
+		atomic_uint read;
 
 		GO_SOUND_OUTPUT() :
-			condition(mutex)
+			condition(mutex),
+			ring(),
+			read(0)
 		{
 			port = 0;
 			wait = false;
@@ -49,7 +55,9 @@ class GOrgueSound
 		}
 
 		GO_SOUND_OUTPUT(const GO_SOUND_OUTPUT& old) :
-			condition(mutex)
+			condition(mutex),
+			ring(old.ring),
+			read((unsigned)old.read)
 		{
 			port = old.port;
 			wait = old.wait;
@@ -61,13 +69,14 @@ class GOrgueSound
 			port = old.port;
 			wait = old.wait;
 			waiting = old.waiting;
+			ring = old.ring;
+			read = (unsigned)old.read;
 			return *this;
 		}
 	};
 
 private:
 	GOMutex m_lock;
-	GOMutex m_thread_lock;
 
 	bool logSoundErrors;
 
@@ -76,6 +85,9 @@ private:
 	atomic_uint m_CalcCount;
 
 	unsigned m_SamplesPerBuffer;
+	unsigned m_PrerenderPeriods;
+	atomic_uint m_RenderedPeriods;
+	GOSoundPrerenderThread* m_PrerenderThread;
 
 	unsigned meter_counter;
 
@@ -129,6 +141,7 @@ public:
 	GOSoundEngine& GetEngine();
 
 	bool AudioCallback(unsigned dev_index, float* outputBuffer, unsigned int nFrames);
+	bool RenderPeriod();
 };
 
 #endif
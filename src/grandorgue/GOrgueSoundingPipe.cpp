@@ -147,7 +147,7 @@ void GOrgueSoundingPipe::LoadData()
 	try
 	{
 		m_SoundProvider.LoadFromFile(m_AttackInfo, m_ReleaseInfo, m_PipeConfig.GetEffectiveBitsPerSample(), m_PipeConfig.GetEffectiveChannels(), 
-					     m_PipeConfig.GetEffectiveCompress(), (loop_load_type)m_PipeConfig.GetEffectiveLoopLoad(), m_PipeConfig.GetEffectiveAttackLoad(), m_PipeConfig.GetEffectiveReleaseLoad(),
+					     (compression_type)m_PipeConfig.GetEffectiveCompress(), (loop_load_type)m_PipeConfig.GetEffectiveLoopLoad(), m_PipeConfig.GetEffectiveAttackLoad(), m_PipeConfig.GetEffectiveReleaseLoad(),
 					     m_SampleMidiKeyNumber, m_LoopCrossfadeLength, m_ReleaseCrossfadeLength);
 		Validate();
 	}
@@ -169,6 +169,11 @@ void GOrgueSoundingPipe::LoadData()
 	}
 }
 
+void GOrgueSoundingPipe::FreeData()
+{
+	m_SoundProvider.ClearData();
+}
+
 bool GOrgueSoundingPipe::LoadCache(GOrgueCache& cache)
 {
 	try
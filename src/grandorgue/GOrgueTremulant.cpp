@@ -46,6 +46,11 @@ void GOrgueTremulant::LoadData()
 	InitSoundProvider();
 }
 
+/* The synthesized tremulant is small and recreated by LoadCache */
+void GOrgueTremulant::FreeData()
+{
+}
+
 bool GOrgueTremulant::LoadCache(GOrgueCache& cache)
 {
 	InitSoundProvider();
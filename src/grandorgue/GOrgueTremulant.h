@@ -39,6 +39,7 @@ private:
 
 	void Initialize();
 	void LoadData();
+	void FreeData();
 	bool LoadCache(GOrgueCache& cache);
 	bool SaveCache(GOrgueCacheWriter& cache);
 	void UpdateHash(GOrgueHash& hash);
@@ -24,6 +24,7 @@
 #include "GOrgueAudioRecorder.h"
 #include "GOrgueBuffer.h"
 #include "GOrgueCache.h"
+#include "GOrgueCacheLoadThread.h"
 #include "GOrgueCacheWriter.h"
 #include "GOrgueConfigFileReader.h"
 #include "GOrgueConfigFileWriter.h"
@@ -59,18 +60,31 @@
 #include "GOrgueSwitch.h"
 #include "GOrgueRank.h"
 #include "GOrgueTemperament.h"
+#include "GOrgueTime.h"
 #include "GOrgueTremulant.h"
 #include "GOrgueWindchest.h"
 #include "contrib/sha1.h"
+#include "threading/GOMutexLocker.h"
+#include <wx/file.h>
 #include <wx/filename.h>
 #include <wx/log.h>
 #include <wx/msgdlg.h>
+#include <wx/stopwatch.h>
 #include <wx/stream.h>
 #include <wx/wfstream.h>
 #include <math.h>
 
+/* An outdated cache is rewritten instead of appended to, once the records
+ * of older object versions take more than this share of the file */
+#define CACHE_MAX_UNUSED_PERCENT 50
+
+/* Position in the period of the MIDI event being processed by the current
+ * thread. Keys are played on the MIDI thread, everything else on the GUI
+ * thread, so the offset must not leak between them. */
+static thread_local unsigned t_EventOffset = 0;
 
 GrandOrgueFile::GrandOrgueFile(GOrgueDocument* doc, GOrgueSettings& settings) :
+	GOrgueTimer(&m_ModelLock),
 	m_doc(doc),
 	m_odf(),
 	m_ArchiveID(),
@@ -106,6 +120,8 @@ GrandOrgueFile::GrandOrgueFile(GOrgueDocument* doc, GOrgueSettings& settings) :
 	m_UsedSections(),
 	m_soundengine(0),
 	m_midi(0),
+	m_ModelLock(),
+	m_KeyListener(),
 	m_MidiSamplesetMatch(),
 	m_SampleSetId1(0),
 	m_SampleSetId2(0),
@@ -118,6 +134,8 @@ GrandOrgueFile::GrandOrgueFile(GOrgueDocument* doc, GOrgueSettings& settings) :
 	m_MainWindowData(this)
 {
 	m_pool.SetMemoryLimit(m_Settings.MemoryLimit() * 1024 * 1024);
+	m_pool.SetCacheResident(!m_Settings.DiskStreaming());
+	m_KeyListener.SetCallback(this);
 }
 
 bool GrandOrgueFile::IsCacheable()
@@ -129,6 +147,23 @@ GOrgueHashType GrandOrgueFile::GenerateCacheHash()
 {
 	GOrgueHash hash;
 	UpdateHash(hash);
+	UpdateCacheFormatHash(hash);
+
+	return hash.getHash();
+}
+
+/* Key of the cache record of a single object */
+GOrgueHashType GrandOrgueFile::GenerateCacheObjectHash(GOrgueCacheObject* obj)
+{
+	GOrgueHash hash;
+	obj->UpdateHash(hash);
+	UpdateCacheFormatHash(hash);
+
+	return hash.getHash();
+}
+
+void GrandOrgueFile::UpdateCacheFormatHash(GOrgueHash& hash)
+{
 	hash.Update(sizeof(GOAudioSection));
 	hash.Update(sizeof(GOrgueSoundingPipe));
 	hash.Update(sizeof(GOrgueReleaseAlignTable));
@@ -139,8 +174,6 @@ GOrgueHashType GrandOrgueFile::GenerateCacheHash()
 	hash.Update(sizeof(release_section_info));
 	hash.Update(sizeof(audio_start_data_segment));
 	hash.Update(sizeof(audio_end_data_segment));
-
-	return hash.getHash();
 }
 
 void GrandOrgueFile::ReadOrganFile(GOrgueConfigReader& cfg)
@@ -315,6 +348,8 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 {
 	GOrgueFilename odf_name;
 
+	GOrgueFileInfoScope file_info(m_FileInfo, m_Settings.LoadConcurrency());
+	m_pool.StartLoad();
 	if (organ.GetArchiveID() != wxEmptyString)
 	{
 		dlg->Setup(1, _("Loading sample set") ,_("Parsing organ packages"));
@@ -426,6 +461,7 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 	{
 		return error_;
 	}
+	m_FileInfo.CheckFiles();
 	ini.ReportUnused();
 
 	GOrgueBuffer<char> dummy;
@@ -436,14 +472,33 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 
 		wxString load_error;
 		bool cache_ok = false;
+		bool cache_outdated = false;
 
 		ResolveReferences();
+		UpdateMidiIndex();
 
 		/* Figure out list of pipes to load */
 		dlg->Reset(GetCacheObjectCount());
 		/* Load pipes */
 		atomic_uint nb_loaded_obj(0);
 
+		/* Streaming plays the samples from the mapped cache. Without a
+		 * usable one, it is written first, so the sample set does not need
+		 * to fit into memory. */
+		if (!m_pool.IsCacheResident() && m_Settings.ManageCache() && !m_Settings.CompressCache() && !IsCacheUsable())
+		{
+			bool aborted = false;
+			if (!BuildCache(dlg, aborted) && aborted)
+			{
+				dummy.free();
+				SetTemperament(m_Temperament);
+				GOMessageBox(_("Load aborted by the user - only parts of the organ are loaded.") , _("Load error"), wxOK | wxICON_ERROR, NULL);
+				CloseArchives();
+				return wxEmptyString;
+			}
+			dlg->Reset(GetCacheObjectCount());
+		}
+
 		if (wxFileExists(m_CacheFilename))
 		{
 
@@ -460,8 +515,15 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 					wxLogWarning (_("Cache file had bad magic bypassing cache."));
 				}
 				hash1 = GenerateCacheHash();
-				if (!reader.Read(&hash2, sizeof(hash2)) || 
+				bool hash_ok = reader.Read(&hash2, sizeof(hash2));
+				if (hash_ok && cache_ok && reader.CanLoadParallel() &&
 				    memcmp(&hash1, &hash2, sizeof(hash1)))
+				{
+					/* Objects are looked up by their own hash, only the changed ones
+					 * are loaded from the samples */
+					cache_outdated = true;
+				}
+				else if (!hash_ok || memcmp(&hash1, &hash2, sizeof(hash1)))
 				{
 					cache_ok = false;
 					reader.FreeCacheFile();
@@ -471,47 +533,78 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 
 			if (cache_ok)
 			{
+				atomic_uint nb_done_obj(0);
+				atomic_uint nb_missed_obj(0);
+				std::vector<GOrgueHashType> hashes;
+				ptr_vector<GOrgueCacheLoadThread> threads;
+				if (reader.CanLoadParallel())
+				{
+					for(unsigned i = 0; i < GetCacheObjectCount(); i++)
+						hashes.push_back(GenerateCacheObjectHash(GetCacheObject(i)));
+					for(unsigned i = 0; i < m_Settings.LoadConcurrency(); i++)
+						threads.push_back(new GOrgueCacheLoadThread(*this, reader, hashes, nb_loaded_obj, nb_done_obj, nb_missed_obj));
+				}
+
+				for(unsigned i = 0; i < threads.size(); i++)
+					threads[i]->Run();
+
 				try
 				{
 					while (true)
 					{
-						GOrgueCacheObject* obj = GetCacheObject(nb_loaded_obj);
+						GOrgueCacheObject* obj = GOrgueCacheLoadThread::LoadChunk(*this, reader, hashes, nb_loaded_obj, nb_done_obj, nb_missed_obj);
 						if (!obj)
 							break;
-						if (!obj->LoadCache(reader))
-						{
-							cache_ok = false;
-							wxLogError(_("Cache load failure: Failed to read %s from cache."), obj->GetLoadTitle().c_str());
-							break;
-						}
-						nb_loaded_obj.fetch_add(1);
-						if (!dlg->Update (nb_loaded_obj, obj->GetLoadTitle()))
+						if (!dlg->Update (nb_done_obj, obj->GetLoadTitle()))
 						{
 							dummy.free();
+							threads.clear();
 							SetTemperament(m_Temperament);
 							GOMessageBox(_("Load aborted by the user - only parts of the organ are loaded.") , _("Load error"), wxOK | wxICON_ERROR, NULL);
 							CloseArchives();
 							return wxEmptyString;
 						}
 					}
-					if (nb_loaded_obj >= GetCacheObjectCount())
+
+					for(unsigned i = 0; i < threads.size(); i++)
+						threads[i]->checkResult();
+
+					if (nb_done_obj >= GetCacheObjectCount())
 						m_Cacheable = true;
+					if (nb_missed_obj)
+					{
+						cache_outdated = true;
+						wxLogDebug(wxT("%u of %u objects not found in the cache"), (unsigned)nb_missed_obj, GetCacheObjectCount());
+					}
 				}
 				catch (wxString msg)
 				{
 					cache_ok = false;
 					wxLogError(_("Cache load failure: %s"), msg.c_str());
 				}
+				threads.clear();
+				if (!cache_ok)
+					nb_loaded_obj = 0;
 			}
 
-			if (!cache_ok && !m_Settings.ManageCache())
+			if ((!cache_ok || cache_outdated) && !m_Settings.ManageCache())
 			{
 				GOMessageBox(_("The cache for this organ is outdated. Please update or delete it."), _("Warning"), wxOK | wxICON_WARNING, NULL);
 			}
 
+			/* The records of an uncompressed cache are mapped, so only the
+			 * changed objects are added to it. A cache, which should be
+			 * compressed, is rewritten instead. */
+			if (cache_ok && cache_outdated && m_Settings.ManageCache() && m_Cacheable &&
+			    !m_Settings.CompressCache() && reader.CanAppend() && AppendCache(dlg, reader))
+				cache_outdated = false;
+
 			reader.Close();
 		}
 
+		if (cache_ok && cache_outdated && m_Settings.ManageCache() && m_Cacheable)
+			UpdateCache(dlg, m_Settings.CompressCache());
+
 		if (!cache_ok)
 		{
 			ptr_vector<GOrgueLoadThread> threads;
@@ -563,6 +656,7 @@ wxString GrandOrgueFile::Load(GOrgueProgressDialog* dlg, const GOrgueOrgan& orga
 	dummy.free();
 
 	CloseArchives();
+	m_pool.FinishLoad();
 
 	return wxEmptyString;
 
@@ -608,51 +702,175 @@ bool GrandOrgueFile::CachePresent()
 	return wxFileExists(m_CacheFilename);
 }
 
-bool GrandOrgueFile::UpdateCache(GOrgueProgressDialog* dlg, bool compress)
+/* Write the records of all objects, which are not yet in the cache, and
+ * the object table */
+bool GrandOrgueFile::WriteCacheObjects(GOrgueProgressDialog* dlg, GOrgueCacheWriter& writer)
 {
-	DeleteCache();
-	/* Figure out the list of pipes to save */
 	unsigned nb_saved_objs = 0;
+	uint64_t start_size = writer.GetSize();
+	GOTime start = wxGetLocalTimeMillis();
 
 	dlg->Setup(GetCacheObjectCount(), _("Creating sample cache"));
 
-	wxFileOutputStream file(m_CacheFilename);
-	GOrgueCacheWriter writer(file, compress);
-
-	/* Save pipes to cache */
-	bool cache_save_ok = writer.WriteHeader();
-	
-	GOrgueHashType hash = GenerateCacheHash();
-	if (!writer.Write(&hash, sizeof(hash)))
-		cache_save_ok = false;
-
-	for (unsigned i = 0; cache_save_ok; i++)
+	for (unsigned i = 0; true; i++)
 	{
 		GOrgueCacheObject* obj = GetCacheObject(i);
 		if (!obj)
 			break;
-		if (!obj->SaveCache(writer))
+		GOrgueHashType obj_hash = GenerateCacheObjectHash(obj);
+		/* Identical objects share one record */
+		if (!writer.HasObject(obj_hash) && !writer.KeepObject(obj_hash) &&
+		    (!writer.BeginObject(obj_hash) || !obj->SaveCache(writer)))
 		{
-			cache_save_ok = false;
 			wxLogError(_("Save of %s to the cache failed"), obj->GetLoadTitle().c_str());
+			return false;
 		}
 		nb_saved_objs++;
 
-		if (!dlg->Update (nb_saved_objs, obj->GetLoadTitle()))
-		{
-			writer.Close();
-			DeleteCache();
+		double seconds = (wxGetLocalTimeMillis() - start).ToDouble() / 1000;
+		double rate = seconds > 0 ? (writer.GetSize() - start_size) / (1024.0 * 1024.0) / seconds : 0;
+		if (!dlg->Update (nb_saved_objs, wxString::Format(_("%s (%.1f MB/s)"), obj->GetLoadTitle().c_str(), rate)))
 			return false;
+	}
+
+	if (!writer.WriteIndex())
+		return false;
+	double seconds = (wxGetLocalTimeMillis() - start).ToDouble() / 1000;
+	wxLogDebug(wxT("Cache written: %.1f MB (%.1f MB on disk) in %.3f s, %.1f MB/s"), (writer.GetSize() - start_size) / (1024.0 * 1024.0),
+		   writer.GetFileSize() / (1024.0 * 1024.0), seconds, seconds > 0 ? (writer.GetSize() - start_size) / (1024.0 * 1024.0) / seconds : 0);
+	return true;
+}
+
+/* True if there is an uncompressed cache for streaming. If it is outdated,
+ * the changed objects are added to it in place. */
+bool GrandOrgueFile::IsCacheUsable()
+{
+	if (!wxFileExists(m_CacheFilename))
+		return false;
+	wxFile cache_file(m_CacheFilename);
+	if (!cache_file.IsOpened())
+		return false;
+	GOrgueCache reader(cache_file, m_pool);
+	bool usable = reader.ReadHeader() && reader.CanAppend();
+	reader.FreeCacheFile();
+	reader.Close();
+	return usable;
+}
+
+/* Write an uncompressed cache, loading one object at a time from the
+ * samples and freeing it as soon as its record is written */
+bool GrandOrgueFile::BuildCache(GOrgueProgressDialog* dlg, bool& aborted)
+{
+	wxString tmp_name = m_CacheFilename + wxT(".new");
+	bool cache_save_ok;
+	try
+	{
+		wxFileOutputStream file(tmp_name);
+		GOrgueCacheWriter writer(file, false);
+
+		GOrgueHashType hash = GenerateCacheHash();
+		cache_save_ok = file.IsOk() && writer.WriteHeader() && writer.Write(&hash, sizeof(hash));
+		for (unsigned i = 0; cache_save_ok; i++)
+		{
+			GOrgueCacheObject* obj = GetCacheObject(i);
+			if (!obj)
+				break;
+			GOrgueHashType obj_hash = GenerateCacheObjectHash(obj);
+			if (!writer.HasObject(obj_hash))
+			{
+				obj->LoadData();
+				cache_save_ok = writer.BeginObject(obj_hash) && obj->SaveCache(writer);
+				obj->FreeData();
+				if (!cache_save_ok)
+					wxLogError(_("Save of %s to the cache failed"), obj->GetLoadTitle().c_str());
+			}
+			if (!dlg->Update(i + 1, obj->GetLoadTitle()))
+			{
+				aborted = true;
+				cache_save_ok = false;
+			}
 		}
+		cache_save_ok = cache_save_ok && writer.WriteIndex();
+		writer.Close();
+	}
+	catch (...)
+	{
+		if (::wxFileExists(tmp_name))
+			::wxRemoveFile(tmp_name);
+		throw;
 	}
 
-	writer.Close();
-	if (!cache_save_ok)
+	if (cache_save_ok && !GORenameFile(tmp_name, m_CacheFilename))
+		cache_save_ok = false;
+	if (!cache_save_ok && ::wxFileExists(tmp_name))
+		::wxRemoveFile(tmp_name);
+	return cache_save_ok;
+}
+
+/* Add the records of changed objects to the end of an uncompressed cache.
+ * The file is never truncated or replaced, as the pool may map it. The
+ * organ hash is written last, so the cache only matches the organ once
+ * the new records and the object table are complete. Returns false without
+ * a change, if the replaced records take too much of the file, so that the
+ * caller rewrites it. */
+bool GrandOrgueFile::AppendCache(GOrgueProgressDialog* dlg, GOrgueCache& reader)
+{
+	std::vector<GOrgueHashType> hashes;
+	for (unsigned i = 0; GetCacheObject(i); i++)
+		hashes.push_back(GenerateCacheObjectHash(GetCacheObject(i)));
+
+	wxFile file(m_CacheFilename, wxFile::read_write);
+	if (!file.IsOpened())
+		return false;
+	wxFileOffset size = file.SeekEnd();
+	if (size == wxInvalidOffset)
+		return false;
+	if ((size - reader.GetUsedSize(hashes)) * 100 > (uint64_t)size * CACHE_MAX_UNUSED_PERCENT)
 	{
-		DeleteCache();
+		wxLogDebug(wxT("Compacting the cache %s"), m_CacheFilename.c_str());
 		return false;
 	}
-	return true;
+
+	bool cache_save_ok;
+	{
+		wxFileOutputStream stream(file);
+		GOrgueCacheWriter writer(stream, false);
+		writer.Append(reader.GetObjects(), size);
+		cache_save_ok = WriteCacheObjects(dlg, writer);
+		writer.Close();
+	}
+
+	GOrgueHashType hash = GenerateCacheHash();
+	if (cache_save_ok)
+		cache_save_ok = file.Seek(sizeof(int)) != wxInvalidOffset && file.Write(&hash, sizeof(hash)) == sizeof(hash);
+	if (!cache_save_ok)
+		wxLogWarning(_("Update of the cache %s failed"), m_CacheFilename.c_str());
+	return cache_save_ok;
+}
+
+/* The cache is written to a new file, which replaces the old one. POSIX
+ * systems keep a mapping of the old file valid, Windows refuses to replace
+ * a mapped file, so the old cache stays in use then. */
+bool GrandOrgueFile::UpdateCache(GOrgueProgressDialog* dlg, bool compress)
+{
+	GOrgueFileInfoScope file_info(m_FileInfo, m_Settings.LoadConcurrency());
+	wxString tmp_name = m_CacheFilename + wxT(".new");
+	bool cache_save_ok;
+	{
+		wxFileOutputStream file(tmp_name);
+		GOrgueCacheWriter writer(file, compress, m_Settings.LoadConcurrency());
+
+		GOrgueHashType hash = GenerateCacheHash();
+		cache_save_ok = file.IsOk() && writer.WriteHeader() && writer.Write(&hash, sizeof(hash)) &&
+			WriteCacheObjects(dlg, writer);
+		writer.Close();
+	}
+
+	if (cache_save_ok && !GORenameFile(tmp_name, m_CacheFilename))
+		cache_save_ok = false;
+	if (!cache_save_ok && ::wxFileExists(tmp_name))
+		::wxRemoveFile(tmp_name);
+	return cache_save_ok;
 }
 
 void GrandOrgueFile::DeleteCache()
@@ -663,6 +881,7 @@ void GrandOrgueFile::DeleteCache()
 
 GrandOrgueFile::~GrandOrgueFile(void)
 {
+	m_KeyListener.Unregister();
 	CloseArchives();
 	Cleanup();
 	// Just to be sure, that the sound providers are freed before the pool
@@ -686,7 +905,8 @@ bool GrandOrgueFile::Save()
 {
 	if (!Export(m_SettingFilename))
 		return false;
-	m_doc->Modify(false);
+	if (m_doc)
+		m_doc->Modify(false);
 	m_setter->UpdateModified(false);
 	return true;
 }
@@ -945,11 +1165,23 @@ const wxString GrandOrgueFile::GetCacheFilename()
 	return m_CacheFilename;
 }
 
+/* Serializes the changes of the organ state between the GUI thread and the
+ * manual keys played on the MIDI thread */
+GOMutex& GrandOrgueFile::GetModelLock()
+{
+	return m_ModelLock;
+}
+
 GOrgueMemoryPool& GrandOrgueFile::GetMemoryPool()
 {
 	return m_pool;
 }
 
+GOrgueFileInfoCache& GrandOrgueFile::GetFileInfo()
+{
+	return m_FileInfo;
+}
+
 GOrgueSettings& GrandOrgueFile::GetSettings()
 {
 	return m_Settings;
@@ -969,20 +1201,20 @@ GO_SAMPLER* GrandOrgueFile::StartSample(const GOSoundProvider *pipe, int sampler
 {
 	if (!m_soundengine)
 		return NULL;
-	return m_soundengine->StartSample(pipe, sampler_group_id, audio_group, velocity, delay, last_stop);
+	return m_soundengine->StartSample(pipe, sampler_group_id, audio_group, velocity, delay, last_stop, t_EventOffset);
 }
 
 uint64_t GrandOrgueFile::StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle)
 {
 	if (m_soundengine)
-		return m_soundengine->StopSample(pipe, handle);
+		return m_soundengine->StopSample(pipe, handle, t_EventOffset);
 	return 0;
 }
 
 void GrandOrgueFile::SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle)
 {
 	if (m_soundengine)
-		m_soundengine->SwitchSample(pipe, handle);
+		m_soundengine->SwitchSample(pipe, handle, t_EventOffset);
 }
 
 void GrandOrgueFile::UpdateVelocity(GO_SAMPLER* handle, unsigned velocity)
@@ -991,6 +1223,46 @@ void GrandOrgueFile::UpdateVelocity(GO_SAMPLER* handle, unsigned velocity)
 		m_soundengine->UpdateVelocity(handle, velocity);
 }
 
+GOSoundEngine* GrandOrgueFile::GetSoundEngine()
+{
+	return m_soundengine;
+}
+
+unsigned GrandOrgueFile::GetStreamUnderruns()
+{
+	if (m_soundengine)
+		return m_soundengine->GetStreamUnderruns();
+	return 0;
+}
+
+unsigned GrandOrgueFile::GetStolenSamplers()
+{
+	if (m_soundengine)
+		return m_soundengine->GetStolenSamplers();
+	return 0;
+}
+
+unsigned GrandOrgueFile::GetDroppedSamplers()
+{
+	if (m_soundengine)
+		return m_soundengine->GetDroppedSamplers();
+	return 0;
+}
+
+unsigned GrandOrgueFile::GetTransactionSize()
+{
+	if (m_soundengine)
+		return m_soundengine->GetTransactionSize();
+	return 0;
+}
+
+unsigned GrandOrgueFile::GetTransactionTime()
+{
+	if (m_soundengine)
+		return m_soundengine->GetTransactionTime();
+	return 0;
+}
+
 void GrandOrgueFile::SendMidiMessage(GOrgueMidiEvent& e)
 {
 	if (m_midi)
@@ -1015,6 +1287,8 @@ void GrandOrgueFile::LoadMIDIFile(wxString const& filename)
 
 void GrandOrgueFile::Abort()
 {
+	/* Waits for a key event being processed on the MIDI thread */
+	m_KeyListener.Unregister();
 	m_soundengine = NULL;
 
 	GOrgueEventDistributor::AbortPlayback();
@@ -1050,10 +1324,13 @@ void GrandOrgueFile::PreparePlayback(GOSoundEngine* engine, GOrgueMidi* midi, GO
 	m_MidiSamplesetMatch.clear();
 	GOrgueEventDistributor::PreparePlayback();
 
-	m_setter->UpdateModified(m_doc->IsModified());
+	m_setter->UpdateModified(m_doc && m_doc->IsModified());
 
 	GOrgueEventDistributor::StartPlayback();
 	GOrgueEventDistributor::PrepareRecording();
+
+	if (m_midi)
+		m_KeyListener.Register(m_midi, true);
 }
 
 void GrandOrgueFile::PrepareRecording()
@@ -1083,7 +1360,7 @@ void GrandOrgueFile::Update()
 	m_setter->Update();
 }
 
-void GrandOrgueFile::ProcessMidi(const GOrgueMidiEvent& event)
+void GrandOrgueFile::ProcessMidi(const GOrgueMidiEvent& event, unsigned handlers)
 {
 	if (event.GetMidiType() == MIDI_RESET)
 	{
@@ -1113,7 +1390,39 @@ void GrandOrgueFile::ProcessMidi(const GOrgueMidiEvent& event)
 			return;
 	}
 
-	GOrgueEventDistributor::SendMidi(event);
+	/* Pipes started or stopped by the event sound at its position in the
+	 * period, instead of at the begin of the next one */
+	if (m_soundengine)
+		t_EventOffset = m_soundengine->GetEventOffset(event.GetTime().GetValue());
+	GOrgueEventDistributor::SendMidi(event, handlers);
+	t_EventOffset = 0;
+}
+
+/* MIDI input received on the GUI thread. While playing, the manual keys
+ * have already been handled on the MIDI thread. */
+void GrandOrgueFile::ProcessMidiInput(const GOrgueMidiEvent& event)
+{
+	ProcessMidi(event, m_midi ? MIDI_HANDLER_CONTROLS : MIDI_HANDLER_ALL);
+}
+
+/* Runs on the MIDI thread: only the manual keys are played here, so notes
+ * do not wait for the GUI. Everything else, including the setup messages,
+ * is left to the GUI thread. */
+void GrandOrgueFile::OnMidiEvent(const GOrgueMidiEvent& event)
+{
+	switch(event.GetMidiType())
+	{
+	case MIDI_RESET:
+	case MIDI_SYSEX_GO_CLEAR:
+	case MIDI_SYSEX_GO_SETUP:
+	case MIDI_SYSEX_GO_SAMPLESET:
+		return;
+
+	default:
+		break;
+	}
+	GOMutexLocker locker(m_ModelLock);
+	ProcessMidi(event, MIDI_HANDLER_KEYS);
 }
 
 void GrandOrgueFile::Reset()
@@ -1158,7 +1467,8 @@ void GrandOrgueFile::AllNotesOff()
 
 void GrandOrgueFile::Modified()
 {
-	m_doc->Modify(true);
+	if (m_doc)
+		m_doc->Modify(true);
 	m_setter->UpdateModified(true);
 }
 
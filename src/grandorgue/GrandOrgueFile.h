@@ -12,12 +12,16 @@
 #include "GOrgueBitmapCache.h"
 #include "GOrgueCombinationDefinition.h"
 #include "GOrgueEventDistributor.h"
+#include "GOrgueFileInfoCache.h"
 #include "GOrgueLabel.h"
 #include "GOrgueMainWindowData.h"
 #include "GOrgueMemoryPool.h"
+#include "GOrgueMidiCallback.h"
+#include "GOrgueMidiListener.h"
 #include "GOrgueModel.h"
 #include "GOrguePipeConfigTreeNode.h"
 #include "GOrgueTimer.h"
+#include "threading/GOMutex.h"
 #include <wx/hashmap.h>
 #include <wx/string.h>
 #include <vector>
@@ -28,7 +32,10 @@ class GOrgueArchive;
 class GOrgueAudioRecorder;
 class GOrgueButton;
 class GOrgueCache;
+class GOrgueCacheObject;
+class GOrgueCacheWriter;
 class GOrgueElementCreator;
+class GOrgueHash;
 class GOrgueMidi;
 class GOrgueMidiEvent;
 class GOrgueMidiPlayer;
@@ -45,7 +52,7 @@ class GOSoundRecorder;
 class GO_SAMPLER;
 typedef struct _GOrgueHashType GOrgueHashType;
 
-class GrandOrgueFile : public GOrgueEventDistributor, private GOrguePipeUpdateCallback, public GOrgueTimer, public GOrgueModel
+class GrandOrgueFile : public GOrgueEventDistributor, private GOrguePipeUpdateCallback, public GOrgueTimer, public GOrgueModel, private GOrgueMidiCallback
 {
 	WX_DECLARE_STRING_HASH_MAP(bool, GOStringBoolMap);
 
@@ -90,11 +97,14 @@ private:
 
 	GOSoundEngine* m_soundengine;
 	GOrgueMidi* m_midi;
+	GOMutex m_ModelLock;
+	GOrgueMidiListener m_KeyListener;
 	std::vector<bool> m_MidiSamplesetMatch;
 	int m_SampleSetId1, m_SampleSetId2;
 	GOGUIMouseStateTracker m_MouseState;
 
 	GOrgueMemoryPool m_pool;
+	GOrgueFileInfoCache m_FileInfo;
 	GOrgueBitmapCache m_bitmaps;
 	GOrguePipeConfigTreeNode m_PipeConfig;
 	GOrgueSettings& m_Settings;
@@ -105,10 +115,17 @@ private:
 
 	void ReadOrganFile(GOrgueConfigReader& cfg);
 	GOrgueHashType GenerateCacheHash();
+	GOrgueHashType GenerateCacheObjectHash(GOrgueCacheObject* obj);
+	void UpdateCacheFormatHash(GOrgueHash& hash);
+	bool WriteCacheObjects(GOrgueProgressDialog* dlg, GOrgueCacheWriter& writer);
+	bool AppendCache(GOrgueProgressDialog* dlg, GOrgueCache& reader);
+	bool IsCacheUsable();
+	bool BuildCache(GOrgueProgressDialog* dlg, bool& aborted);
 	wxString GenerateSettingFileName();
 	wxString GenerateCacheFileName();
 	void SetTemperament(const GOrgueTemperament& temperament);
 	void PreconfigRecorder();
+	void OnMidiEvent(const GOrgueMidiEvent& event);
 
 	void UpdateAmplitude();
 	void UpdateTuning();
@@ -136,7 +153,8 @@ public:
 	void PrepareRecording();
 	void Update();
 	void Reset();
-	void ProcessMidi(const GOrgueMidiEvent& event);
+	void ProcessMidi(const GOrgueMidiEvent& event, unsigned handlers = MIDI_HANDLER_ALL);
+	void ProcessMidiInput(const GOrgueMidiEvent& event);
 	void AllNotesOff();
 	void Modified();
 	GOrgueDocument* GetDocument();
@@ -147,7 +165,9 @@ public:
 	GOGUIPanel* GetPanel(unsigned index);
 	unsigned GetPanelCount();
 	void AddPanel(GOGUIPanel* panel);
+	GOMutex& GetModelLock();
 	GOrgueMemoryPool& GetMemoryPool();
+	GOrgueFileInfoCache& GetFileInfo();
 	GOrgueSettings& GetSettings();
 	GOrgueBitmapCache& GetBitmapCache();
 	GOrguePipeConfigNode& GetPipeConfig();
@@ -207,6 +227,12 @@ public:
 	uint64_t StopSample(const GOSoundProvider *pipe, GO_SAMPLER* handle);
 	void SwitchSample(const GOSoundProvider *pipe, GO_SAMPLER* handle);
 	void UpdateVelocity(GO_SAMPLER* handle, unsigned velocity);
+	GOSoundEngine* GetSoundEngine();
+	unsigned GetStreamUnderruns();
+	unsigned GetStolenSamplers();
+	unsigned GetDroppedSamplers();
+	unsigned GetTransactionSize();
+	unsigned GetTransactionTime();
 
 	void SendMidiMessage(GOrgueMidiEvent& e);
 	void SendMidiRecorderMessage(GOrgueMidiEvent& e);
@@ -657,7 +657,10 @@ void GOrgueFrame::OnTemperament(wxCommandEvent& event)
 	unsigned id = event.GetId() - ID_TEMPERAMENT_0;
 	GOrgueDocument* doc = GetDocument();
 	if (doc && doc->GetOrganFile() && id < m_Settings.GetTemperaments().GetTemperamentCount())
+	{
+		GOMutexLocker locker(doc->GetOrganFile()->GetModelLock());
 		doc->GetOrganFile()->SetTemperament(m_Settings.GetTemperaments().GetTemperament(id).GetName());
+	}
 }
 
 void GOrgueFrame::OnLoadFile(wxCommandEvent& event)
@@ -892,7 +895,10 @@ void GOrgueFrame::OnAudioMemset(wxCommandEvent& WXUNUSED(event))
 {
 	GOrgueDocument* doc = GetDocument();
 	if (doc && doc->GetOrganFile())
+	{
+		GOMutexLocker locker(doc->GetOrganFile()->GetModelLock());
 		doc->GetOrganFile()->GetSetter()->ToggleSetter();
+	}
 }
 
 void GOrgueFrame::SetEventAfterSettings(
@@ -1011,7 +1017,10 @@ void GOrgueFrame::OnSettingsMemoryEnter(wxCommandEvent& event)
 
 	GOrgueDocument* doc = GetDocument();
 	if (doc && doc->GetOrganFile())
+	{
+		GOMutexLocker locker(doc->GetOrganFile()->GetModelLock());
 		doc->GetOrganFile()->GetSetter()->SetPosition(n);
+	}
 }
 
 void GOrgueFrame::OnSettingsMemory(wxCommandEvent& event)
@@ -1020,7 +1029,10 @@ void GOrgueFrame::OnSettingsMemory(wxCommandEvent& event)
 
 	GOrgueDocument* doc = GetDocument();
 	if (doc && doc->GetOrganFile())
+	{
+		GOMutexLocker locker(doc->GetOrganFile()->GetModelLock());
 		doc->GetOrganFile()->GetSetter()->UpdatePosition(n);
+	}
 }
 
 void GOrgueFrame::OnSettingsTranspose(wxCommandEvent& event)
@@ -1030,7 +1042,10 @@ void GOrgueFrame::OnSettingsTranspose(wxCommandEvent& event)
 	m_Settings.Transpose(n);
 	GOrgueDocument* doc = GetDocument();
 	if (doc && doc->GetOrganFile())
+	{
+		GOMutexLocker locker(doc->GetOrganFile()->GetModelLock());
 		doc->GetOrganFile()->GetSetter()->SetTranspose(n);
+	}
 }
 
 void GOrgueFrame::OnSettingsReleaseLength(wxCommandEvent& event)
@@ -0,0 +1,272 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#include "GrandOrgueRender.h"
+
+#include "ptrvector.h"
+#include "GOSoundDefs.h"
+#include "GOSoundEngine.h"
+#include "GOSoundRecorder.h"
+#include "GOSoundScheduler.h"
+#include "GOSoundThread.h"
+#include "GOrgueMidiEvent.h"
+#include "GOrgueMidiFileReader.h"
+#include "GOrgueMidiMap.h"
+#include "GOrgueOrgan.h"
+#include "GOrgueProgressDialog.h"
+#include "GOrgueSettings.h"
+#include "GOrgueStdPath.h"
+#include "GrandOrgueDef.h"
+#include "GrandOrgueFile.h"
+#include <wx/filename.h>
+#include <wx/image.h>
+#include <wx/log.h>
+#include <wx/stopwatch.h>
+
+IMPLEMENT_APP_CONSOLE(GOrgueRender)
+
+const wxCmdLineEntryDesc GOrgueRender::m_cmdLineDesc [] = {
+	{ wxCMD_LINE_SWITCH, wxTRANSLATE("h"), wxTRANSLATE("help"), wxTRANSLATE("displays help on the command line parameters"), wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
+	{ wxCMD_LINE_OPTION, wxTRANSLATE("b"), wxTRANSLATE("bits"), wxTRANSLATE("bits per sample of the WAV file (8, 16, 24 or 32 for float)"), wxCMD_LINE_VAL_NUMBER, wxCMD_LINE_PARAM_OPTIONAL },
+	{ wxCMD_LINE_OPTION, wxTRANSLATE("p"), wxTRANSLATE("period"), wxTRANSLATE("samples per render period"), wxCMD_LINE_VAL_NUMBER, wxCMD_LINE_PARAM_OPTIONAL },
+	{ wxCMD_LINE_OPTION, wxTRANSLATE("t"), wxTRANSLATE("tail"), wxTRANSLATE("seconds rendered after the last event"), wxCMD_LINE_VAL_NUMBER, wxCMD_LINE_PARAM_OPTIONAL },
+	{ wxCMD_LINE_OPTION, wxTRANSLATE("j"), wxTRANSLATE("threads"), wxTRANSLATE("number of sound threads"), wxCMD_LINE_VAL_NUMBER, wxCMD_LINE_PARAM_OPTIONAL },
+	{ wxCMD_LINE_PARAM, NULL, NULL, wxTRANSLATE("organ definition file"), wxCMD_LINE_VAL_STRING, 0 },
+	{ wxCMD_LINE_PARAM, NULL, NULL, wxTRANSLATE("MIDI file"), wxCMD_LINE_VAL_STRING, 0 },
+	{ wxCMD_LINE_PARAM, NULL, NULL, wxTRANSLATE("output WAV file"), wxCMD_LINE_VAL_STRING, 0 },
+	{ wxCMD_LINE_NONE }
+};
+
+GOrgueRender::GOrgueRender() :
+	m_ODF(),
+	m_MidiFile(),
+	m_Output(),
+	m_Period(32),
+	m_Tail(5),
+	m_BytesPerSample(0),
+	m_Threads(0),
+	m_Content()
+{
+}
+
+bool GOrgueRender::OnInit()
+{
+	wxLog::SetActiveTarget(new wxLogStderr());
+	wxImage::AddHandler(new wxJPEGHandler);
+	wxImage::AddHandler(new wxGIFHandler);
+	wxImage::AddHandler(new wxPNGHandler);
+	wxImage::AddHandler(new wxBMPHandler);
+	wxImage::AddHandler(new wxICOHandler);
+
+	GOrgueStdPath::InitLocaleDir();
+	m_locale.Init(wxLANGUAGE_DEFAULT);
+	m_locale.AddCatalog(wxT("GrandOrgue"));
+
+	return wxApp::OnInit();
+}
+
+void GOrgueRender::OnInitCmdLine(wxCmdLineParser& parser)
+{
+	parser.SetLogo(wxString::Format(_("GrandOrgueRender %s"), wxT(APP_VERSION)));
+	parser.SetDesc (m_cmdLineDesc);
+}
+
+bool GOrgueRender::OnCmdLineParsed(wxCmdLineParser& parser)
+{
+	long value;
+
+	m_ODF = parser.GetParam(0);
+	m_MidiFile = parser.GetParam(1);
+	m_Output = parser.GetParam(2);
+
+	if (parser.Found(wxT("b"), &value))
+	{
+		if (value != 8 && value != 16 && value != 24 && value != 32)
+		{
+			wxLogError(_("Unsupported sample format: %ld bits"), value);
+			return false;
+		}
+		m_BytesPerSample = value / 8;
+	}
+	if (parser.Found(wxT("p"), &value))
+	{
+		if (value < 1 || value > MAX_FRAME_SIZE)
+		{
+			wxLogError(_("Render period must be between 1 and %d samples"), MAX_FRAME_SIZE);
+			return false;
+		}
+		m_Period = value;
+	}
+	if (parser.Found(wxT("t"), &value))
+		m_Tail = value < 0 ? 0 : value;
+	if (parser.Found(wxT("j"), &value))
+		m_Threads = value < 1 ? 1 : value;
+	return true;
+}
+
+int GOrgueRender::OnRun()
+{
+	return Render() ? 0 : 1;
+}
+
+/* Applies the events up to the sample position limit, returns false once
+ * the file is exhausted */
+bool GOrgueRender::ProcessEvents(GrandOrgueFile* organfile, unsigned device, unsigned sample_rate, uint64_t limit)
+{
+	do
+	{
+		GOrgueMidiEvent e = m_Content.GetCurrentEvent();
+		if ((uint64_t)e.GetTime().GetValue() * sample_rate / 1000 >= limit)
+			return true;
+		e.SetDevice(device);
+		organfile->ProcessMidi(e);
+	}
+	while(m_Content.Next());
+	return false;
+}
+
+void GOrgueRender::AllNotesOff(GrandOrgueFile* organfile, unsigned device)
+{
+	for(unsigned i = 1; i < 16; i++)
+	{
+		GOrgueMidiEvent e;
+		e.SetMidiType(MIDI_CTRL_CHANGE);
+		e.SetChannel(i);
+		e.SetKey(MIDI_CTRL_NOTES_OFF);
+		e.SetValue(0);
+		e.SetDevice(device);
+		organfile->ProcessMidi(e);
+	}
+}
+
+/* Every period is finished completely before the events of the next one
+ * are applied. The time reference maps the MIDI time to the frame count,
+ * so an event starts at its ms position inside the period, independent of
+ * the thread timing. The sound threads only work inside a period, exactly
+ * like with an audio device. */
+bool GOrgueRender::Render()
+{
+	GOrgueSettings settings(wxEmptyString);
+	settings.Load();
+
+	GOrgueMidiFileReader reader(settings.GetMidiMap());
+	if (!reader.Open(m_MidiFile))
+	{
+		wxLogError(_("Failed to load %s"), m_MidiFile.c_str());
+		return false;
+	}
+
+	wxFileName odf(m_ODF);
+	odf.MakeAbsolute();
+	GrandOrgueFile* organfile = new GrandOrgueFile(NULL, settings);
+	GOrgueProgressDialog dlg(false);
+	wxString error = organfile->Load(&dlg, GOrgueOrgan(odf.GetFullPath()));
+	if (!error.IsEmpty())
+	{
+		wxLogError(wxT("%s"), error.c_str());
+		delete organfile;
+		return false;
+	}
+
+	if (!m_Content.Load(reader, settings.GetMidiMap(), organfile->GetODFManualCount() - 1, organfile->GetFirstManualIndex() == 0) || !m_Content.IsLoaded())
+	{
+		wxLogError(_("Failed to load %s"), m_MidiFile.c_str());
+		delete organfile;
+		return false;
+	}
+	if (!reader.Close())
+	{
+		wxLogError(_("Failed to decode %s"), m_MidiFile.c_str());
+		delete organfile;
+		return false;
+	}
+	unsigned device = settings.GetMidiMap().GetDeviceByString(_("GrandOrgue MIDI Player"));
+
+	unsigned sample_rate = settings.SampleRate();
+	unsigned audio_group_count = settings.GetAudioGroups().size();
+	GOSoundEngine engine;
+	GOSoundRecorder recorder;
+	ptr_vector<GOSoundThread> threads;
+
+	engine.SetSamplesPerBuffer(m_Period);
+	engine.SetPolyphonyLimiting(settings.ManagePolyphony());
+	engine.SetHardPolyphony(settings.PolyphonyLimit());
+	engine.SetScaledReleases(settings.ScaleRelease());
+	engine.SetRandomizeSpeaking(settings.RandomizeSpeaking());
+	engine.SetInterpolationType(settings.InterpolationType());
+	engine.SetAudioGroupCount(audio_group_count);
+	engine.SetSampleRate(sample_rate);
+	engine.SetAudioOutput(std::vector<GOAudioOutputConfiguration>());
+	engine.SetupReverb(settings);
+	engine.SetAudioRecorder(&recorder, true);
+	engine.SetVolume(organfile->GetVolume());
+	engine.Setup(organfile, settings.ReleaseConcurrency());
+
+	recorder.SetBytesPerSample(m_BytesPerSample ? m_BytesPerSample : settings.WaveFormatBytesPerSample());
+	recorder.SetSampleRate(sample_rate);
+	organfile->PreparePlayback(&engine, NULL, &recorder);
+	/* The event times of the file map directly to sample positions */
+	engine.SetTimeReference(0, 0);
+	recorder.Open(m_Output);
+	if (!recorder.IsOpen())
+	{
+		organfile->Abort();
+		engine.ClearSetup();
+		delete organfile;
+		return false;
+	}
+
+	m_Content.Reset();
+	bool pending = ProcessEvents(organfile, device, sample_rate, m_Period);
+	if (!pending)
+		AllNotesOff(organfile, device);
+	uint64_t end = pending ? 0 : (uint64_t)m_Tail * sample_rate;
+
+	unsigned thread_count = m_Threads ? m_Threads : settings.Concurrency();
+	engine.GetScheduler().SetThreadCount(thread_count);
+	for(unsigned i = 0; i < thread_count; i++)
+		threads.push_back(new GOSoundThread(&engine.GetScheduler(), i));
+	for(unsigned i = 0; i < threads.size(); i++)
+		threads[i]->Run();
+
+	wxStopWatch watch;
+	while(pending || engine.GetTime() < end)
+	{
+		engine.GetScheduler().Exec();
+		uint64_t next = engine.GetTime() + m_Period;
+		if (pending)
+		{
+			pending = ProcessEvents(organfile, device, sample_rate, next + m_Period);
+			if (!pending)
+			{
+				AllNotesOff(organfile, device);
+				end = next + (uint64_t)m_Tail * sample_rate;
+			}
+		}
+		engine.NextPeriod();
+		for(unsigned i = 0; i < threads.size(); i++)
+			threads[i]->Wakeup();
+	}
+	long elapsed = watch.Time();
+
+	for(unsigned i = 0; i < threads.size(); i++)
+		threads[i]->Delete();
+	threads.resize(0);
+	recorder.Close();
+	organfile->Abort();
+	engine.ClearSetup();
+	delete organfile;
+
+	if (engine.GetStreamUnderruns())
+		wxLogMessage(_("%u chunks were not streamed in time"), engine.GetStreamUnderruns());
+	if (engine.GetStolenSamplers())
+		wxLogMessage(_("%u releases were stolen at the polyphony limit"), engine.GetStolenSamplers());
+	if (engine.GetDroppedSamplers())
+		wxLogMessage(_("%u samplers were dropped at the polyphony limit"), engine.GetDroppedSamplers());
+	double rendered = engine.GetTime() / (double)sample_rate;
+	wxLogMessage(_("Rendered %.1f seconds in %.1f seconds (%.1fx realtime, %d threads)"), rendered, elapsed / 1000.0, elapsed ? rendered * 1000.0 / elapsed : 0.0, thread_count);
+	return true;
+}
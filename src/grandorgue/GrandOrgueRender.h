@@ -0,0 +1,50 @@
+/*
+* Copyright 2006 Milan Digital Audio LLC
+* Copyright 2009-2021 GrandOrgue contributors (see AUTHORS)
+* License GPL-2.0 or later (https://www.gnu.org/licenses/old-licenses/gpl-2.0.html).
+*/
+
+#ifndef GRANDORGUERENDER_H
+#define GRANDORGUERENDER_H
+
+#include "GOrgueMidiPlayerContent.h"
+#include <wx/app.h>
+#include <wx/cmdline.h>
+#include <stdint.h>
+
+class GrandOrgueFile;
+
+/* Renders a MIDI file with an organ into a WAV file without any audio
+ * device. The engine is driven as fast as the sound threads allow. */
+class GOrgueRender : public wxApp
+{
+private:
+	wxLocale m_locale;
+	static const wxCmdLineEntryDesc m_cmdLineDesc [];
+
+	wxString m_ODF;
+	wxString m_MidiFile;
+	wxString m_Output;
+	unsigned m_Period;
+	unsigned m_Tail;
+	unsigned m_BytesPerSample;
+	unsigned m_Threads;
+
+	GOrgueMidiPlayerContent m_Content;
+
+	bool OnInit();
+	int OnRun();
+	void OnInitCmdLine(wxCmdLineParser& parser);
+	bool OnCmdLineParsed(wxCmdLineParser& parser);
+
+	bool ProcessEvents(GrandOrgueFile* organfile, unsigned device, unsigned sample_rate, uint64_t limit);
+	void AllNotesOff(GrandOrgueFile* organfile, unsigned device);
+	bool Render();
+
+public:
+	GOrgueRender();
+};
+
+DECLARE_APP(GOrgueRender)
+
+#endif
@@ -170,6 +170,7 @@ OrganDialog::OrganDialog (GOrgueDocumentBase* doc, wxWindow* parent, GrandOrgueF
 	choices.push_back(_("Parent default"));
 	choices.push_back(_("Disabled"));
 	choices.push_back(_("Enabled"));
+	choices.push_back(_("Enabled, block codec"));
 	grid->Add(new wxStaticText(scroll, wxID_ANY, _("Lossless compression:")), 0, wxALIGN_RIGHT | wxALIGN_CENTER_VERTICAL | wxBOTTOM, 5);
 	m_Compress = new wxChoice(scroll, ID_EVENT_COMPRESS, wxDefaultPosition, wxDefaultSize, choices);
 	grid->Add(m_Compress);
@@ -143,6 +143,10 @@ SettingsAudioOutput::SettingsAudioOutput(GOrgueSound& sound, GOAudioGroupCallbac
 	grid->Add(m_SamplesPerBuffer = new wxSpinCtrl(this, ID_SAMPLES_PER_BUFFER, wxEmptyString, wxDefaultPosition, wxDefaultSize), 0, wxALL);
 	m_SamplesPerBuffer->SetRange(1, MAX_FRAME_SIZE);
 	m_SamplesPerBuffer->SetValue(m_Settings.SamplesPerBuffer());
+	grid->Add(new wxStaticText(this, wxID_ANY, _("Periods rendered ahead:")), 0, wxALL | wxALIGN_CENTER_VERTICAL);
+	grid->Add(m_PrerenderPeriods = new wxSpinCtrl(this, ID_PRERENDER_PERIODS, wxEmptyString, wxDefaultPosition, wxDefaultSize), 0, wxALL);
+	m_PrerenderPeriods->SetRange(0, MAX_PRERENDER_PERIODS);
+	m_PrerenderPeriods->SetValue(m_Settings.PrerenderPeriods());
 
 	m_SampleRate->Select(0);
 	for(unsigned i = 0; i < m_SampleRate->GetCount(); i++)
@@ -685,6 +689,7 @@ void SettingsAudioOutput::Save()
   else
 	  wxLogError(_("Invalid sample rate"));
   m_Settings.SamplesPerBuffer(m_SamplesPerBuffer->GetValue());
+  m_Settings.PrerenderPeriods(m_PrerenderPeriods->GetValue());
   
   m_Sound.GetSettings().SetPortsConfig(RenewSoundPortsConfig());
   
@@ -34,7 +34,8 @@ class SettingsAudioOutput : public wxPanel
 		ID_OUTPUT_DEFAULT,
 		ID_SOND_PORTS,
 		ID_SAMPLE_RATE,
-		ID_SAMPLES_PER_BUFFER
+		ID_SAMPLES_PER_BUFFER,
+		ID_PRERENDER_PERIODS
 	};
 
 private:
@@ -45,6 +46,7 @@ private:
 	
 	wxChoice* m_SampleRate;
 	wxSpinCtrl* m_SamplesPerBuffer;
+	wxSpinCtrl* m_PrerenderPeriods;
 	
 	wxTreeListCtrl* m_SoundPorts;
 	wxTreeCtrl* m_AudioOutput;
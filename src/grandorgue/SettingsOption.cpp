@@ -14,7 +14,6 @@
 #include <wx/choice.h>
 #include <wx/filepicker.h>
 #include <wx/log.h>
-#include <wx/msgdlg.h>
 #include <wx/spinctrl.h>
 #include <wx/stattext.h>
 
@@ -31,6 +30,7 @@ SettingsOption::SettingsOption(GOrgueSettings& settings, wxWindow* parent) :
 	m_OldLoopLoad = m_Settings.LoopLoad();
 	m_OldAttackLoad = m_Settings.AttackLoad();
 	m_OldReleaseLoad = m_Settings.ReleaseLoad();
+	m_OldDiskStreaming = m_Settings.DiskStreaming();
 
 	wxBoxSizer* topSizer = new wxBoxSizer(wxVERTICAL);
 	wxBoxSizer* item0 = new wxBoxSizer(wxHORIZONTAL);
@@ -198,8 +198,10 @@ SettingsOption::SettingsOption(GOrgueSettings& settings, wxWindow* parent) :
 	item9->Add(item6, 0, wxEXPAND | wxALL, 5);
 	item6->Add(m_CompressCache  = new wxCheckBox(this, ID_COMPRESS_CACHE, _("Compress cache")), 0, wxEXPAND | wxALL, 5);
 	item6->Add(m_ManageCache  = new wxCheckBox(this, ID_MANAGE_CACHE, _("Automatically manage cache")), 0, wxEXPAND | wxALL, 5);
+	item6->Add(m_DiskStreaming  = new wxCheckBox(this, ID_DISK_STREAMING, _("Stream samples from the cache")), 0, wxEXPAND | wxALL, 5);
 	m_CompressCache->SetValue(m_Settings.CompressCache());
 	m_ManageCache->SetValue(m_Settings.ManageCache());
+	m_DiskStreaming->SetValue(m_Settings.DiskStreaming());
 
 	item9->Add(m_ODFCheck  = new wxCheckBox(this, ID_ODF_CHECK, _("Perform strict ODF")), 0, wxEXPAND | wxALL, 5);
 	m_ODFCheck->SetValue(m_Settings.ODFCheck());
@@ -214,13 +216,11 @@ SettingsOption::SettingsOption(GOrgueSettings& settings, wxWindow* parent) :
 
 void SettingsOption::Save()
 {
-	if (m_Interpolation->GetSelection() == 1 && m_LosslessCompression->IsChecked())
-		wxMessageBox(_("Polyphase is not supported with lossless compression - falling back to linear.") , _("Warning"), wxOK | wxICON_WARNING, this);
-
 	m_Settings.LosslessCompression(m_LosslessCompression->IsChecked());
 	m_Settings.ManagePolyphony(m_Limit->IsChecked());
 	m_Settings.CompressCache(m_CompressCache->IsChecked());
 	m_Settings.ManageCache(m_ManageCache->IsChecked());
+	m_Settings.DiskStreaming(m_DiskStreaming->IsChecked());
 	m_Settings.LoadLastFile(m_LoadLastFile->GetCurrentSelection());
 	m_Settings.ODFCheck(m_ODFCheck->IsChecked());
 	m_Settings.RecordDownmix(m_RecordDownmix->IsChecked());
@@ -252,7 +252,8 @@ bool SettingsOption::NeedReload()
 		m_OldLoopLoad != m_Settings.LoopLoad() || 
 		m_OldAttackLoad != m_Settings.AttackLoad() ||
 		m_OldReleaseLoad != m_Settings.ReleaseLoad() ||
-		m_OldChannels != m_Settings.LoadChannels();
+		m_OldChannels != m_Settings.LoadChannels() ||
+		m_OldDiskStreaming != m_Settings.DiskStreaming();
 }
 
 bool SettingsOption::NeedRestart()
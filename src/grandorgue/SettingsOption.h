@@ -28,6 +28,7 @@ class SettingsOption : public wxPanel
 		ID_MANAGE_POLYPHONY,
 		ID_COMPRESS_CACHE,
 		ID_MANAGE_CACHE,
+		ID_DISK_STREAMING,
 		ID_SCALE_RELEASE,
 		ID_LOAD_LAST_FILE,
 		ID_RANDOMIZE,
@@ -54,6 +55,7 @@ private:
 	wxCheckBox* m_Limit;
 	wxCheckBox* m_CompressCache;
 	wxCheckBox* m_ManageCache;
+	wxCheckBox* m_DiskStreaming;
 	GOrgueChoice<GOInitialLoadType>* m_LoadLastFile;
 	wxCheckBox* m_Scale;
 	wxCheckBox* m_Random;
@@ -77,6 +79,7 @@ private:
 	unsigned m_OldLoopLoad;
 	unsigned m_OldAttackLoad;
 	unsigned m_OldReleaseLoad;
+	bool m_OldDiskStreaming;
 
 public:
 	SettingsOption(GOrgueSettings& settings, wxWindow* parent);
@@ -254,7 +254,22 @@ int Convproc::reset (void)
 }
 
 
-int Convproc::start_process (int abspri, int policy)
+int Convproc::set_sched (unsigned int level, Convsched *sched)
+{
+    if (_state != ST_STOP) return Converror::BAD_STATE;
+    if ((level < first_sched_level ()) || (level >= _nlevels)) return Converror::BAD_PARAM;
+    _convlev [level]->_sched = sched;
+    return 0;
+}
+
+
+void Convproc::process_level (unsigned int level)
+{
+    _convlev [level]->process (false);
+}
+
+
+int Convproc::start_process (void)
 {
     unsigned int k;
 
@@ -264,9 +279,9 @@ int Convproc::start_process (int abspri, int policy)
     _inpoffs = 0;
     _outoffs = 0;
     reset ();
-    for (k = (_minpart == _quantum) ? 1 : 0; k < _nlevels; k++)
+    for (k = first_sched_level (); k < _nlevels; k++)
     {
-         _convlev [k]->start (abspri, policy);
+         _convlev [k]->start ();
     }
     _state = ST_PROC;
     return 0;
@@ -288,7 +303,7 @@ int Convproc::process (bool sync)
     {
         _outoffs = 0;
 	for (k = 0; k < _nout; k++) memset (_outbuff [k], 0, _minpart * sizeof (float));
-	for (k = 0; k < _nlevels; k++) f |= _convlev [k]->readout (sync, _skipcnt);
+	for (k = 0; k < _nlevels; k++) f |= _convlev [k]->readout (_skipcnt, 0, 1);
 	if (_skipcnt < _minpart) _skipcnt = 0;
 	else _skipcnt -= _minpart;
         if (f)
@@ -303,6 +318,46 @@ int Convproc::process (bool sync)
 }
 
 
+// The input is copied into the input buffers. If every quantum is a
+// complete output cycle, the levels add their output directly into data,
+// otherwise it is copied from the output buffers.
+int Convproc::process (float *data, unsigned int stride)
+{
+    unsigned int i, k;
+    float *p;
+    int f = 0;
+
+    if (_state != ST_PROC) return 0;
+
+    for (k = 0; k < _ninp; k++)
+    {
+        p = _inpbuff [k] + _inpoffs;
+        for (i = 0; i < _quantum; i++) p [i] = data [k + i * stride];
+    }
+
+    if (_minpart != _quantum)
+    {
+        f = process (false);
+        for (k = 0; k < _nout; k++)
+        {
+            p = _outbuff [k] + _outoffs;
+            for (i = 0; i < _quantum; i++) data [k + i * stride] = p [i];
+        }
+        return f;
+    }
+
+    _inpoffs += _quantum;
+    if (_inpoffs == _inpsize) _inpoffs = 0;
+
+    for (k = 0; k < _nout; k++)
+        for (i = 0; i < _quantum; i++) data [k + i * stride] = 0;
+    for (k = 0; k < _nlevels; k++) f |= _convlev [k]->readout (_skipcnt, data, stride);
+    if (_skipcnt < _minpart) _skipcnt = 0;
+    else _skipcnt -= _minpart;
+    return f;
+}
+
+
 int Convproc::stop_process (void)
 {
     unsigned int k;
@@ -318,10 +373,7 @@ int Convproc::cleanup (void)
 {
     unsigned int k;
 
-    while (! check_stop ())
-    {
-	    wxMilliSleep (100);
-    }
+    check_stop ();
     if (_state != ST_STOP)
     {
         return Converror::BAD_STATE;
@@ -389,6 +441,8 @@ Convlevel::Convlevel (void) :
     _npar (0),
     _parsize (0),
     _options (0),
+    _wait (0),
+    _sched (0),
     _inp_list (0),
     _out_list (0),
     _plan_r2c (0),
@@ -566,6 +620,7 @@ void Convlevel::reset (unsigned int  inpsize,
     Inpnode      *X; 
     Outnode      *Y; 
 
+    if (_wait) _sched->finish ();
     _inpsize = inpsize;
     _outsize = outsize;
     _inpbuff = inpbuff;
@@ -598,14 +653,12 @@ void Convlevel::reset (unsigned int  inpsize,
     _wait = 0;
     _ptind = 0;
     _opind = 0;
-    _trig.init (0, 0);
-    _done.init (0, 0);
 }
 
 
-void Convlevel::start (int abspri, int policy)
+void Convlevel::start (void)
 {
-	Start();
+    if (_sched) _stat = ST_PROC;
 }
 
 
@@ -613,8 +666,9 @@ void Convlevel::stop (void)
 {
     if (_stat != ST_IDLE)
     {
-        _stat = ST_TERM;
-	_trig.post ();
+        if (_wait) _sched->finish ();
+        _wait = 0;
+        _stat = ST_IDLE;
     }
 }
 
@@ -627,7 +681,6 @@ void Convlevel::cleanup (void)
     Macnode       *M, *M1;
 
     stop ();
-    Stop ();
     X = _inp_list;
     while (X)
     {
@@ -677,29 +730,6 @@ void Convlevel::cleanup (void)
 }
 
 
-void Convlevel::Entry()
-{
-    main ();
-}
-
-
-void Convlevel::main (void)
-{
-    _stat = ST_PROC;
-    while (true)
-    {
-	_trig.wait ();
-	if (_stat == ST_TERM)
-	{
-            _stat = ST_IDLE;
-            return;
-        }
-	process (false);
-	_done.post ();
-    }
-}
-
-
 void Convlevel::process (bool skip)
 {
     unsigned int    i, j, k;
@@ -810,7 +840,9 @@ void Convlevel::process (bool skip)
 }
 
 
-int Convlevel::readout (bool sync, unsigned int skipcnt)
+// Adds the output to the output buffers, or to data with the given
+// stride if data is set
+int Convlevel::readout (unsigned int skipcnt, float *data, unsigned int stride)
 {
     unsigned int  i;
     float         *p, *q;	
@@ -822,15 +854,10 @@ int Convlevel::readout (bool sync, unsigned int skipcnt)
 	_outoffs = 0;
 	if (_stat == ST_PROC)
 	{
-   	    while (_wait)
-	    {
-		if (sync) _done.wait ();
-		else if (_done.trywait ()) break;
-  	        _wait--;
-	    }
+	    if (_wait) _sched->finish ();
 	    if (++_opind == 3) _opind = 0;
-            _trig.post ();
-	    _wait++;
+            _wait = 1;
+            _sched->trigger ();
 	}
         else
 	{
@@ -842,11 +869,19 @@ int Convlevel::readout (bool sync, unsigned int skipcnt)
     for (Y = _out_list; Y; Y = Y->_next)
     {
         p = Y->_buff [_opind] + _outoffs;
-        q = _outbuff [Y->_out];
-        for (i = 0; i < _outsize; i++) q [i] += p [i];
+        if (data)
+        {
+            q = data + Y->_out;
+            for (i = 0; i < _outsize; i++) q [i * stride] += p [i];
+        }
+        else
+        {
+            q = _outbuff [Y->_out];
+            for (i = 0; i < _outsize; i++) q [i] += p [i];
+        }
     }
 
-    return (_wait > 1) ? _bits : 0;
+    return 0;
 }
 
 
@@ -23,26 +23,21 @@
 #define _ZITA_CONVOLVER_H
 
 
-#include <wx/wx.h>
-#include "threading/GOrgueThread.h"
+#include <stdio.h>
 #include "fftw3.h"
 
-class ZCsema
+// Runs the cycles of a partition level outside of Convproc::process().
+// trigger() is called once a cycle may be processed by process_level(),
+// finish() must not return before that cycle has been processed.
+class Convsched
 {
-	wxSemaphore m_sema;
 public:
 
-    ZCsema (void) {  }
-    ~ZCsema (void) { }
+    virtual ~Convsched (void) {}
 
-    ZCsema (const ZCsema&); // disabled
-    ZCsema& operator= (const ZCsema&); // disabled
-
-    void init (int s, int v) { assert(s == 0); assert(v == 0); }
-    void post (void) { m_sema.Post(); }
-    void wait (void) { m_sema.Wait(); }
-    int trywait (void) { return (m_sema.TryWait() == wxSEMA_NO_ERROR); }
+    virtual void trigger (void) = 0;
 
+    virtual void finish (void) = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -108,7 +103,7 @@ private:
 };
 
 
-class Convlevel : private GOrgueThread
+class Convlevel
 {
 private:
 
@@ -162,11 +157,11 @@ private:
 	        float **inpbuff,
 	        float **outbuff);
 
-    void start (int absprio, int policy);
+    void start (void);
 
     void process (bool sync);
 
-    int  readout (bool sync, unsigned int skipcnt);
+    int  readout (unsigned int skipcnt, float *data, unsigned int stride);
 
     void stop (void);
 
@@ -176,10 +171,6 @@ private:
 
     void print (FILE *F);
 
-    void Entry();
-
-    void main (void);
-
     Macnode *findmacnode (unsigned int inp, unsigned int out, bool create);
 
     volatile unsigned int _stat;           // current processing state
@@ -196,8 +187,7 @@ private:
     unsigned int          _opind;          // rotating output buffer index
     int                   _bits;           // bit identifiying this level
     int                   _wait;           // number of unfinished cycles
-    ZCsema                _trig;           // sema used to trigger a cycle
-    ZCsema                _done;           // sema used to wait for a cycle
+    Convsched            *_sched;          // runs the cycles, if not inline
     Inpnode              *_inp_list;       // linked list of active inputs
     Outnode              *_out_list;       // linked list of active outputs
     fftwf_plan            _plan_r2c;       // FFTW plan, forward FFT
@@ -301,10 +291,29 @@ public:
 
     int reset (void);
 
-    int start_process (int abspri, int policy);
+    unsigned int levels (void) const
+    {
+	return _nlevels;
+    }
+
+    // Levels from this one on may be run by a Convsched
+    unsigned int first_sched_level (void) const
+    {
+	return (_minpart == _quantum) ? 1 : 0;
+    }
+
+    // Without a Convsched, a level is processed inline by process()
+    int set_sched (unsigned int level, Convsched *sched);
+
+    void process_level (unsigned int level);
+
+    int start_process (void);
 
     int process (bool sync = false);
 
+    // Convolve one quantum of interleaved frames in place
+    int process (float *data, unsigned int stride);
+
     int stop_process (void);
 
     bool check_stop (void);
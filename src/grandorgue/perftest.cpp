@@ -5,16 +5,35 @@
 */
 
 #include "ptrvector.h"
+#include "GOSoundAudioSection.h"
+#include "GOSoundCompress.h"
 #include "GOSoundEngine.h"
+#include "GOSoundFader.h"
 #include "GOSoundProviderWave.h"
 #include "GOSoundRecorder.h"
+#include "GOrgueEventDistributor.h"
+#include "GOrgueEventHandler.h"
+#include "GOrgueMidiEvent.h"
+#include "GOrgueMidiReceiverBase.h"
+#include "GOrgueMemoryPool.h"
 #include "GOrgueSettings.h"
+#include "GOrgueWave.h"
+#include "GOrgueWaveTypes.h"
 #include "GOrgueWindchest.h"
 #include "GrandOrgueFile.h"
 #include <wx/app.h>
 #include <wx/image.h>
 #include <wx/stopwatch.h>
+#include <chrono>
 #include <iostream>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT wxT("cycles")
+#else
+#define CYCLE_UNIT wxT("ns")
+#endif
 
 #ifdef __linux__
 #include <sys/time.h>
@@ -29,9 +48,25 @@ public:
 	TestApp();
 	bool OnInit();
 	int OnRun();
-	void RunTest(unsigned bits_per_sample, bool compress, unsigned sample_instances, unsigned sample_rate, unsigned interpolation, unsigned samples_per_frame);
+	void RunTest(unsigned bits_per_sample, bool compress, unsigned sample_instances, unsigned sample_rate, unsigned interpolation, unsigned samples_per_frame, unsigned voices = 0);
+	double RunKernel(DecodeBlockFunction decode, audio_section_stream& stream, float* output, unsigned n_frames);
+	void RunKernelTest(unsigned channels, unsigned bits_per_sample);
+	double RunMix(bool fused, DecodeBlockFunction decode, std::vector<audio_section_stream>& streams, std::vector<GOSoundFader>& faders, float* output, unsigned n_frames);
+	void RunMixTest(unsigned voices, unsigned n_frames);
+	void RunAllocTest(unsigned threads);
+	void RunWaveTest(unsigned bits_per_sample, bool packed);
+	void RunMidiTest(unsigned manuals, unsigned stops);
 };
 
+static uint64_t getCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 DECLARE_APP(TestApp)
 IMPLEMENT_APP_CONSOLE(TestApp)
 
@@ -54,8 +89,10 @@ wxMilliClock_t TestApp::getCPUTime()
 	return wxGetLocalTimeMillis();
 }
 
-void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_instances, unsigned sample_rate, unsigned interpolation, unsigned samples_per_frame)
+void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_instances, unsigned sample_rate, unsigned interpolation, unsigned samples_per_frame, unsigned voices)
 {
+	if (!voices)
+		voices = sample_instances;
 	try
 	{
 		GOrgueSettings settings(wxT("perftest"));
@@ -86,7 +123,7 @@ void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_i
 				ainfo.release_end = -1;
 				ainfo.loops.clear();
 				attack.push_back(ainfo);
-				w->LoadFromFile(attack, release, bits_per_sample, 2, compress, LOOP_LOAD_ALL, 1, 1, -1, 0, 0);
+				w->LoadFromFile(attack, release, bits_per_sample, 2, compress ? GO_COMPRESSION_PREDICTIVE : GO_COMPRESSION_NONE, LOOP_LOAD_ALL, 1, 1, -1, 0, 0);
 				pipes.push_back(w);
 			}
 			engine->SetSamplesPerBuffer(samples_per_frame);
@@ -116,9 +153,9 @@ void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_i
 			std::vector<GO_SAMPLER*> handles;
 			float output_buffer[samples_per_frame * 2];
 
-			for(unsigned i = 0; i < pipes.size(); i++)
+			for(unsigned i = 0; i < voices; i++)
 			{
-				GO_SAMPLER* handle = engine->StartSample(pipes[i], 1, 0, 127, 0, 0);
+				GO_SAMPLER* handle = engine->StartSample(pipes[i % pipes.size()], 1, 0, 127, 0, 0);
 				if (handle)
 					handles.push_back(handle);
 			}
@@ -142,9 +179,9 @@ void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_i
 			while(diff < 30000);
 			
 			float playback_time = blocks * (double)samples_per_frame / engine->GetSampleRate();
-			wxLogError(wxT("%d sampler, %f seconds, %d bits, %d, %s, %s, %d block: %d ms cpu time, limit: %f"), pipes.size(), playback_time, 
+			wxLogError(wxT("%d sampler, %f seconds, %d bits, %d, %s, %s, %d block: %d ms cpu time, limit: %f"), handles.size(), playback_time, 
 				   bits_per_sample, sample_rate, compress ? wxT("Y") : wxT("N"), interpolation == 0 ? wxT("Linear") : wxT("Polyphase"), 
-				   samples_per_frame, diff.ToLong(), playback_time * 1000.0 * pipes.size() / diff.ToLong());
+				   samples_per_frame, diff.ToLong(), playback_time * 1000.0 * handles.size() / diff.ToLong());
 
 			pipes.clear();
 		}
@@ -162,6 +199,458 @@ void TestApp::RunTest(unsigned bits_per_sample, bool compress, unsigned sample_i
 	}
 }
 
+double TestApp::RunKernel(DecodeBlockFunction decode, audio_section_stream& stream, float* output, unsigned n_frames)
+{
+	const unsigned block = 1024;
+	unsigned long frames = 0;
+	const DecompressionCache cache = stream.cache;
+	wxMilliClock_t start = getCPUTime();
+	wxMilliClock_t diff;
+	do
+	{
+		for(unsigned i = 0; i < 100; i++)
+		{
+			stream.position_index = 0;
+			stream.position_fraction = 0;
+			stream.cache = cache;
+			for(unsigned j = 0; j + block <= n_frames; j += block)
+				decode(&stream, output + 2 * j, block);
+			frames += n_frames;
+		}
+		diff = getCPUTime() - start;
+	}
+	while(diff < 2000);
+
+	/* Million frames per second */
+	return frames / (diff.ToDouble() * 1000.0);
+}
+
+void TestApp::RunKernelTest(unsigned channels, unsigned bits_per_sample)
+{
+	const unsigned n_frames = 16 * 1024;
+	const unsigned bytes_per_sample = (bits_per_sample + 7) / 8;
+	std::vector<unsigned char> data((n_frames + 2 * MAX_READAHEAD) * channels * bytes_per_sample);
+	std::vector<float> reference(n_frames * 2);
+	std::vector<float> output(n_frames * 2);
+	struct resampler_coefs_s coefs;
+
+	srand(1);
+	for(unsigned i = 0; i < data.size(); i++)
+		data[i] = rand();
+	resampler_coefs_init(&coefs, 48000, GO_POLYPHASE_INTERPOLATION);
+
+	audio_section_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	stream.resample_coefs = &coefs;
+	stream.ptr = &data[0];
+	stream.increment_fraction = 44100.0 / 48000.0 * UPSAMPLE_FACTOR;
+
+	DecodeBlockFunction scalar = GOAudioSection::GetDecodeBlockFunction(channels, bits_per_sample, false, GO_POLYPHASE_INTERPOLATION, false, GO_SIMD_NONE);
+	double scalar_speed = RunKernel(scalar, stream, &reference[0], n_frames);
+	wxLogError(wxT("Polyphase %s %d bit, scalar: %f Mframes/s"), channels == 1 ? wxT("mono") : wxT("stereo"), bits_per_sample, scalar_speed);
+
+	const simd_type types[] = { GO_SIMD_SSE2, GO_SIMD_AVX2, GO_SIMD_NEON };
+	for(unsigned i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+	{
+		if (!GOSoundSIMD::IsSupported(types[i]))
+			continue;
+		DecodeBlockFunction decode = GOAudioSection::GetDecodeBlockFunction(channels, bits_per_sample, false, GO_POLYPHASE_INTERPOLATION, false, types[i]);
+		if (decode == scalar)
+			continue;
+		double speed = RunKernel(decode, stream, &output[0], n_frames);
+
+		float max_diff = 0;
+		for(unsigned j = 0; j < output.size(); j++)
+			max_diff = std::max(max_diff, fabsf(output[j] - reference[j]));
+		max_diff = scalbnf(max_diff, 1 - (int)bits_per_sample);
+
+		wxLogError(wxT("Polyphase %s %d bit, %s: %f Mframes/s, speedup %f, max error %g (%s)"), channels == 1 ? wxT("mono") : wxT("stereo"), bits_per_sample,
+			   wxString::FromAscii(GOSoundSIMD::GetName(types[i])).c_str(), speed, speed / scalar_speed, max_diff,
+			   max_diff <= GO_SIMD_TOLERANCE ? wxT("ok") : wxT("FAILED"));
+	}
+
+	if (bits_per_sample < 12)
+		return;
+
+	/* Same samples, losslessly compressed the way GOAudioSection::Compress
+	 * and GOAudioSection::CompressBlocks do */
+	const bool format16 = bits_per_sample >= 20;
+	const unsigned n_samples = n_frames + 2 * MAX_READAHEAD;
+	std::vector<unsigned char> compressed(n_samples * channels * 4);
+	unsigned output_len = 0;
+	int value[MAX_OUTPUT_CHANNELS] = { 0, 0 };
+	int prev[MAX_OUTPUT_CHANNELS] = { 0, 0 };
+	for(unsigned i = 0; i < n_samples; i++)
+		for(unsigned j = 0; j < channels; j++)
+		{
+			int last = prev[j];
+			prev[j] = value[j];
+			value[j] = GOAudioSection::GetSampleData(i, j, bits_per_sample, channels, &data[0]);
+			int encode = value[j] - (prev[j] + (prev[j] - last) / 2);
+			if (format16)
+				AudioWriteCompressed16(&compressed[0], output_len, encode);
+			else
+				AudioWriteCompressed8(&compressed[0], output_len, encode);
+		}
+
+	const unsigned block_count = n_samples / BLOCK_COMPRESSION_FRAMES;
+	std::vector<unsigned char> blocks(block_count * (sizeof(uint32_t) + BLOCK_COMPRESSION_MAX_SIZE) + BLOCK_COMPRESSION_PADDING);
+	std::vector<int> samples(BLOCK_COMPRESSION_FRAMES * channels);
+	output_len = block_count * sizeof(uint32_t);
+	for(unsigned i = 0; i < block_count; i++)
+	{
+		for(unsigned k = 0; k < BLOCK_COMPRESSION_FRAMES; k++)
+			for(unsigned j = 0; j < channels; j++)
+				samples[k * channels + j] = GOAudioSection::GetSampleData(i * BLOCK_COMPRESSION_FRAMES + k, j, bits_per_sample, channels, &data[0]);
+		((uint32_t*)&blocks[0])[i] = output_len;
+		AudioWriteBlockCompressed(&blocks[0], output_len, &samples[0], channels);
+	}
+
+	const compression_type codecs[] = { GO_COMPRESSION_PREDICTIVE, GO_COMPRESSION_BLOCK };
+	const interpolation_type interpolations[] = { GO_LINEAR_INTERPOLATION, GO_POLYPHASE_INTERPOLATION };
+	for(unsigned c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++)
+	{
+		const wxChar* codec_name = codecs[c] == GO_COMPRESSION_BLOCK ? wxT("block compressed") : wxT("compressed");
+		for(unsigned i = 0; i < sizeof(interpolations) / sizeof(interpolations[0]); i++)
+		{
+			InitDecompressionCache(stream.cache);
+			stream.cache.ptr = codecs[c] == GO_COMPRESSION_BLOCK ? &blocks[((uint32_t*)&blocks[0])[0]] : &compressed[0];
+			DecodeBlockFunction decode = GOAudioSection::GetDecodeBlockFunction(channels, bits_per_sample, codecs[c], interpolations[i], false);
+			double speed = RunKernel(decode, stream, &output[0], n_frames);
+			if (interpolations[i] == GO_POLYPHASE_INTERPOLATION)
+			{
+				float max_diff = 0;
+				for(unsigned j = 0; j < output.size(); j++)
+					max_diff = std::max(max_diff, fabsf(output[j] - reference[j]));
+				max_diff = scalbnf(max_diff, 1 - (int)bits_per_sample);
+
+				wxLogError(wxT("Polyphase %s %d bit, %s: %f Mframes/s, speedup %f, max error %g (%s)"), channels == 1 ? wxT("mono") : wxT("stereo"), bits_per_sample,
+					   codec_name, speed, speed / scalar_speed, max_diff, max_diff <= GO_SIMD_TOLERANCE ? wxT("ok") : wxT("FAILED"));
+			}
+			else
+				wxLogError(wxT("Linear %s %d bit, %s: %f Mframes/s"), channels == 1 ? wxT("mono") : wxT("stereo"), bits_per_sample, codec_name, speed);
+		}
+	}
+}
+
+/* Cycles per voice-frame to decode, fade and mix all voices into one buffer */
+double TestApp::RunMix(bool fused, DecodeBlockFunction decode, std::vector<audio_section_stream>& streams, std::vector<GOSoundFader>& faders, float* output, unsigned n_frames)
+{
+	float temp[n_frames * 2];
+	uint64_t cycles = 0;
+	unsigned long voice_frames = 0;
+	wxMilliClock_t start = getCPUTime();
+	do
+	{
+		for(unsigned i = 0; i < 100; i++)
+		{
+			memset(output, 0, n_frames * 2 * sizeof(float));
+			for(unsigned j = 0; j < streams.size(); j++)
+			{
+				streams[j].position_index = j;
+				streams[j].position_fraction = 0;
+				faders[j].NewAttacking(1.0f, 4 * n_frames * 1000 / 48000 + 1, 48000);
+			}
+			uint64_t begin = getCycles();
+			for(unsigned j = 0; j < streams.size(); j++)
+			{
+				decode(&streams[j], temp, n_frames);
+				if (fused)
+					faders[j].ProcessAndAdd(n_frames, temp, output, 1.0f);
+				else
+				{
+					faders[j].Process(n_frames, temp, 1.0f);
+					for(unsigned k = 0; k < n_frames * 2; k++)
+						output[k] += temp[k];
+				}
+			}
+			cycles += getCycles() - begin;
+			voice_frames += streams.size() * n_frames;
+		}
+	}
+	while(getCPUTime() - start < 2000);
+
+	return cycles / (double)voice_frames;
+}
+
+void TestApp::RunMixTest(unsigned voices, unsigned n_frames)
+{
+	const unsigned bits_per_sample = 16;
+	std::vector<unsigned char> data((voices + n_frames + 2 * MAX_READAHEAD) * 2 * bits_per_sample / 8);
+	std::vector<float> reference(n_frames * 2);
+	std::vector<float> output(n_frames * 2);
+	struct resampler_coefs_s coefs;
+
+	srand(1);
+	for(unsigned i = 0; i < data.size(); i++)
+		data[i] = rand();
+	resampler_coefs_init(&coefs, 48000, GO_POLYPHASE_INTERPOLATION);
+
+	std::vector<audio_section_stream> streams(voices);
+	std::vector<GOSoundFader> faders(voices);
+	for(unsigned i = 0; i < voices; i++)
+	{
+		memset(&streams[i], 0, sizeof(streams[i]));
+		streams[i].resample_coefs = &coefs;
+		streams[i].ptr = &data[0];
+		streams[i].increment_fraction = 44100.0 / 48000.0 * UPSAMPLE_FACTOR;
+	}
+
+	DecodeBlockFunction decode = GOAudioSection::GetDecodeBlockFunction(2, bits_per_sample, false, GO_POLYPHASE_INTERPOLATION, false);
+	double separate = RunMix(false, decode, streams, faders, &reference[0], n_frames);
+	double fused = RunMix(true, decode, streams, faders, &output[0], n_frames);
+
+	float max_diff = 0;
+	for(unsigned i = 0; i < output.size(); i++)
+		max_diff = std::max(max_diff, fabsf(output[i] - reference[i]) / std::max(1.0f, fabsf(reference[i])));
+
+	wxLogError(wxT("Mix %d voices, %d block: separate fade %f, fused fade %f %s per voice-frame, speedup %f, max relative error %g"),
+		   voices, n_frames, separate, fused, CYCLE_UNIT, separate / fused, max_diff);
+}
+
+static void AllocThread(GOrgueMemoryPool* pool, void** ptrs, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ptrs[i] = pool->Alloc(16 + (i * 97) % 1008, true);
+}
+
+static void FreeThread(GOrgueMemoryPool* pool, void** ptrs, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		pool->Free(ptrs[i]);
+}
+
+/* Final allocations from several load threads at once */
+void TestApp::RunAllocTest(unsigned threads)
+{
+	const unsigned count = 100000;
+	GOrgueMemoryPool pool;
+	std::vector<void*> ptrs(threads * count);
+	std::vector<std::thread> workers;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(unsigned i = 0; i < threads; i++)
+		workers.push_back(std::thread(AllocThread, &pool, &ptrs[i * count], count));
+	for(unsigned i = 0; i < threads; i++)
+		workers[i].join();
+	std::chrono::steady_clock::time_point alloc_end = std::chrono::steady_clock::now();
+
+	workers.clear();
+	for(unsigned i = 0; i < threads; i++)
+		workers.push_back(std::thread(FreeThread, &pool, &ptrs[i * count], count));
+	for(unsigned i = 0; i < threads; i++)
+		workers[i].join();
+	std::chrono::steady_clock::time_point free_end = std::chrono::steady_clock::now();
+
+	double alloc_time = std::chrono::duration<double>(alloc_end - start).count();
+	double free_time = std::chrono::duration<double>(free_end - alloc_end).count();
+	wxLogError(wxT("Pool %d threads: %f M allocations/s, %f M frees/s"), threads,
+		   threads * count / alloc_time / 1e6, threads * count / free_time / 1e6);
+}
+
+/* GB/s of sample data converted by GOrgueWave::ReadSamples, as during an
+ * uncached load */
+void TestApp::RunWaveTest(unsigned bits_per_sample, bool packed)
+{
+	const unsigned channels = 2;
+	const unsigned n_frames = 1024 * 1024;
+	const unsigned bytes_per_sample = bits_per_sample / 8;
+	const unsigned data_size = n_frames * channels * bytes_per_sample;
+
+	GO_WAVECHUNKHEADER head;
+	GO_WAVETYPEFIELD type = WAVE_TYPE_WAVE;
+	GO_WAVEFORMATPCM fmt;
+	fmt.wf.wFormatTag = bytes_per_sample == 4 ? 3 : 1;
+	fmt.wf.nChannels = channels;
+	fmt.wf.nSamplesPerSec = 48000;
+	fmt.wf.nAvgBytesPerSec = 48000 * channels * bytes_per_sample;
+	fmt.wf.nBlockAlign = channels * bytes_per_sample;
+	fmt.wBitsPerSample = bits_per_sample;
+
+	GOrgueBuffer<uint8_t> content;
+	head.fccChunk = WAVE_TYPE_RIFF;
+	head.dwSize = sizeof(type) + 2 * sizeof(head) + sizeof(fmt) + data_size;
+	content.Append((const uint8_t*)&head, sizeof(head));
+	content.Append((const uint8_t*)&type, sizeof(type));
+	head.fccChunk = WAVE_TYPE_FMT;
+	head.dwSize = sizeof(fmt);
+	content.Append((const uint8_t*)&head, sizeof(head));
+	content.Append((const uint8_t*)&fmt, sizeof(fmt));
+	head.fccChunk = WAVE_TYPE_DATA;
+	head.dwSize = data_size;
+	content.Append((const uint8_t*)&head, sizeof(head));
+
+	GOrgueBuffer<uint8_t> data(data_size);
+	srand(1);
+	if (bytes_per_sample == 4)
+		for(unsigned i = 0; i < n_frames * channels; i++)
+			((float*)data.get())[i] = rand() / (float)RAND_MAX * 2 - 1;
+	else
+		for(unsigned i = 0; i < data_size; i++)
+			data[i] = rand();
+	content.Append(data);
+
+	try
+	{
+		GOrgueWave wave;
+		wave.Open(content);
+		if (packed)
+		{
+			GOrgueBuffer<uint8_t> pack;
+			if (!wave.Save(pack))
+				throw (wxString)wxT("WavPack encoding failed");
+			wave.Open(pack);
+		}
+
+		const struct
+		{
+			GOrgueWave::SAMPLE_FORMAT format;
+			int channels;
+			const wxChar* name;
+		} targets[] = {
+			{ GOrgueWave::SF_SIGNEDSHORT_16, 2, wxT("int16") },
+			{ GOrgueWave::SF_SIGNEDINT24_24, 2, wxT("int24") },
+			{ GOrgueWave::SF_IEEE_FLOAT, 2, wxT("float") },
+			{ GOrgueWave::SF_SIGNEDSHORT_16, 1, wxT("mono int16") },
+		};
+		std::vector<uint8_t> output(n_frames * channels * 4);
+		for(unsigned i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+		{
+			if (targets[i].format != GOrgueWave::SF_IEEE_FLOAT && (unsigned)targets[i].format > bits_per_sample)
+				continue;
+			unsigned long bytes = 0;
+			wxMilliClock_t start = getCPUTime();
+			wxMilliClock_t diff;
+			do
+			{
+				wave.ReadSamples(&output[0], targets[i].format, 48000, targets[i].channels);
+				bytes += n_frames * channels * (packed ? 4 : bytes_per_sample);
+				diff = getCPUTime() - start;
+			}
+			while(diff < 2000);
+
+			wxLogError(wxT("Wave %d bit%s stereo to %s: %f GB/s"), bits_per_sample, packed ? wxT(" packed") : wxT(""), targets[i].name,
+				   bytes / (diff.ToDouble() * 1e6));
+		}
+	}
+	catch(wxString msg)
+	{
+		wxLogError(wxT("Error: %s"), msg.c_str());
+	}
+}
+
+class TestMidiHandler : public GOrgueEventHandler
+{
+public:
+	GOrgueMidiReceiverBase m_midi;
+	unsigned m_Matches;
+
+	TestMidiHandler(MIDI_RECEIVER_TYPE type) :
+		m_midi(type),
+		m_Matches(0)
+	{
+	}
+
+	void ProcessMidi(const GOrgueMidiEvent& event)
+	{
+		if (m_midi.Match(event) != MIDI_MATCH_NONE)
+			m_Matches++;
+	}
+
+	void HandleKey(int key)
+	{
+	}
+
+	bool GetMidiKeys(std::vector<MIDI_DISPATCH_KEY>& keys)
+	{
+		return m_midi.GetMidiKeys(keys);
+	}
+};
+
+class TestMidiDistributor : public GOrgueEventDistributor
+{
+public:
+	void Send(const GOrgueMidiEvent& event)
+	{
+		SendMidi(event);
+	}
+};
+
+/* Manuals on channels 1-4, one note controlled stop per key on the upper
+ * channels, compared against offering every event to every handler */
+void TestApp::RunMidiTest(unsigned manuals, unsigned stops)
+{
+	const unsigned count = 1000000;
+	ptr_vector<TestMidiHandler> handlers;
+	TestMidiDistributor distributor;
+
+	for(unsigned i = 0; i < manuals + stops; i++)
+	{
+		TestMidiHandler* handler = new TestMidiHandler(i < manuals ? MIDI_RECV_MANUAL : MIDI_RECV_DRAWSTOP);
+		GOrgueMidiReceiverData data(handler->m_midi.GetType());
+		MIDI_MATCH_EVENT& e = data.GetEvent(data.AddNewEvent());
+		if (i < manuals)
+		{
+			e.type = MIDI_M_NOTE;
+			e.channel = 1 + i;
+			e.low_key = 36;
+			e.high_key = 96;
+			e.key = 0;
+			e.low_value = 1;
+			e.high_value = 127;
+		}
+		else
+		{
+			e.type = MIDI_M_NOTE_ON;
+			e.channel = 1 + manuals + (i - manuals) / 128;
+			e.key = (i - manuals) % 128;
+			e.low_value = 0;
+			e.high_value = 1;
+			e.debounce_time = 0;
+		}
+		handler->m_midi.Assign(data);
+		handlers.push_back(handler);
+		distributor.RegisterEventHandler(handler);
+	}
+	distributor.UpdateMidiIndex();
+
+	std::vector<GOrgueMidiEvent> events(4096);
+	srand(1);
+	for(unsigned i = 0; i < events.size(); i++)
+	{
+		events[i].SetMidiType(MIDI_NOTE);
+		events[i].SetDevice(1);
+		events[i].SetChannel(1 + rand() % (manuals + (stops + 127) / 128));
+		events[i].SetKey(rand() % 128);
+		events[i].SetValue(rand() % 2 ? 100 : 0);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(unsigned i = 0; i < count; i++)
+		for(unsigned j = 0; j < handlers.size(); j++)
+			handlers[j]->ProcessMidi(events[i % events.size()]);
+	std::chrono::steady_clock::time_point broadcast_end = std::chrono::steady_clock::now();
+	unsigned broadcast_matches = 0;
+	for(unsigned j = 0; j < handlers.size(); j++)
+	{
+		broadcast_matches += handlers[j]->m_Matches;
+		handlers[j]->m_Matches = 0;
+	}
+
+	for(unsigned i = 0; i < count; i++)
+		distributor.Send(events[i % events.size()]);
+	std::chrono::steady_clock::time_point indexed_end = std::chrono::steady_clock::now();
+	unsigned indexed_matches = 0;
+	for(unsigned j = 0; j < handlers.size(); j++)
+		indexed_matches += handlers[j]->m_Matches;
+
+	double broadcast_time = std::chrono::duration<double>(broadcast_end - start).count();
+	double indexed_time = std::chrono::duration<double>(indexed_end - broadcast_end).count();
+	wxLogError(wxT("MIDI %d handlers: broadcast %f M events/s, indexed %f M events/s, %s"), handlers.size(),
+		   count / broadcast_time / 1e6, count / indexed_time / 1e6,
+		   broadcast_matches == indexed_matches ? wxT("same matches") : wxT("MATCH MISMATCH"));
+}
+
 bool TestApp::OnInit()
 {
 	wxLog *logger=new wxLogStream(&std::cout);
@@ -183,6 +672,23 @@ bool TestApp::OnInit()
 int TestApp::OnRun()
 {
 	const int samplers = 300;
+	for(unsigned channels = 1; channels <= 2; channels++)
+	{
+		RunKernelTest(channels, 8);
+		RunKernelTest(channels, 16);
+		RunKernelTest(channels, 24);
+	}
+	RunMixTest(256, 64);
+	RunMixTest(256, 1024);
+	for(unsigned threads = 1; threads <= 8; threads *= 2)
+		RunAllocTest(threads);
+	RunWaveTest(16, false);
+	RunWaveTest(24, false);
+	RunWaveTest(32, false);
+	RunWaveTest(16, true);
+	RunWaveTest(24, true);
+	RunMidiTest(4, 128);
+	RunMidiTest(4, 1024);
 	RunTest(8, true, samplers, 44100, 0, 128);
 	RunTest(8, false, samplers, 44100, 0, 128);
 	RunTest(16, true, samplers, 44100, 0, 128);
@@ -201,5 +707,13 @@ int TestApp::OnRun()
 	RunTest(16, false, samplers, 48000, 0, 1024);
 	RunTest(24, true, samplers, 48000, 0, 1024);
 	RunTest(24, false, samplers, 48000, 0, 1024);
+
+	/* Large organ: many voices on few samples with small buffers, which
+	 * stresses the per sampler overhead instead of the decoders */
+	const int voices = 2400;
+	RunTest(16, false, 30, 48000, 1, 64, voices);
+	RunTest(16, true, 30, 48000, 1, 64, voices);
+	RunTest(24, false, 30, 48000, 1, 128, voices);
+	RunTest(16, false, 30, 48000, 0, 128, voices);
 	return 0;
 }